@@ -0,0 +1,1542 @@
+/**
+ * Microbenchmarks which run against the current frame.
+ * Every measurement is printed as one line of name=value pairs
+ * so runs from different versions can be diffed.
+ * @file benchmark.c
+ * @author ABM
+*/
+#include "benchmark.h"
+#include "framebuffer.h"
+#include "fill.h"
+#include "pixelDrawer.h"
+#include "triangle.h"
+#include "circle.h"
+#include "commandList.h"
+#include "renderer.h"
+#include "thread.h"
+#include "timer.h"
+#include "random.h"
+#include "capture.h"
+#include "scene.h"
+#include "blend.h"
+#include "primitives.h"
+#include "points.h"
+#include "retained.h"
+#include "dirty.h"
+#include "text.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Number of times each circle is drawn per measurement. */
+#define CIRCLE_REPETITIONS 200
+
+/** Number of radii measured between 0 and frame.height/3. */
+#define CIRCLE_RADIUS_STEPS 16
+
+/** Number of random triangles drawn per measurement. */
+#define TRIANGLE_COUNT 10000
+
+//Largest extent of the random triangles in each triangle measurement, in pixels.
+static const int triangle_sizes[] = {8, 32, 128, 512};
+
+/** Number of frames rendered per thread count in the scaling benchmark. */
+#define THREAD_FRAMES 20
+
+/** Number of random points in the scaling benchmark frame. */
+#define THREAD_POINTS 100000
+
+/** Number of random values drawn per measurement in the random benchmark. */
+#define RANDOM_VALUES (1 << 22)
+
+/** Number of times the frame is converted per instruction set in the YUV benchmark. */
+#define YUV_REPETITIONS 10
+
+/** Number of shapes of each kind in the scene benchmark: circles, triangles, lines and points. */
+static const int scene_counts[SCENE_SHAPE_COUNT] = {10000, 40000, 20000, 30000};
+
+/** Number of times the scene is recorded and rendered per measurement. */
+#define SCENE_REPETITIONS 10
+
+/** Number of times the frame is blended over per measurement. */
+#define BLEND_REPETITIONS 10
+
+/** Number of each kind of shape drawn aliased and anti-aliased per measurement. */
+#define ANTIALIAS_SHAPES 20000
+
+/** Number of times each batch of points is drawn per measurement. */
+#define POINT_REPETITIONS 5
+
+/** Frame size the point benchmark draws into. */
+#define POINT_FRAME_WIDTH 3840
+#define POINT_FRAME_HEIGHT 2160
+
+//Number of random points per frame in each point measurement.
+static const int point_counts[] = {1000000, 2000000, 5000000, 10000000};
+
+/** Number of shapes drawn per rasterizer, case and frame size in the raster benchmark's golden images. */
+#define RASTER_CASE_SHAPES 32
+
+/** Number of shapes per rasterizer and size the raster benchmark times. */
+#define RASTER_TIMED_SHAPES 2000
+
+/** Number of the timed shapes whose pixels are counted, to work out the pixels per second. */
+#define RASTER_COUNTED_SHAPES 50
+
+//Frame sizes every golden image is drawn at, the odd widths have padded rows.
+static const struct {
+    int width;
+    int height;
+} raster_sizes[] = {
+    {9, 7},
+    {100, 61},
+    {333, 197},
+    {1280, 720},
+};
+
+//Largest extent of the shapes in each raster timing, in pixels.
+static const int raster_extents[] = {4, 32, 256};
+
+/** Number of times each workload of the layout benchmark is drawn in each layout. */
+#define LAYOUT_REPETITIONS 5
+
+/** Number of random points in the layout benchmark's points workload. */
+#define LAYOUT_POINTS 1000000
+
+//Frame sizes the layout benchmark draws at.
+static const struct {
+    int width;
+    int height;
+} layout_sizes[] = {
+    {1280, 720},
+    {3840, 2160},
+};
+
+/** Number of frames the retained benchmark times each way, after the first. */
+#define RETAINED_FRAMES 20
+
+//Number of circles moving over the still scene of the retained benchmark.
+static const int retained_moving[] = {0, 1, 16, 256};
+
+/** Number of lines of text the text benchmark draws per repetition. */
+#define TEXT_LINES 64
+
+/** Number of times the text benchmark draws its lines each way. */
+#define TEXT_REPETITIONS 200
+
+/** File the scene benchmark saves its scene to and loads it back from, removed afterwards. */
+#define SCENE_FILE "benchmark.pdscene"
+
+/** Number of times each fill is repeated per measurement. */
+#define FILL_REPETITIONS 20
+
+/** Length of the spans in the span fill measurement, in pixels. */
+#define FILL_SPAN_LENGTH 256
+
+//Frame sizes the fill kernels are measured at.
+static const struct {
+    int width;
+    int height;
+} fill_sizes[] = {
+    {1920, 1080},
+    {2560, 1440},
+    {3840, 2160},
+};
+
+/**
+ * Times a circle drawing function at one radius.
+ * @param draw The function to time.
+ * @param radius The radius to draw at.
+ * @return Average time per circle, in nanoseconds.
+*/
+static double timeCircle(void (*draw)(int, int, int), int radius) {
+    uint64_t start = timerNow();
+    for (int i = 0; i < CIRCLE_REPETITIONS; i++) {
+        draw(frame.width/2, frame.height/2, radius);
+    }
+    return (double)(timerNow() - start)/CIRCLE_REPETITIONS;
+}
+
+/**
+ * Compares the sqrt circle with the midpoint circle across radii up to frame.height/3,
+ * the range the animation sweeps through.
+ * @return true, nothing in it can fail.
+*/
+static bool benchmarkCircle(void) {
+    int max_radius = frame.height/3;
+    int step = max_radius/CIRCLE_RADIUS_STEPS > 0 ? max_radius/CIRCLE_RADIUS_STEPS : 1;
+
+    double sqrt_total = 0;
+    double midpoint_total = 0;
+    for (int radius = step; radius <= max_radius; radius += step) {
+        double sqrt_ns = timeCircle(drawCircleSqrt, radius);
+        double midpoint_ns = timeCircle(drawCircle, radius);
+        sqrt_total += sqrt_ns;
+        midpoint_total += midpoint_ns;
+        printf("circle radius=%d sqrt_ns=%.1f midpoint_ns=%.1f speedup=%.2f\n",
+               radius, sqrt_ns, midpoint_ns, sqrt_ns/midpoint_ns);
+    }
+    if (midpoint_total > 0) {
+        printf("circle radius=all sqrt_ns=%.1f midpoint_ns=%.1f speedup=%.2f\n",
+               sqrt_total, midpoint_total, sqrt_total/midpoint_total);
+    }
+    return true;
+}
+
+/**
+ * Prints one fill measurement.
+ * @param operation What was filled.
+ * @param start timerNow reading from before the repetitions.
+ * @param pixels Number of pixels written per repetition.
+*/
+static void printFill(const char *operation, uint64_t start, size_t pixels) {
+    double ns = (double)(timerNow() - start)/FILL_REPETITIONS;
+    printf("fill size=%dx%d kernel=%s op=%s ns=%.0f gbps=%.2f\n",
+           frame.width, frame.height, fillKernelName(fillGetKernel()), operation,
+           ns, pixels*sizeof(uint32_t)/ns);
+}
+
+/**
+ * Compares every supported fill kernel with the scalar loop for a full frame clear,
+ * a rectangle and one span per row, at 1080p, 1440p and 4K.
+ * @return true, nothing in it can fail.
+*/
+static bool benchmarkFill(void) {
+    int width = frame.width;
+    int height = frame.height;
+
+    for (size_t size = 0; size < sizeof(fill_sizes)/sizeof(fill_sizes[0]); size++) {
+        if (!frameResize(fill_sizes[size].width, fill_sizes[size].height)) {
+            printf("fill size=%dx%d error=allocation\n", fill_sizes[size].width, fill_sizes[size].height);
+            continue;
+        }
+        for (int kernel = 0; kernel < FILL_KERNEL_COUNT; kernel++) {
+            if (!fillSetKernel(kernel)) {
+                continue;
+            }
+
+            uint64_t start = timerNow();
+            for (int i = 0; i < FILL_REPETITIONS; i++) {
+                fillClear(i);
+            }
+            printFill("clear", start, (size_t)frame.width*frame.height);
+
+            start = timerNow();
+            for (int i = 0; i < FILL_REPETITIONS; i++) {
+                fillRect(frame.width/4 + 1, frame.height/4, frame.width/2, frame.height/2, i);
+            }
+            printFill("rect", start, (size_t)(frame.width/2)*(frame.height/2));
+
+            //Spans start at a different, mostly unaligned, x on every row
+            start = timerNow();
+            for (int i = 0; i < FILL_REPETITIONS; i++) {
+                for (int y = 0; y < frame.height; y++) {
+                    int x = (y*37)%(frame.width - FILL_SPAN_LENGTH);
+                    fillPixels(frame.pixels + x + (size_t)y*frame.stride, FILL_SPAN_LENGTH, i);
+                }
+            }
+            printFill("span", start, (size_t)frame.height*FILL_SPAN_LENGTH);
+        }
+    }
+
+    fillInit();
+    frameResize(width, height);
+    return true;
+}
+
+/**
+ * Times filled triangles with random vertices at several sizes.
+ * @return false if it couldn't run.
+*/
+static bool benchmarkTriangle(void) {
+    if (frame.width == 0 || frame.height == 0) {
+        return false;
+    }
+
+    for (size_t size = 0; size < sizeof(triangle_sizes)/sizeof(triangle_sizes[0]); size++) {
+        int extent = triangle_sizes[size];
+        //Same triangles on every run
+        struct Random random;
+        randomSeed(&random, 1);
+        uint64_t start = timerNow();
+        for (int i = 0; i < TRIANGLE_COUNT; i++) {
+            int x = randomBelow(&random, frame.width);
+            int y = randomBelow(&random, frame.height);
+            triangleFilled(x, y,
+                           x + randomBelow(&random, extent), y + randomBelow(&random, extent),
+                           x - randomBelow(&random, extent), y + randomBelow(&random, extent),
+                           i);
+        }
+        double ns = (double)(timerNow() - start)/TRIANGLE_COUNT;
+        printf("triangle size=%d count=%d ns_per_triangle=%.1f\n", extent, TRIANGLE_COUNT, ns);
+    }
+    return true;
+}
+
+/**
+ * Records a busy frame of random triangles, circles, lines and points.
+ * @param list The list to record into.
+*/
+static void recordMixedFrame(struct CommandList *list) {
+    //Same frame on every run, and on every platform
+    struct Random random;
+    randomSeed(&random, 1);
+    uint32_t width = frame.width;
+    uint32_t height = frame.height;
+
+    commandListClear(list, 0);
+    for (int i = 0; i < 2000; i++) {
+        int x = randomBelow(&random, width);
+        int y = randomBelow(&random, height);
+        commandListTriangleFilled(list, x, y,
+                                  x + randomBelow(&random, 64), y + randomBelow(&random, 64),
+                                  x - randomBelow(&random, 64), y + randomBelow(&random, 64),
+                                  randomNext(&random));
+    }
+    for (int i = 0; i < 200; i++) {
+        commandListCircleOutline(list, randomBelow(&random, width), randomBelow(&random, height),
+                                 randomBelow(&random, height/3 + 1), randomNext(&random));
+        commandListCircleFilled(list, randomBelow(&random, width), randomBelow(&random, height),
+                                randomBelow(&random, 64), randomNext(&random));
+    }
+    for (int i = 0; i < 500; i++) {
+        commandListLine(list, randomBelow(&random, width), randomBelow(&random, height),
+                        randomBelow(&random, width), randomBelow(&random, height), randomNext(&random));
+    }
+    uint32_t *indices;
+    uint32_t *colors;
+    commandListPoints(list, THREAD_POINTS, &indices, &colors);
+    randomFillBelow(&random, indices, THREAD_POINTS, width*height);
+    randomFill(&random, colors, THREAD_POINTS);
+    for (int i = 0; i < 50; i++) {
+        commandListDrawCircle(list, randomBelow(&random, width), randomBelow(&random, height), randomBelow(&random, 200));
+        commandListDrawTriangle(list, randomBelow(&random, width), randomBelow(&random, height), randomBelow(&random, 200));
+    }
+}
+
+/**
+ * Renders the same busy frame with 1 to one thread per logical CPU
+ * and checks every result against the single threaded one.
+ * @return false if it couldn't run.
+*/
+static bool benchmarkThreads(void) {
+    if (frame.width == 0 || frame.height == 0) {
+        return false;
+    }
+
+    struct CommandList list;
+    commandListInit(&list);
+    recordMixedFrame(&list);
+
+    //Reference frame, straight through commandListExecute
+    frameResetClip();
+    commandListExecute(&list);
+    uint64_t reference = frameChecksum();
+
+    double single_thread_ms = 0;
+    int max_threads = threadCpuCount();
+    for (int threads = 1; threads <= max_threads; threads++) {
+        struct Renderer *renderer = rendererCreate(threads);
+        if (!renderer) {
+            printf("threads count=%d error=create\n", threads);
+            break;
+        }
+
+        fillClear(0xFFFFFFFF);
+        uint64_t start = timerNow();
+        for (int i = 0; i < THREAD_FRAMES; i++) {
+            rendererExecute(renderer, &list);
+        }
+        double ms = (double)(timerNow() - start)/THREAD_FRAMES*1e-6;
+        if (threads == 1) {
+            single_thread_ms = ms;
+        }
+
+        printf("threads count=%d ms_per_frame=%.3f speedup=%.2f match=%s\n",
+               rendererThreadCount(renderer), ms, single_thread_ms/ms,
+               frameChecksum() == reference ? "yes" : "no");
+        rendererDestroy(renderer);
+    }
+
+    commandListFree(&list);
+    return true;
+}
+
+/**
+ * Compares picking random pixels the way the animation used to, with rand() and %,
+ * against the batched generator on every supported instruction set,
+ * and checks every instruction set gives the same numbers as the scalar one.
+ * @return false if it couldn't run.
+*/
+static bool benchmarkRandom(void) {
+    uint32_t pixel_count = (uint32_t)frame.width*frame.height;
+    uint32_t *values = malloc(RANDOM_VALUES*sizeof(uint32_t));
+    uint32_t *reference = malloc(RANDOM_VALUES*sizeof(uint32_t));
+    if (!values || !reference || pixel_count == 0) {
+        free(values);
+        free(reference);
+        return false;
+    }
+
+    //The old Rand32, which needs three rand() calls where RAND_MAX is only 15 bits
+    srand(1);
+    uint64_t start = timerNow();
+    for (int i = 0; i < RANDOM_VALUES; i++) {
+#if RAND_MAX == 32767
+        uint32_t value = ((uint32_t)rand() << 16) + ((uint32_t)rand() << 1) + (rand() & 1);
+#else
+        uint32_t value = (uint32_t)rand();
+#endif
+        values[i] = value%pixel_count;
+    }
+    double rand_ns = (double)(timerNow() - start)/RANDOM_VALUES;
+    printf("random generator=rand op=below ns_per_value=%.2f\n", rand_ns);
+
+    for (int level = 0; level < SIMD_LEVEL_COUNT; level++) {
+        struct Random random;
+        randomSeed(&random, 1);
+        if (!randomSetLevel(&random, level)) {
+            continue;
+        }
+
+        start = timerNow();
+        randomFill(&random, values, RANDOM_VALUES);
+        double fill_ns = (double)(timerNow() - start)/RANDOM_VALUES;
+
+        randomSeed(&random, 1);
+        randomSetLevel(&random, level);
+        start = timerNow();
+        randomFillBelow(&random, values, RANDOM_VALUES, pixel_count);
+        double below_ns = (double)(timerNow() - start)/RANDOM_VALUES;
+
+        if (level == SIMD_SCALAR) {
+            memcpy(reference, values, RANDOM_VALUES*sizeof(uint32_t));
+        }
+        printf("random generator=xoshiro128pp kernel=%s fill_ns_per_value=%.2f below_ns_per_value=%.2f speedup=%.2f match=%s\n",
+               simdLevelName(level), fill_ns, below_ns, rand_ns/below_ns,
+               memcmp(reference, values, RANDOM_VALUES*sizeof(uint32_t)) == 0 ? "yes" : "no");
+    }
+
+    free(values);
+    free(reference);
+    return true;
+}
+
+/**
+ * Times converting a frame of random pixels to 4:2:0 YUV, as the Y4M capture does,
+ * on every supported instruction set, and checks they all give the scalar result.
+ * @return false if it couldn't run.
+*/
+static bool benchmarkYuv(void) {
+    int width = frame.width;
+    int height = frame.height & ~1;
+    int chroma_width = (width + 1)/2;
+    size_t plane_size = (size_t)width*height + 2*(size_t)chroma_width*(height/2);
+    uint8_t *planes = malloc(plane_size);
+    uint8_t *reference = malloc(plane_size);
+    if (!planes || !reference || width == 0 || height == 0) {
+        free(planes);
+        free(reference);
+        return false;
+    }
+
+    struct Random random;
+    randomSeed(&random, 1);
+    for (int y = 0; y < frame.height; y++) {
+        randomFill(&random, frame.pixels + (size_t)y*frame.stride, width);
+    }
+
+    uint8_t *u_plane = planes + (size_t)width*height;
+    uint8_t *v_plane = u_plane + (size_t)chroma_width*(height/2);
+    double scalar_ns = 0;
+    for (int level = 0; level < SIMD_LEVEL_COUNT; level++) {
+        if (!simdSupported(level)) {
+            continue;
+        }
+        uint64_t start = timerNow();
+        for (int i = 0; i < YUV_REPETITIONS; i++) {
+            for (int y = 0; y < height; y += 2) {
+                captureRowsToYuv(level, frame.pixels + (size_t)y*frame.stride, frame.pixels + (size_t)(y + 1)*frame.stride,
+                                 width, planes + (size_t)y*width, planes + (size_t)(y + 1)*width,
+                                 u_plane + (size_t)(y/2)*chroma_width, v_plane + (size_t)(y/2)*chroma_width);
+            }
+        }
+        double ns = (double)(timerNow() - start)/((double)YUV_REPETITIONS*width*height);
+        if (level == SIMD_SCALAR) {
+            scalar_ns = ns;
+            memcpy(reference, planes, plane_size);
+        }
+        printf("yuv size=%dx%d kernel=%s ns_per_pixel=%.3f speedup=%.2f match=%s\n",
+               width, height, simdLevelName(level), ns, scalar_ns/ns,
+               memcmp(reference, planes, plane_size) == 0 ? "yes" : "no");
+    }
+
+    free(planes);
+    free(reference);
+    return true;
+}
+
+/**
+ * Fills a scene with random shapes across the frame.
+ * @param scene The scene, created with the number of shapes of each kind.
+*/
+static void randomScene(struct Scene *scene) {
+    struct Random random;
+    randomSeed(&random, 1);
+    uint32_t width = frame.width;
+    uint32_t height = frame.height;
+    scene->clear = true;
+    scene->clear_color = 0;
+
+    int32_t *x = sceneCoordinates(scene, SCENE_CIRCLES, 0);
+    int32_t *y = sceneCoordinates(scene, SCENE_CIRCLES, 1);
+    int32_t *radius = sceneCoordinates(scene, SCENE_CIRCLES, 2);
+    uint8_t *filled = sceneFilled(scene);
+    for (int i = 0; i < scene->shapes[SCENE_CIRCLES].count; i++) {
+        x[i] = randomBelow(&random, width);
+        y[i] = randomBelow(&random, height);
+        radius[i] = randomBelow(&random, 32);
+        filled[i] = randomBelow(&random, 2);
+    }
+    for (int i = 0; i < scene->shapes[SCENE_TRIANGLES].count; i++) {
+        int x0 = randomBelow(&random, width);
+        int y0 = randomBelow(&random, height);
+        int32_t vertices[6] = {x0, y0, x0 + randomBelow(&random, 32), y0 + randomBelow(&random, 32),
+                               x0 - randomBelow(&random, 32), y0 + randomBelow(&random, 32)};
+        for (int array = 0; array < 6; array++) {
+            sceneCoordinates(scene, SCENE_TRIANGLES, array)[i] = vertices[array];
+        }
+    }
+    for (int i = 0; i < scene->shapes[SCENE_LINES].count; i++) {
+        int x0 = randomBelow(&random, width);
+        int y0 = randomBelow(&random, height);
+        int32_t ends[4] = {x0, y0, x0 + randomBelow(&random, 64) - 32, y0 + randomBelow(&random, 64) - 32};
+        for (int array = 0; array < 4; array++) {
+            sceneCoordinates(scene, SCENE_LINES, array)[i] = ends[array];
+        }
+    }
+    randomFillBelow(&random, (uint32_t *)sceneCoordinates(scene, SCENE_POINTS, 0), scene->shapes[SCENE_POINTS].count, width);
+    randomFillBelow(&random, (uint32_t *)sceneCoordinates(scene, SCENE_POINTS, 1), scene->shapes[SCENE_POINTS].count, height);
+    for (int shape = 0; shape < SCENE_SHAPE_COUNT; shape++) {
+        randomFill(&random, sceneColors(scene, shape), scene->shapes[shape].count);
+    }
+    sceneUpdate(scene);
+}
+
+/**
+ * Records the shapes of a scene one command per shape, the way they would
+ * have to be drawn without batch commands.
+ * @param scene The scene.
+ * @param list The list to record into.
+*/
+static void recordSceneShapes(const struct Scene *scene, struct CommandList *list) {
+    commandListClear(list, scene->clear_color);
+    const struct ShapeBatch *circles = &scene->shapes[SCENE_CIRCLES];
+    for (int i = 0; i < circles->count; i++) {
+        if (circles->filled[i]) {
+            commandListCircleFilled(list, circles->coordinates[0][i], circles->coordinates[1][i],
+                                    circles->coordinates[2][i], circles->colors[i]);
+        } else {
+            commandListCircleOutline(list, circles->coordinates[0][i], circles->coordinates[1][i],
+                                     circles->coordinates[2][i], circles->colors[i]);
+        }
+    }
+    const struct ShapeBatch *triangles = &scene->shapes[SCENE_TRIANGLES];
+    for (int i = 0; i < triangles->count; i++) {
+        commandListTriangleFilled(list, triangles->coordinates[0][i], triangles->coordinates[1][i],
+                                  triangles->coordinates[2][i], triangles->coordinates[3][i],
+                                  triangles->coordinates[4][i], triangles->coordinates[5][i], triangles->colors[i]);
+    }
+    const struct ShapeBatch *lines = &scene->shapes[SCENE_LINES];
+    for (int i = 0; i < lines->count; i++) {
+        commandListLine(list, lines->coordinates[0][i], lines->coordinates[1][i],
+                        lines->coordinates[2][i], lines->coordinates[3][i], lines->colors[i]);
+    }
+    const struct ShapeBatch *points = &scene->shapes[SCENE_POINTS];
+    for (int i = 0; i < points->count; i++) {
+        commandListPoint(list, points->coordinates[0][i] + points->coordinates[1][i]*frame.width, points->colors[i]);
+    }
+}
+
+/**
+ * Times recording and rendering one scene.
+ * @param method Name to print for the way it is recorded.
+ * @param scene The scene.
+ * @param record Function recording the scene.
+ * @param renderer Renderer to render with.
+ * @param reference Checksum to compare against, 0 to print it as the reference.
+ * @return Checksum of the rendered frame.
+*/
+static uint64_t timeScene(const char *method, const struct Scene *scene,
+                          void (*record)(const struct Scene *, struct CommandList *),
+                          struct Renderer *renderer, uint64_t reference) {
+    struct CommandList list;
+    commandListInit(&list);
+    uint64_t record_ns = 0;
+    uint64_t render_ns = 0;
+    for (int i = 0; i < SCENE_REPETITIONS; i++) {
+        commandListReset(&list);
+        uint64_t start = timerNow();
+        record(scene, &list);
+        uint64_t recorded = timerNow();
+        rendererExecute(renderer, &list);
+        render_ns += timerNow() - recorded;
+        record_ns += recorded - start;
+    }
+    uint64_t checksum = frameChecksum();
+    printf("scene method=%s commands=%d record_ms=%.3f render_ms=%.3f match=%s\n",
+           method, list.count, record_ns*1e-6/SCENE_REPETITIONS, render_ns*1e-6/SCENE_REPETITIONS,
+           reference == 0 || checksum == reference ? "yes" : "no");
+    commandListFree(&list);
+    return checksum;
+}
+
+/**
+ * Saves a scene and loads it back as a program starting up would,
+ * then times drawing straight from the mapping.
+ * @param method Name to print for the loaded scene.
+ * @param scene The scene.
+ * @param renderer Renderer to render with.
+ * @param reference Checksum of the scene drawn before it was saved.
+*/
+static void timeLoadedScene(const char *method, const struct Scene *scene,
+                            struct Renderer *renderer, uint64_t reference) {
+    if (!sceneSave(scene, SCENE_FILE)) {
+        printf("scene error=save\n");
+        return;
+    }
+    struct Scene loaded;
+    uint64_t start = timerNow();
+    bool ok = sceneLoad(&loaded, SCENE_FILE);
+    double load_ms = (timerNow() - start)*1e-6;
+    if (ok) {
+        printf("scene load=%s bytes=%zu load_ms=%.3f\n", loaded.mapped ? "mapped" : "read", loaded.size, load_ms);
+        timeScene(method, &loaded, sceneRecord, renderer, reference);
+        sceneFree(&loaded);
+    } else {
+        printf("scene error=load\n");
+    }
+    remove(SCENE_FILE);
+}
+
+/**
+ * Records and renders a scene of 100000 shapes one command per shape
+ * and as batches, then saves it and times loading it back through a memory map,
+ * and does the same for a scene of circles only.
+ * @return false if it couldn't run.
+*/
+static bool benchmarkScene(void) {
+    struct Scene scene;
+    struct Renderer *renderer = rendererCreate(0);
+    if (frame.width == 0 || frame.height == 0 || !renderer || !sceneCreate(&scene, scene_counts)) {
+        rendererDestroy(renderer);
+        return false;
+    }
+    randomScene(&scene);
+
+    uint64_t reference = timeScene("per_shape", &scene, recordSceneShapes, renderer, 0);
+    timeScene("batched", &scene, sceneRecord, renderer, reference);
+
+    timeLoadedScene("mapped", &scene, renderer, reference);
+    sceneFree(&scene);
+
+    //Circles alone, whose filled flags take up less room than a coordinate, have to load too
+    int circle_counts[SCENE_SHAPE_COUNT] = {scene_counts[SCENE_CIRCLES]};
+    if (sceneCreate(&scene, circle_counts)) {
+        randomScene(&scene);
+        reference = timeScene("circles_per_shape", &scene, recordSceneShapes, renderer, 0);
+        timeLoadedScene("circles_mapped", &scene, renderer, reference);
+        sceneFree(&scene);
+    } else {
+        printf("scene error=circles\n");
+    }
+    rendererDestroy(renderer);
+    return true;
+}
+
+/**
+ * Draws the same random shapes of one kind with a draw function.
+ * @param kind 0 for circle outlines, 1 for solid circles, 2 for lines.
+ * @param antialias Whether to draw them anti-aliased.
+ * @return Nanoseconds per shape.
+*/
+static double timeShapes(int kind, bool antialias) {
+    struct Random random;
+    randomSeed(&random, 1);
+    uint32_t width = frame.width;
+    uint32_t height = frame.height;
+    fillClear(0);
+    uint64_t start = timerNow();
+    for (int i = 0; i < ANTIALIAS_SHAPES; i++) {
+        int x = randomBelow(&random, width);
+        int y = randomBelow(&random, height);
+        int size = randomBelow(&random, 64);
+        uint32_t color = randomNext(&random) & 0x00FFFFFF;
+        if (kind == 0) {
+            (antialias ? circleOutlineAntialiased : circleOutline)(x, y, size, color);
+        } else if (kind == 1) {
+            (antialias ? circleFilledAntialiased : circleFilled)(x, y, size, color);
+        } else {
+            int x1 = x + randomBelow(&random, 256) - 128;
+            int y1 = y + randomBelow(&random, 256) - 128;
+            (antialias ? drawLineAntialiased : drawLine)(x, y, x1, y1, color);
+        }
+    }
+    return (double)(timerNow() - start)/ANTIALIAS_SHAPES;
+}
+
+/**
+ * Times the blend kernels on every supported instruction set against the scalar one,
+ * then the anti-aliased circles, lines and busy frame against the aliased ones.
+ * @return false if it couldn't run.
+*/
+static bool benchmarkAntialias(void) {
+    int width = frame.width;
+    uint8_t *coverage = malloc(width > 0 ? width : 1);
+    if (!coverage || width == 0 || frame.height == 0) {
+        free(coverage);
+        return false;
+    }
+    frameResetClip();
+
+    //Half transparent color over every row, with a different coverage per pixel
+    struct Random random;
+    randomSeed(&random, 1);
+    for (int x = 0; x < width; x++) {
+        coverage[x] = (uint8_t)randomNext(&random);
+    }
+    uint32_t color = blendPremultiply(0x3080F0, 128);
+    enum SimdLevel best = blendGetLevel();
+    uint64_t reference = 0;
+    double scalar_ns = 0;
+    for (int level = 0; level < SIMD_LEVEL_COUNT; level++) {
+        if (!blendSetLevel(level)) {
+            continue;
+        }
+        fillClear(0x00204060);
+        uint64_t start = timerNow();
+        for (int i = 0; i < BLEND_REPETITIONS; i++) {
+            for (int y = 0; y < frame.height; y++) {
+                blendSpan(frame.pixels + (size_t)y*frame.stride, coverage, width, color);
+            }
+        }
+        double ns = (double)(timerNow() - start)/((double)BLEND_REPETITIONS*width*frame.height);
+        if (level == SIMD_SCALAR) {
+            scalar_ns = ns;
+            reference = frameChecksum();
+        }
+        printf("blend size=%dx%d kernel=%s ns_per_pixel=%.3f speedup=%.2f match=%s\n",
+               width, frame.height, simdLevelName(level), ns, scalar_ns/ns,
+               frameChecksum() == reference ? "yes" : "no");
+    }
+    blendSetLevel(best);
+    free(coverage);
+
+    static const char *shapes[] = {"circle_outline", "circle_filled", "line"};
+    for (int kind = 0; kind < 3; kind++) {
+        double aliased_ns = timeShapes(kind, false);
+        double antialiased_ns = timeShapes(kind, true);
+        printf("antialias shape=%s aliased_ns=%.1f antialiased_ns=%.1f cost=%.2fx\n",
+               shapes[kind], aliased_ns, antialiased_ns, antialiased_ns/aliased_ns);
+    }
+
+    //The busy frame of the threads benchmark, where most of the time goes into filling
+    struct CommandList list;
+    commandListInit(&list);
+    double frame_ms[2];
+    for (int antialias = 0; antialias < 2; antialias++) {
+        commandListReset(&list);
+        commandListSetAntialias(&list, antialias);
+        recordMixedFrame(&list);
+        uint64_t start = timerNow();
+        for (int i = 0; i < THREAD_FRAMES; i++) {
+            commandListExecute(&list);
+        }
+        frame_ms[antialias] = (double)(timerNow() - start)/THREAD_FRAMES*1e-6;
+    }
+    printf("antialias shape=mixed_frame aliased_ms=%.3f antialiased_ms=%.3f cost=%.2fx\n",
+           frame_ms[0], frame_ms[1], frame_ms[1]/frame_ms[0]);
+    commandListFree(&list);
+    return true;
+}
+
+/**
+ * Draws random points into a 4K frame: scattered straight into the frame in
+ * submission order, sorted into bins on one thread, and through the renderer
+ * with 2 threads and one per CPU, which sorts them on every thread.
+ * There are more points than pixels in the bigger batches, so plenty of pixels
+ * are set several times and the sorted frames are checked against the scattered one.
+ * @return false if it couldn't run.
+*/
+static bool benchmarkPoints(void) {
+    int width = frame.width;
+    int height = frame.height;
+    if (!frameResize(POINT_FRAME_WIDTH, POINT_FRAME_HEIGHT)) {
+        printf("points size=%dx%d error=allocation\n", POINT_FRAME_WIDTH, POINT_FRAME_HEIGHT);
+        return false;
+    }
+
+    struct CommandList list;
+    commandListInit(&list);
+    struct PointBins bins;
+    pointBinsInit(&bins);
+    int thread_counts[] = {2, threadCpuCount()};
+    for (size_t size = 0; size < sizeof(point_counts)/sizeof(point_counts[0]); size++) {
+        int count = point_counts[size];
+        struct Random random;
+        randomSeed(&random, 1);
+        uint32_t *indices;
+        uint32_t *colors;
+        commandListReset(&list);
+        commandListPoints(&list, count, &indices, &colors);
+        randomFillBelow(&random, indices, count, (uint32_t)frame.width*frame.height);
+        randomFill(&random, colors, count);
+
+        fillClear(0);
+        frameResetClip();
+        uint64_t start = timerNow();
+        for (int i = 0; i < POINT_REPETITIONS; i++) {
+            commandListExecute(&list);
+        }
+        double scatter_ms = (double)(timerNow() - start)/POINT_REPETITIONS*1e-6;
+        uint64_t reference = frameChecksum();
+        printf("points size=%dx%d count=%d method=scatter threads=1 ms=%.2f ns_per_point=%.2f\n",
+               frame.width, frame.height, count, scatter_ms, scatter_ms*1e6/count);
+
+        fillClear(0);
+        start = timerNow();
+        for (int i = 0; i < POINT_REPETITIONS; i++) {
+            pointBinsSort(&bins, indices, colors, count);
+            pointBinsDraw(&bins);
+        }
+        double ms = (double)(timerNow() - start)/POINT_REPETITIONS*1e-6;
+        printf("points size=%dx%d count=%d method=sorted threads=1 ms=%.2f ns_per_point=%.2f speedup=%.2f match=%s\n",
+               frame.width, frame.height, count, ms, ms*1e6/count, scatter_ms/ms,
+               frameChecksum() == reference ? "yes" : "no");
+
+        for (size_t threads = 0; threads < sizeof(thread_counts)/sizeof(thread_counts[0]); threads++) {
+            if (threads > 0 && thread_counts[threads] <= thread_counts[0]) {
+                break;
+            }
+            struct Renderer *renderer = rendererCreate(thread_counts[threads]);
+            if (!renderer) {
+                printf("points count=%d threads=%d error=create\n", count, thread_counts[threads]);
+                break;
+            }
+            fillClear(0);
+            start = timerNow();
+            for (int i = 0; i < POINT_REPETITIONS; i++) {
+                rendererExecute(renderer, &list);
+            }
+            ms = (double)(timerNow() - start)/POINT_REPETITIONS*1e-6;
+            printf("points size=%dx%d count=%d method=renderer threads=%d ms=%.2f ns_per_point=%.2f speedup=%.2f match=%s\n",
+                   frame.width, frame.height, count, rendererThreadCount(renderer), ms, ms*1e6/count,
+                   scatter_ms/ms, frameChecksum() == reference ? "yes" : "no");
+            rendererDestroy(renderer);
+        }
+    }
+
+    pointBinsFree(&bins);
+    commandListFree(&list);
+    frameResize(width, height);
+    return true;
+}
+
+/** How the arguments of a rasterizer in the raster benchmark are laid out. */
+enum RasterKind {
+    //x, y and a size: circles and their radius, the animation's triangle and its side length, spans
+    RASTER_CENTERED,
+    //x0 y0 x1 y1 x2 y2
+    RASTER_TRIANGLE,
+    //x0 y0 x1 y1
+    RASTER_LINE,
+    //x y
+    RASTER_POINT
+};
+
+/** The situations the raster benchmark draws every rasterizer in. */
+enum RasterCase {
+    //Shapes on the frame, up to half its size
+    RASTER_CASE_INSIDE,
+    //Shapes anywhere from one frame before to one frame past the edges, most of them off it
+    RASTER_CASE_OFFSCREEN,
+    //Radius 0 and 1, lines of 0 and 1 pixels and degenerate triangles, on and just past the edges
+    RASTER_CASE_TINY,
+    //Shapes up to 4 times bigger than the frame
+    RASTER_CASE_HUGE,
+    RASTER_CASE_COUNT
+};
+
+//Name of each raster case in the output.
+static const char *const raster_case_names[RASTER_CASE_COUNT] = {"inside", "offscreen", "tiny", "huge"};
+
+//Each rasterizer called with its arguments from an array of 6, so the raster benchmark
+//can make up and draw shapes the same way for all of them. Colors go unused by the
+//animation's circle and triangle, which draw in their own colors.
+static void rasterCircleOutline(const int *args, uint32_t color) {
+    circleOutline(args[0], args[1], args[2], color);
+}
+
+static void rasterCircleFilled(const int *args, uint32_t color) {
+    circleFilled(args[0], args[1], args[2], color);
+}
+
+static void rasterCircleOutlineAntialiased(const int *args, uint32_t color) {
+    circleOutlineAntialiased(args[0], args[1], args[2], color);
+}
+
+static void rasterCircleFilledAntialiased(const int *args, uint32_t color) {
+    circleFilledAntialiased(args[0], args[1], args[2], color);
+}
+
+static void rasterDrawCircle(const int *args, uint32_t color) {
+    (void)color;
+    drawCircle(args[0], args[1], args[2]);
+}
+
+static void rasterDrawTriangle(const int *args, uint32_t color) {
+    (void)color;
+    drawTriangle(args[0], args[1], args[2]);
+}
+
+static void rasterTriangleFilled(const int *args, uint32_t color) {
+    triangleFilled(args[0], args[1], args[2], args[3], args[4], args[5], color);
+}
+
+static void rasterLine(const int *args, uint32_t color) {
+    drawLine(args[0], args[1], args[2], args[3], color);
+}
+
+static void rasterLineAntialiased(const int *args, uint32_t color) {
+    drawLineAntialiased(args[0], args[1], args[2], args[3], color);
+}
+
+static void rasterHorizontalSpan(const int *args, uint32_t color) {
+    drawHorizontalSpan(args[1], args[0] - args[2], args[0] + args[2], color);
+}
+
+static void rasterVerticalSpan(const int *args, uint32_t color) {
+    drawVerticalSpan(args[0], args[1] - args[2], args[1] + args[2], color);
+}
+
+static void rasterPoint(const int *args, uint32_t color) {
+    //Points are given as indices, so only ones with x on the frame are the pixel they name
+    uint32_t index = args[0] >= 0 && args[0] < frame.width ? (uint32_t)args[0] + (uint32_t)args[1]*frame.width : UINT32_MAX;
+    pointsDraw(&index, &color, 1);
+}
+
+//Every rasterizer the raster benchmark checks and times, with the checksums of its
+//golden images: each case drawn at every size in raster_sizes, folded together.
+static const struct {
+    const char *name;
+    enum RasterKind kind;
+    void (*draw)(const int *args, uint32_t color);
+    uint64_t golden[RASTER_CASE_COUNT];
+} rasterizers[] = {
+    {"circle_outline", RASTER_CENTERED, rasterCircleOutline,
+     {0x1aacce07e13050eaull, 0x03e0c3c0b7db4f72ull,
+      0xfb00951510c2fdf8ull, 0x5cc05a4f15493c72ull}},
+    {"circle_filled", RASTER_CENTERED, rasterCircleFilled,
+     {0x55be02c811dcca80ull, 0x4fea3c2cf38106cfull,
+      0xf523f4c0d5f340b8ull, 0x60ddb0ff2eac24dbull}},
+    {"circle_outline_aa", RASTER_CENTERED, rasterCircleOutlineAntialiased,
+     {0x983f4ffe24cfeff5ull, 0x0392638e225a6c6bull,
+      0xf9ae1e16b2b31cf4ull, 0xcfbcd327bb76700eull}},
+    {"circle_filled_aa", RASTER_CENTERED, rasterCircleFilledAntialiased,
+     {0xc5562a6b7ae30752ull, 0x8f90fcdcdd754518ull,
+      0xf523f4c0d5f340b8ull, 0x20e76cbdeceee7faull}},
+    {"draw_circle", RASTER_CENTERED, rasterDrawCircle,
+     {0xfa523e30da1be7f6ull, 0x1e4dd6bfc5f66793ull,
+      0xbf74904b07b644b3ull, 0x088b9877a5d38517ull}},
+    {"draw_triangle", RASTER_CENTERED, rasterDrawTriangle,
+     {0x866edea5895c1d28ull, 0x357138d9152cafe6ull,
+      0x1d950a25418397c4ull, 0x7d90552455383883ull}},
+    {"triangle_filled", RASTER_TRIANGLE, rasterTriangleFilled,
+     {0xfbd61713af5a7dcfull, 0xb8467ce46c7c19d5ull,
+      0xda5058111e303fb4ull, 0xd3b9926a26e543edull}},
+    {"line", RASTER_LINE, rasterLine,
+     {0x1d95b02a8455ab87ull, 0x2b5e60f872b5fd72ull,
+      0xb75673db41f99e50ull, 0x085ffedeed46d602ull}},
+    {"line_aa", RASTER_LINE, rasterLineAntialiased,
+     {0x2d429371db4a8553ull, 0xab7991b0dbcc9104ull,
+      0xf2f126d6bc1b7560ull, 0x2cd517b644585250ull}},
+    {"horizontal_span", RASTER_CENTERED, rasterHorizontalSpan,
+     {0xb40bd91e7b9e2ceeull, 0x0814c79b6f59a5bfull,
+      0x2cfad4c8f6a0f378ull, 0xb04b3cb268eb9d8eull}},
+    {"vertical_span", RASTER_CENTERED, rasterVerticalSpan,
+     {0x074a49eb2ceef18aull, 0x3ec67ba1eaa4a5ecull,
+      0xb132ffc1c9ed9064ull, 0x80019440f875e115ull}},
+    {"point", RASTER_POINT, rasterPoint,
+     {0xae4c0656b8f03474ull, 0x2bc4c20446516299ull,
+      0x058c766708a6d154ull, 0x41c5129718dfc094ull}},
+};
+
+/**
+ * Draws a random number from low to high, both included.
+ * @param random The generator.
+ * @param low Smallest possible result.
+ * @param high Largest possible result.
+ * @return The number.
+*/
+static int randomBetween(struct Random *random, int low, int high) {
+    return low + (int)randomBelow(random, (uint32_t)(high - low + 1));
+}
+
+/**
+ * Draws a coordinate on or just past the edges of the frame.
+ * @param random The generator.
+ * @param size Width or height of the frame.
+ * @return The coordinate.
+*/
+static int randomEdge(struct Random *random, int size) {
+    const int edges[] = {-1, 0, 1, size/2, size - 2, size - 1, size};
+    return edges[randomBelow(random, sizeof(edges)/sizeof(edges[0]))];
+}
+
+/**
+ * Makes up the arguments of one shape for a raster case.
+ * @param shape_case The case.
+ * @param kind How the arguments are laid out.
+ * @param random The generator.
+ * @param args Set to the arguments, 6 of them whatever the kind.
+*/
+static void rasterShape(enum RasterCase shape_case, enum RasterKind kind, struct Random *random, int *args) {
+    int width = frame.width;
+    int height = frame.height;
+    int extent = width > height ? width : height;
+    for (int i = 0; i < 6; i += 2) {
+        if (shape_case == RASTER_CASE_INSIDE) {
+            args[i] = randomBetween(random, 0, width - 1);
+            args[i + 1] = randomBetween(random, 0, height - 1);
+        } else if (shape_case == RASTER_CASE_OFFSCREEN) {
+            args[i] = randomBetween(random, -width, 2*width);
+            args[i + 1] = randomBetween(random, -height, 2*height);
+        } else if (shape_case == RASTER_CASE_TINY) {
+            args[i] = randomEdge(random, width);
+            args[i + 1] = randomEdge(random, height);
+        } else {
+            args[i] = randomBetween(random, -4*extent, 4*extent);
+            args[i + 1] = randomBetween(random, -4*extent, 4*extent);
+        }
+    }
+
+    if (kind == RASTER_CENTERED) {
+        int smaller = width < height ? width : height;
+        int sizes[RASTER_CASE_COUNT][2] = {{0, smaller/2}, {0, extent}, {0, 1}, {extent, 4*extent}};
+        args[2] = randomBetween(random, sizes[shape_case][0], sizes[shape_case][1]);
+    } else if (shape_case == RASTER_CASE_TINY && randomBelow(random, 2) == 0) {
+        //Every other vertex within a pixel of the first
+        for (int i = 2; i < 6; i++) {
+            args[i] = args[i%2] + randomBetween(random, -1, 1);
+        }
+    } else if (shape_case == RASTER_CASE_TINY) {
+        //The rest in a straight line, so the triangles have no area
+        int step_x = randomBetween(random, -extent, extent);
+        int step_y = randomBetween(random, -extent, extent);
+        for (int i = 2; i < 6; i += 2) {
+            args[i] = args[i - 2] + step_x;
+            args[i + 1] = args[i - 1] + step_y;
+        }
+    }
+}
+
+/**
+ * Draws the golden image of one rasterizer and case at every frame size.
+ * The checksum doesn't depend on the layout, so both layouts have the same golden images.
+ * @param rasterizer Index into rasterizers.
+ * @param shape_case The case.
+ * @param layout Layout of the frame to draw into.
+ * @return The checksums of the frames, folded together.
+*/
+static uint64_t rasterGolden(int rasterizer, enum RasterCase shape_case, enum FrameLayout layout) {
+    uint64_t checksum = 0;
+    if (!frameSetLayout(layout)) {
+        return 0;
+    }
+    for (size_t size = 0; size < sizeof(raster_sizes)/sizeof(raster_sizes[0]); size++) {
+        if (!frameResize(raster_sizes[size].width, raster_sizes[size].height)) {
+            return 0;
+        }
+        //Same shapes on every run, whichever rasterizers come before this one
+        struct Random random;
+        randomSeed(&random, 1 + shape_case);
+        fillClear(0);
+        for (int i = 0; i < RASTER_CASE_SHAPES; i++) {
+            int args[6];
+            rasterShape(shape_case, rasterizers[rasterizer].kind, &random, args);
+            rasterizers[rasterizer].draw(args, randomNext(&random) & 0x00FFFFFF);
+        }
+        checksum = checksum*0x100000001b3ull ^ frameChecksum();
+    }
+    return checksum;
+}
+
+/**
+ * Makes up a shape which lies inside a square of the frame.
+ * @param kind How the arguments are laid out.
+ * @param extent Side of the square, in pixels. Must be smaller than the frame.
+ * @param random The generator.
+ * @param args Set to the arguments.
+ * @param box Set to the square, bottom left corner then the side.
+*/
+static void rasterTimedShape(enum RasterKind kind, int extent, struct Random *random, int *args, int *box) {
+    box[0] = randomBetween(random, 1, frame.width - extent - 2);
+    box[1] = randomBetween(random, 1, frame.height - extent - 2);
+    box[2] = extent + 1;
+    if (kind == RASTER_CENTERED) {
+        args[2] = randomBetween(random, 0, extent/2);
+        args[0] = box[0] + extent/2;
+        args[1] = box[1] + extent/2;
+        return;
+    }
+    for (int i = 0; i < 6; i += 2) {
+        args[i] = box[0] + randomBetween(random, 0, extent);
+        args[i + 1] = box[1] + randomBetween(random, 0, extent);
+    }
+}
+
+/**
+ * Times one rasterizer on shapes up to one extent, and counts the pixels
+ * the first few of them set to work out how many pixels per second that is.
+ * @param rasterizer Index into rasterizers.
+ * @param extent Largest extent of the shapes, in pixels.
+*/
+static void rasterTime(int rasterizer, int extent) {
+    enum RasterKind kind = rasterizers[rasterizer].kind;
+    struct Random random;
+
+    //Every counted shape is drawn on its own into a cleared square, with a color which is never 0
+    int64_t pixels = 0;
+    fillClear(0);
+    randomSeed(&random, 1);
+    for (int i = 0; i < RASTER_COUNTED_SHAPES; i++) {
+        int args[6];
+        int box[3];
+        rasterTimedShape(kind, extent, &random, args, box);
+        rasterizers[rasterizer].draw(args, randomNext(&random) | 0x00808080);
+        for (int y = box[1] - 1; y <= box[1] + box[2]; y++) {
+            for (int x = box[0] - 1; x <= box[0] + box[2]; x++) {
+                pixels += frame.pixels[x + (size_t)y*frame.stride] != 0;
+            }
+        }
+        fillRect(box[0] - 1, box[1] - 1, box[2] + 2, box[2] + 2, 0);
+    }
+
+    randomSeed(&random, 1);
+    uint64_t start = timerNow();
+    for (int i = 0; i < RASTER_TIMED_SHAPES; i++) {
+        int args[6];
+        int box[3];
+        rasterTimedShape(kind, extent, &random, args, box);
+        rasterizers[rasterizer].draw(args, randomNext(&random) | 0x00808080);
+    }
+    double ns = (double)(timerNow() - start)/RASTER_TIMED_SHAPES;
+    double pixels_per_shape = (double)pixels/RASTER_COUNTED_SHAPES;
+    printf("raster shape=%s extent=%d frame=%dx%d ns_per_shape=%.1f pixels_per_shape=%.1f mpixels_per_s=%.1f\n",
+           rasterizers[rasterizer].name, extent, frame.width, frame.height, ns, pixels_per_shape,
+           pixels_per_shape/ns*1e3);
+}
+
+/**
+ * Checks every rasterizer against its golden images, in every case, at every
+ * size in raster_sizes and in both layouts, then times each one at the current frame size.
+ * A line with match=no means a rasterizer draws different pixels than it used to.
+ * @return true if every rasterizer drew its golden images.
+*/
+static bool benchmarkRaster(void) {
+    int width = frame.width;
+    int height = frame.height;
+    int rasterizer_count = (int)(sizeof(rasterizers)/sizeof(rasterizers[0]));
+
+    int mismatches = 0;
+    for (int layout = 0; layout < FRAME_LAYOUT_COUNT; layout++) {
+        for (int rasterizer = 0; rasterizer < rasterizer_count; rasterizer++) {
+            for (int shape_case = 0; shape_case < RASTER_CASE_COUNT; shape_case++) {
+                uint64_t checksum = rasterGolden(rasterizer, shape_case, layout);
+                uint64_t golden = rasterizers[rasterizer].golden[shape_case];
+                mismatches += checksum != golden;
+                printf("raster shape=%s case=%s layout=%s checksum=%016llx golden=%016llx match=%s\n",
+                       rasterizers[rasterizer].name, raster_case_names[shape_case], frameLayoutName(layout),
+                       (unsigned long long)checksum, (unsigned long long)golden, checksum == golden ? "yes" : "no");
+            }
+        }
+    }
+    printf("raster golden_images=%d mismatches=%d\n", FRAME_LAYOUT_COUNT*rasterizer_count*RASTER_CASE_COUNT,
+           mismatches);
+
+    if (!frameSetLayout(FRAME_LAYOUT_ROWS) || !frameResize(width, height)) {
+        return false;
+    }
+    for (int rasterizer = 0; rasterizer < rasterizer_count; rasterizer++) {
+        for (size_t extent = 0; extent < sizeof(raster_extents)/sizeof(raster_extents[0]); extent++) {
+            //Points are the same whatever the extent
+            if (raster_extents[extent] + 4 > frame.width || raster_extents[extent] + 4 > frame.height
+                || (extent > 0 && rasterizers[rasterizer].kind == RASTER_POINT)) {
+                continue;
+            }
+            rasterTime(rasterizer, raster_extents[extent]);
+        }
+    }
+    return mismatches == 0;
+}
+
+/** What the layout benchmark draws. */
+enum LayoutWorkload {
+    //Circle outlines, radius up to a third of the frame height
+    LAYOUT_CIRCLES,
+    //Filled triangles up to 64 pixels wide and 256 tall
+    LAYOUT_TRIANGLES,
+    //Lines at most 1 pixel across for every 4 pixels up
+    LAYOUT_STEEP_LINES,
+    //Lines at most 1 pixel up for every 4 pixels across
+    LAYOUT_FLAT_LINES,
+    //Random points all over the frame
+    LAYOUT_POINTS_WORKLOAD,
+    //The busy frame of the threads benchmark
+    LAYOUT_MIXED,
+    LAYOUT_WORKLOAD_COUNT
+};
+
+//Name of each layout workload in the output.
+static const char *const layout_workload_names[LAYOUT_WORKLOAD_COUNT] = {
+    "circles", "triangles", "steep_lines", "flat_lines", "points", "mixed"
+};
+
+/**
+ * Records one workload of the layout benchmark for the current frame size.
+ * @param workload The workload.
+ * @param list The list to record into, emptied first.
+*/
+static void recordLayoutWorkload(enum LayoutWorkload workload, struct CommandList *list) {
+    struct Random random;
+    randomSeed(&random, 1);
+    uint32_t width = frame.width;
+    uint32_t height = frame.height;
+    commandListReset(list);
+
+    switch (workload) {
+        case LAYOUT_CIRCLES:
+            for (int i = 0; i < 200; i++) {
+                commandListCircleOutline(list, randomBelow(&random, width), randomBelow(&random, height),
+                                         randomBelow(&random, height/3 + 1), randomNext(&random));
+            }
+            break;
+        case LAYOUT_TRIANGLES:
+            for (int i = 0; i < 2000; i++) {
+                int x = randomBelow(&random, width);
+                int y = randomBelow(&random, height);
+                commandListTriangleFilled(list, x, y,
+                                          x + randomBelow(&random, 32), y + randomBelow(&random, 256),
+                                          x - randomBelow(&random, 32), y + randomBelow(&random, 256),
+                                          randomNext(&random));
+            }
+            break;
+        case LAYOUT_STEEP_LINES:
+        case LAYOUT_FLAT_LINES:
+            for (int i = 0; i < 2000; i++) {
+                int x = randomBelow(&random, width);
+                int y = randomBelow(&random, height);
+                int along = randomBelow(&random, height/2 + 1);
+                int across = randomBelow(&random, along/4 + 1);
+                if (workload == LAYOUT_STEEP_LINES) {
+                    commandListLine(list, x, y, x + across, y + along, randomNext(&random));
+                } else {
+                    commandListLine(list, x, y, x + along, y + across, randomNext(&random));
+                }
+            }
+            break;
+        case LAYOUT_POINTS_WORKLOAD: {
+            uint32_t *indices;
+            uint32_t *colors;
+            commandListPoints(list, LAYOUT_POINTS, &indices, &colors);
+            randomFillBelow(&random, indices, LAYOUT_POINTS, width*height);
+            randomFill(&random, colors, LAYOUT_POINTS);
+        } break;
+        default:
+            recordMixedFrame(list);
+            break;
+    }
+}
+
+/**
+ * Draws circles, triangles, lines, points and the busy frame of the threads benchmark
+ * into a frame stored row by row and one stored in tiles, checking both give the same frame,
+ * then times reading the whole frame back out row by row, which a tiled frame needs
+ * to be untiled for. Each workload is drawn over itself a few times without clearing,
+ * so only the shapes are timed.
+ * @return true, nothing in it can fail.
+*/
+static bool benchmarkLayout(void) {
+    int width = frame.width;
+    int height = frame.height;
+    struct CommandList list;
+    commandListInit(&list);
+    frameResetClip();
+
+    for (size_t size = 0; size < sizeof(layout_sizes)/sizeof(layout_sizes[0]); size++) {
+        if (!frameResize(layout_sizes[size].width, layout_sizes[size].height)) {
+            printf("layout size=%dx%d error=allocation\n", layout_sizes[size].width, layout_sizes[size].height);
+            break;
+        }
+
+        for (int workload = 0; workload < LAYOUT_WORKLOAD_COUNT; workload++) {
+            recordLayoutWorkload(workload, &list);
+            double ms[FRAME_LAYOUT_COUNT] = {0};
+            uint64_t checksums[FRAME_LAYOUT_COUNT] = {0};
+            for (int layout = 0; layout < FRAME_LAYOUT_COUNT; layout++) {
+                if (!frameSetLayout(layout)) {
+                    break;
+                }
+                fillClear(0);
+                uint64_t start = timerNow();
+                for (int i = 0; i < LAYOUT_REPETITIONS; i++) {
+                    commandListExecute(&list);
+                }
+                ms[layout] = (double)(timerNow() - start)/LAYOUT_REPETITIONS*1e-6;
+                checksums[layout] = frameChecksum();
+            }
+            printf("layout workload=%s size=%dx%d rows_ms=%.3f tiles_ms=%.3f speedup=%.2f match=%s\n",
+                   layout_workload_names[workload], frame.width, frame.height,
+                   ms[FRAME_LAYOUT_ROWS], ms[FRAME_LAYOUT_TILES], ms[FRAME_LAYOUT_ROWS]/ms[FRAME_LAYOUT_TILES],
+                   checksums[FRAME_LAYOUT_ROWS] == checksums[FRAME_LAYOUT_TILES] ? "yes" : "no");
+        }
+
+        //What presenting or capturing a whole frame costs in each layout
+        uint32_t *pixels = malloc((size_t)frame.width*frame.height*sizeof(uint32_t));
+        if (!pixels) {
+            printf("layout size=%dx%d error=allocation\n", frame.width, frame.height);
+            break;
+        }
+        struct FrameRect whole = {0, 0, frame.width, frame.height};
+        double ms[FRAME_LAYOUT_COUNT] = {0};
+        for (int layout = 0; layout < FRAME_LAYOUT_COUNT; layout++) {
+            if (!frameSetLayout(layout)) {
+                break;
+            }
+            frameReadPixels(&whole, pixels, frame.width);
+            uint64_t start = timerNow();
+            for (int i = 0; i < LAYOUT_REPETITIONS; i++) {
+                frameReadPixels(&whole, pixels, frame.width);
+            }
+            ms[layout] = (double)(timerNow() - start)/LAYOUT_REPETITIONS*1e-6;
+        }
+        double bytes = (double)frame.width*frame.height*sizeof(uint32_t);
+        printf("layout op=read_frame size=%dx%d rows_ms=%.3f tiles_ms=%.3f rows_gb_per_s=%.2f tiles_gb_per_s=%.2f\n",
+               frame.width, frame.height, ms[FRAME_LAYOUT_ROWS], ms[FRAME_LAYOUT_TILES],
+               bytes/(ms[FRAME_LAYOUT_ROWS]*1e6), bytes/(ms[FRAME_LAYOUT_TILES]*1e6));
+        free(pixels);
+    }
+
+    commandListFree(&list);
+    frameSetLayout(FRAME_LAYOUT_ROWS);
+    frameResize(width, height);
+    return true;
+}
+
+/**
+ * Records one frame of the retained benchmark, the random scene with circles moving over it.
+ * @param scene The scene, which doesn't move.
+ * @param moving Number of circles moving over it.
+ * @param step How far along the circles are.
+ * @param list The list to record into, emptied first.
+*/
+static void recordRetainedFrame(const struct Scene *scene, int moving, int step, struct CommandList *list) {
+    commandListReset(list);
+    sceneRecord(scene, list);
+    for (int i = 0; i < moving; i++) {
+        commandListCircleFilled(list, (i*97 + step*4)%frame.width, (i*53 + 20)%frame.height, 24, 0x00FF8000 + i);
+    }
+}
+
+/**
+ * Draws the 100000 shape scene with a few circles moving over it, every shape every frame
+ * through the renderer vs retained, where a frame only rasterizes the circles which moved
+ * and repaints what was under them. Recording is the same both ways and isn't timed.
+ * @return false if it couldn't run.
+*/
+static bool benchmarkRetained(void) {
+    struct Scene scene;
+    struct Renderer *renderer = rendererCreate(0);
+    if (frame.width == 0 || frame.height == 0 || !renderer || !sceneCreate(&scene, scene_counts)) {
+        rendererDestroy(renderer);
+        return false;
+    }
+    randomScene(&scene);
+    struct CommandList list;
+    commandListInit(&list);
+
+    for (size_t moving = 0; moving < sizeof(retained_moving)/sizeof(retained_moving[0]); moving++) {
+        uint64_t immediate_ns = 0;
+        for (int step = 1; step <= RETAINED_FRAMES; step++) {
+            recordRetainedFrame(&scene, retained_moving[moving], step, &list);
+            uint64_t start = timerNow();
+            rendererExecute(renderer, &list);
+            immediate_ns += timerNow() - start;
+            dirtyReset();
+        }
+        uint64_t reference = frameChecksum();
+
+        //The first frame rasterizes and paints every shape
+        struct Retained retained;
+        retainedInit(&retained, 0);
+        recordRetainedFrame(&scene, retained_moving[moving], 0, &list);
+        uint64_t start = timerNow();
+        retainedDrawList(&retained, &list);
+        uint64_t first_ns = timerNow() - start;
+        dirtyReset();
+
+        uint64_t retained_ns = 0;
+        int64_t rasterized = 0;
+        int64_t painted = 0;
+        for (int step = 1; step <= RETAINED_FRAMES; step++) {
+            recordRetainedFrame(&scene, retained_moving[moving], step, &list);
+            start = timerNow();
+            retainedDrawList(&retained, &list);
+            retained_ns += timerNow() - start;
+            rasterized += retained.rasterized;
+            painted += retained.painted;
+            dirtyReset();
+        }
+        printf("retained shapes=%d moving=%d immediate_ms=%.3f retained_ms=%.3f speedup=%.1f first_frame_ms=%.3f "
+               "rasterized=%.1f painted=%.1f match=%s\n",
+               retained.shape_count, retained_moving[moving], immediate_ns*1e-6/RETAINED_FRAMES,
+               retained_ns*1e-6/RETAINED_FRAMES, (double)immediate_ns/(retained_ns > 0 ? retained_ns : 1),
+               first_ns*1e-6, (double)rasterized/RETAINED_FRAMES, (double)painted/RETAINED_FRAMES,
+               frameChecksum() == reference ? "yes" : "no");
+        retainedFree(&retained);
+    }
+
+    commandListFree(&list);
+    sceneFree(&scene);
+    rendererDestroy(renderer);
+    return true;
+}
+
+/**
+ * Draws a line of text a pixel at a time, testing each bit and clipping each pixel,
+ * the way text would be drawn without the expanding blitter. Baseline for the text benchmark.
+ * @param x x coordinate of the left column of the text
+ * @param y y coordinate of the bottom row of the text
+ * @param text The text.
+ * @param color Color of the glyphs.
+ * @param background Color of the rest of each character's cell.
+*/
+static void textDrawPerPixel(int x, int y, const char *text, uint32_t color, uint32_t background) {
+    struct FrameRect clip = frameClip();
+    for (int i = 0; text[i]; i++) {
+        const uint8_t *glyph = textGlyph(text[i]);
+        for (int row = 0; row < TEXT_GLYPH_HEIGHT; row++) {
+            for (int column = 0; column < TEXT_GLYPH_WIDTH; column++) {
+                int pixel_x = x + i*TEXT_GLYPH_WIDTH + column;
+                int pixel_y = y + TEXT_GLYPH_HEIGHT - 1 - row;
+                if (pixel_x >= clip.x_min && pixel_x < clip.x_max && pixel_y >= clip.y_min && pixel_y < clip.y_max) {
+                    frame.pixels[frameOffset(pixel_x, pixel_y)] = glyph[row] & (0x80 >> column) ? color : background;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Draws lines of counters like the overlay's, some of them cut off by the edges of the frame,
+ * a pixel at a time, with the expanding blitter and through text runs which are only
+ * copied into the frame, checking all three draw the same pixels in both frame layouts.
+ * @return false if it couldn't run.
+*/
+static bool benchmarkText(void) {
+    if (frame.width == 0 || frame.height == 0) {
+        return false;
+    }
+    static const char *const methods[] = {"per_pixel", "expand", "cached"};
+    char lines[TEXT_LINES][64];
+    int positions[TEXT_LINES][2];
+    struct TextRun runs[TEXT_LINES];
+    struct Random random;
+    randomSeed(&random, 1);
+    int64_t pixels = 0;
+    for (int line = 0; line < TEXT_LINES; line++) {
+        snprintf(lines[line], sizeof(lines[line]), "%.1f fps  %d shapes  radius %d  side %d",
+                 randomBelow(&random, 10000)*0.1, (int)randomBelow(&random, 100000),
+                 (int)randomBelow(&random, 1000), (int)randomBelow(&random, 1000));
+        int width = textWidth(lines[line]);
+        positions[line][0] = (int)randomBelow(&random, frame.width + width) - width/2;
+        positions[line][1] = (int)randomBelow(&random, frame.height + TEXT_GLYPH_HEIGHT) - TEXT_GLYPH_HEIGHT/2;
+        pixels += (int64_t)width*TEXT_GLYPH_HEIGHT;
+        textRunInit(&runs[line]);
+    }
+    frameResetClip();
+
+    for (int layout = 0; layout < FRAME_LAYOUT_COUNT; layout++) {
+        if (!frameSetLayout(layout)) {
+            break;
+        }
+        uint64_t reference = 0;
+        for (int method = 0; method < 3; method++) {
+            fillClear(0);
+            uint64_t start = timerNow();
+            for (int i = 0; i < TEXT_REPETITIONS; i++) {
+                for (int line = 0; line < TEXT_LINES; line++) {
+                    int x = positions[line][0];
+                    int y = positions[line][1];
+                    uint32_t color = 0x00E0E0E0;
+                    if (method == 0) {
+                        textDrawPerPixel(x, y, lines[line], color, 0x00101010);
+                    } else if (method == 1) {
+                        textDraw(x, y, lines[line], color, 0x00101010);
+                    } else {
+                        textRunDraw(&runs[line], x, y, lines[line], color, 0x00101010);
+                    }
+                }
+            }
+            double seconds = (timerNow() - start)*1e-9;
+            uint64_t checksum = frameChecksum();
+            reference = method == 0 ? checksum : reference;
+            printf("text method=%s layout=%s lines=%d ns_per_line=%.1f mpixels_per_s=%.1f match=%s\n",
+                   methods[method], frameLayoutName(layout), TEXT_LINES,
+                   seconds*1e9/((double)TEXT_REPETITIONS*TEXT_LINES),
+                   seconds > 0 ? pixels*TEXT_REPETITIONS/seconds*1e-6 : 0.0, checksum == reference ? "yes" : "no");
+        }
+    }
+
+    for (int line = 0; line < TEXT_LINES; line++) {
+        textRunFree(&runs[line]);
+    }
+    frameSetLayout(FRAME_LAYOUT_ROWS);
+    return true;
+}
+
+//Every benchmark, by the name it is started with.
+static const struct {
+    const char *name;
+    const char *description;
+    bool (*run)(void);
+} benchmarks[] = {
+    {"circle", "sqrt circle vs midpoint circle, radii up to frame.height/3", benchmarkCircle},
+    {"triangle", "filled triangles with random vertices, 8 to 512 pixels across", benchmarkTriangle},
+    {"threads", "busy frame rendered with 1 to one thread per CPU, checked against single threaded", benchmarkThreads},
+    {"fill", "fill kernels vs the scalar loop: clear, rectangle and spans at 1080p/1440p/4K", benchmarkFill},
+    {"random", "rand() and % vs the batched generator on each instruction set, picking random pixels", benchmarkRandom},
+    {"yuv", "BGRA to 4:2:0 YUV conversion for Y4M capture on each instruction set", benchmarkYuv},
+    {"antialias", "blend kernels on each instruction set, anti-aliased circles and lines vs aliased", benchmarkAntialias},
+    {"points", "1M to 10M random points on a 4K frame, scattered in order vs sorted into bins", benchmarkPoints},
+    {"raster", "every rasterizer checked against its golden images, then ns per shape and pixels per second", benchmarkRaster},
+    {"scene", "100000 shape scene recorded per shape vs as batches, and loaded through a memory map", benchmarkScene},
+    {"layout", "circles, triangles, lines and points drawn into a frame stored in rows vs in tiles, and untiling", benchmarkLayout},
+    {"retained", "100000 shape scene with 0 to 256 circles moving, drawn whole every frame vs retained", benchmarkRetained},
+    {"text", "lines of bitmap font text drawn a pixel at a time vs expanded with vector masks vs cached runs", benchmarkText},
+};
+
+enum BenchmarkResult benchmarkRun(const char *name) {
+    for (size_t i = 0; i < sizeof(benchmarks)/sizeof(benchmarks[0]); i++) {
+        if (strcmp(benchmarks[i].name, name) == 0) {
+            return benchmarks[i].run() ? BENCHMARK_PASSED : BENCHMARK_FAILED;
+        }
+    }
+    return BENCHMARK_UNKNOWN;
+}
+
+void benchmarkList(void) {
+    for (size_t i = 0; i < sizeof(benchmarks)/sizeof(benchmarks[0]); i++) {
+        printf("  %-12s %s\n", benchmarks[i].name, benchmarks[i].description);
+    }
+}
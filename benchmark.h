@@ -0,0 +1,36 @@
+/**
+ * Microbenchmarks which run against the current frame,
+ * started from the headless backend with --bench NAME.
+ * @file benchmark.h
+ * @author ABM
+*/
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdbool.h>
+
+/**
+ * How a benchmark run ended.
+*/
+enum BenchmarkResult {
+    //It ran and everything it checks came out right
+    BENCHMARK_PASSED,
+    //It couldn't run, or drew something other than it should, like a raster golden image mismatch
+    BENCHMARK_FAILED,
+    //There is no benchmark with that name
+    BENCHMARK_UNKNOWN
+};
+
+/**
+ * Runs the named benchmark and prints its results, one line per measurement.
+ * @param name Name of the benchmark.
+ * @return Whether it passed, failed or doesn't exist.
+*/
+enum BenchmarkResult benchmarkRun(const char *name);
+
+/**
+ * Prints the names and descriptions of all benchmarks.
+*/
+void benchmarkList(void);
+
+#endif
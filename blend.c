@@ -0,0 +1,336 @@
+/**
+ * Premultiplied alpha blending into the frame.
+ * Every kernel divides by 255 as (x + 128 + ((x + 128) >> 8)) >> 8,
+ * which is exact, so they all give the same pixels.
+ * @file blend.c
+ * @author ABM
+*/
+#include "blend.h"
+#include <string.h>
+
+/** Spans shorter than this are blended in place, the vector kernels only pay off on longer ones. */
+#define BLEND_KERNEL_THRESHOLD 8
+
+/**
+ * Multiplies the four channels of a pixel by factor/255, rounded,
+ * two channels at a time in the 16 bit halves of a 32 bit value.
+ * @param pixel The pixel.
+ * @param factor 0 to 255.
+ * @return The scaled pixel.
+*/
+static uint32_t scale(uint32_t pixel, uint32_t factor) {
+    uint32_t blue_red = (pixel & 0x00FF00FF)*factor + 0x00800080;
+    uint32_t green_alpha = ((pixel >> 8) & 0x00FF00FF)*factor + 0x00800080;
+    blue_red = ((blue_red + ((blue_red >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    green_alpha = (green_alpha + ((green_alpha >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+    return blue_red | green_alpha;
+}
+
+uint32_t blendOver(uint32_t pixel, int coverage, uint32_t color) {
+    uint32_t source = scale(color, (uint32_t)coverage);
+    return source + scale(pixel, 255 - (source >> 24));
+}
+
+/**
+ * Blends pixels one at a time.
+ * @param pixels First pixel to blend into.
+ * @param coverage Coverage of each pixel, or NULL for complete coverage.
+ * @param count Number of pixels.
+ * @param color Premultiplied color.
+*/
+static void blendScalar(uint32_t *pixels, const uint8_t *coverage, size_t count, uint32_t color) {
+    if (!coverage) {
+        uint32_t inverse = 255 - (color >> 24);
+        for (size_t i = 0; i < count; i++) {
+            pixels[i] = color + scale(pixels[i], inverse);
+        }
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        pixels[i] = blendOver(pixels[i], coverage[i], color);
+    }
+}
+
+/**
+ * Blends pixels scattered through a buffer one at a time.
+ * @param pixels The buffer.
+ * @param offsets Offset of each pixel into the buffer.
+ * @param coverage Coverage of each pixel.
+ * @param count Number of pixels.
+ * @param color Premultiplied color.
+*/
+static void blendPixelsScalar(uint32_t *pixels, const ptrdiff_t *offsets, const uint8_t *coverage,
+                              size_t count, uint32_t color) {
+    for (size_t i = 0; i < count; i++) {
+        pixels[offsets[i]] = blendOver(pixels[offsets[i]], coverage[i], color);
+    }
+}
+
+#ifdef SIMD_X86
+
+//Pixels are widened to 16 bits per channel, two pixels per 128 bit lane,
+//where every product of two channels fits.
+
+/**
+ * Divides 16 bit channels by 255, rounded.
+ * @param x The channels, at most 255*255.
+ * @return x/255.
+*/
+static __m128i div255Sse2(__m128i x) {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/**
+ * Blends two widened source pixels over two widened pixels.
+ * @param pixels The pixels, 16 bits per channel.
+ * @param source The source, already scaled by its coverage.
+ * @return The blended pixels, 16 bits per channel.
+*/
+static __m128i overSse2(__m128i pixels, __m128i source) {
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(source, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    return _mm_add_epi16(source, div255Sse2(_mm_mullo_epi16(pixels, inverse)));
+}
+
+/**
+ * Blends a color over four pixels with SSE2.
+ * @param target The pixels.
+ * @param colors The premultiplied color, widened to 16 bits per channel, twice.
+ * @param coverage Coverage of the four pixels, or NULL for complete coverage.
+ * @return The blended pixels.
+*/
+static __m128i blend4Sse2(__m128i target, __m128i colors, const uint8_t *coverage) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i source_low = colors;
+    __m128i source_high = colors;
+    if (coverage) {
+        //Repeat each coverage byte across the 4 channels of its pixel
+        int32_t packed;
+        memcpy(&packed, coverage, sizeof(packed));
+        __m128i factors = _mm_cvtsi32_si128(packed);
+        factors = _mm_unpacklo_epi8(factors, factors);
+        factors = _mm_unpacklo_epi16(factors, factors);
+        source_low = div255Sse2(_mm_mullo_epi16(colors, _mm_unpacklo_epi8(factors, zero)));
+        source_high = div255Sse2(_mm_mullo_epi16(colors, _mm_unpackhi_epi8(factors, zero)));
+    }
+    __m128i low = overSse2(_mm_unpacklo_epi8(target, zero), source_low);
+    __m128i high = overSse2(_mm_unpackhi_epi8(target, zero), source_high);
+    return _mm_packus_epi16(low, high);
+}
+
+/**
+ * Blends pixels 4 at a time with SSE2.
+ * @param pixels First pixel to blend into.
+ * @param coverage Coverage of each pixel, or NULL for complete coverage.
+ * @param count Number of pixels.
+ * @param color Premultiplied color.
+*/
+static void blendSse2(uint32_t *pixels, const uint8_t *coverage, size_t count, uint32_t color) {
+    __m128i colors = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), _mm_setzero_si128());
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i target = _mm_loadu_si128((const __m128i *)(pixels + i));
+        _mm_storeu_si128((__m128i *)(pixels + i), blend4Sse2(target, colors, coverage ? coverage + i : NULL));
+    }
+    blendScalar(pixels + i, coverage ? coverage + i : NULL, count - i, color);
+}
+
+/**
+ * Blends pixels scattered through a buffer 4 at a time with SSE2,
+ * loading them straight into a register and storing them back from it.
+ * @param pixels The buffer.
+ * @param offsets Offset of each pixel into the buffer.
+ * @param coverage Coverage of each pixel.
+ * @param count Number of pixels.
+ * @param color Premultiplied color.
+*/
+static void blendPixelsSse2(uint32_t *pixels, const ptrdiff_t *offsets, const uint8_t *coverage,
+                            size_t count, uint32_t color) {
+    __m128i colors = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), _mm_setzero_si128());
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const ptrdiff_t *at = offsets + i;
+        __m128i target = _mm_setr_epi32((int)pixels[at[0]], (int)pixels[at[1]], (int)pixels[at[2]], (int)pixels[at[3]]);
+        __m128i blended = blend4Sse2(target, colors, coverage + i);
+        pixels[at[0]] = (uint32_t)_mm_cvtsi128_si32(blended);
+        pixels[at[1]] = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(blended, 4));
+        pixels[at[2]] = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(blended, 8));
+        pixels[at[3]] = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(blended, 12));
+    }
+    blendPixelsScalar(pixels, offsets + i, coverage + i, count - i, color);
+}
+
+/**
+ * Divides 16 bit channels by 255, rounded.
+ * @param x The channels, at most 255*255.
+ * @return x/255.
+*/
+TARGET_AVX2 static __m256i div255Avx2(__m256i x) {
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+/**
+ * Blends four widened source pixels over four widened pixels.
+ * @param pixels The pixels, 16 bits per channel.
+ * @param source The source, already scaled by its coverage.
+ * @return The blended pixels, 16 bits per channel.
+*/
+TARGET_AVX2 static __m256i overAvx2(__m256i pixels, __m256i source) {
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(source, _MM_SHUFFLE(3, 3, 3, 3)),
+                                           _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+    return _mm256_add_epi16(source, div255Avx2(_mm256_mullo_epi16(pixels, inverse)));
+}
+
+/**
+ * Blends a color over eight pixels with AVX2.
+ * @param target The pixels.
+ * @param colors The premultiplied color, widened to 16 bits per channel, four times.
+ * @param coverage Coverage of the eight pixels, or NULL for complete coverage.
+ * @return The blended pixels.
+*/
+TARGET_AVX2 static __m256i blend8Avx2(__m256i target, __m256i colors, const uint8_t *coverage) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i source_low = colors;
+    __m256i source_high = colors;
+    if (coverage) {
+        //Copies the coverage byte in the low byte of each 32 bit lane to the other 3
+        __m256i repeat = _mm256_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12,
+                                          0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12);
+        __m256i factors = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)coverage));
+        factors = _mm256_shuffle_epi8(factors, repeat);
+        source_low = div255Avx2(_mm256_mullo_epi16(colors, _mm256_unpacklo_epi8(factors, zero)));
+        source_high = div255Avx2(_mm256_mullo_epi16(colors, _mm256_unpackhi_epi8(factors, zero)));
+    }
+    __m256i low = overAvx2(_mm256_unpacklo_epi8(target, zero), source_low);
+    __m256i high = overAvx2(_mm256_unpackhi_epi8(target, zero), source_high);
+    return _mm256_packus_epi16(low, high);
+}
+
+/**
+ * Blends pixels 8 at a time with AVX2.
+ * @param pixels First pixel to blend into.
+ * @param coverage Coverage of each pixel, or NULL for complete coverage.
+ * @param count Number of pixels.
+ * @param color Premultiplied color.
+*/
+TARGET_AVX2 static void blendAvx2(uint32_t *pixels, const uint8_t *coverage, size_t count, uint32_t color) {
+    __m256i colors = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)color), _mm256_setzero_si256());
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i target = _mm256_loadu_si256((const __m256i *)(pixels + i));
+        _mm256_storeu_si256((__m256i *)(pixels + i), blend8Avx2(target, colors, coverage ? coverage + i : NULL));
+    }
+    //Leaving the upper halves of the registers dirty slows down the SSE2 code after it
+    _mm256_zeroupper();
+    blendSse2(pixels + i, coverage ? coverage + i : NULL, count - i, color);
+}
+
+/**
+ * Blends pixels scattered through a buffer 8 at a time with AVX2,
+ * gathering them into a register and storing them back one by one.
+ * @param pixels The buffer.
+ * @param offsets Offset of each pixel into the buffer.
+ * @param coverage Coverage of each pixel.
+ * @param count Number of pixels.
+ * @param color Premultiplied color.
+*/
+TARGET_AVX2 static void blendPixelsAvx2(uint32_t *pixels, const ptrdiff_t *offsets, const uint8_t *coverage,
+                                        size_t count, uint32_t color) {
+    __m256i colors = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)color), _mm256_setzero_si256());
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const ptrdiff_t *at = offsets + i;
+        __m128i low = _mm256_i64gather_epi32((const int *)pixels, _mm256_loadu_si256((const __m256i *)at), 4);
+        __m128i high = _mm256_i64gather_epi32((const int *)pixels, _mm256_loadu_si256((const __m256i *)(at + 4)), 4);
+        __m256i blended = blend8Avx2(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1),
+                                     colors, coverage + i);
+        low = _mm256_castsi256_si128(blended);
+        high = _mm256_extracti128_si256(blended, 1);
+        pixels[at[0]] = (uint32_t)_mm_cvtsi128_si32(low);
+        pixels[at[1]] = (uint32_t)_mm_extract_epi32(low, 1);
+        pixels[at[2]] = (uint32_t)_mm_extract_epi32(low, 2);
+        pixels[at[3]] = (uint32_t)_mm_extract_epi32(low, 3);
+        pixels[at[4]] = (uint32_t)_mm_cvtsi128_si32(high);
+        pixels[at[5]] = (uint32_t)_mm_extract_epi32(high, 1);
+        pixels[at[6]] = (uint32_t)_mm_extract_epi32(high, 2);
+        pixels[at[7]] = (uint32_t)_mm_extract_epi32(high, 3);
+    }
+    _mm256_zeroupper();
+    blendPixelsSse2(pixels, offsets + i, coverage + i, count - i, color);
+}
+
+#endif
+
+//Blend function for each instruction set
+static void (*const blend_kernels[SIMD_LEVEL_COUNT])(uint32_t *pixels, const uint8_t *coverage,
+                                                     size_t count, uint32_t color) = {
+    blendScalar,
+#ifdef SIMD_X86
+    blendSse2,
+    blendAvx2,
+#endif
+};
+
+//Scattered blend function for each instruction set
+static void (*const blend_pixels_kernels[SIMD_LEVEL_COUNT])(uint32_t *pixels, const ptrdiff_t *offsets,
+                                                            const uint8_t *coverage, size_t count, uint32_t color) = {
+    blendPixelsScalar,
+#ifdef SIMD_X86
+    blendPixelsSse2,
+    blendPixelsAvx2,
+#endif
+};
+
+//The instruction set in use, and whether blendInit has picked it yet.
+static enum SimdLevel current_level = SIMD_SCALAR;
+static bool initialized = false;
+
+void blendInit(void) {
+    current_level = simdBest();
+    initialized = true;
+}
+
+bool blendSetLevel(enum SimdLevel level) {
+    if (level >= SIMD_LEVEL_COUNT || !simdSupported(level) || !blend_kernels[level]) {
+        return false;
+    }
+    current_level = level;
+    initialized = true;
+    return true;
+}
+
+enum SimdLevel blendGetLevel(void) {
+    if (!initialized) {
+        blendInit();
+    }
+    return current_level;
+}
+
+uint32_t blendPremultiply(uint32_t color, int alpha) {
+    return scale(color | 0xFF000000, (uint32_t)alpha);
+}
+
+void blendSpan(uint32_t *pixels, const uint8_t *coverage, size_t count, uint32_t color) {
+    if (count < BLEND_KERNEL_THRESHOLD) {
+        blendScalar(pixels, coverage, count, color);
+        return;
+    }
+    if (!initialized) {
+        blendInit();
+    }
+    blend_kernels[current_level](pixels, coverage, count, color);
+}
+
+void blendPixels(uint32_t *pixels, const ptrdiff_t *offsets, const uint8_t *coverage, size_t count, uint32_t color) {
+    if (count < BLEND_KERNEL_THRESHOLD) {
+        blendPixelsScalar(pixels, offsets, coverage, count, color);
+        return;
+    }
+    if (!initialized) {
+        blendInit();
+    }
+    blend_pixels_kernels[current_level](pixels, offsets, coverage, count, color);
+}
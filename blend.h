@@ -0,0 +1,75 @@
+/**
+ * Premultiplied alpha blending into the frame, for the anti-aliased shapes.
+ * Colors are 0xAARRGGBB with the color channels already multiplied by alpha,
+ * and every blend also takes a coverage, 0 (leave the pixel) to 255 (the whole pixel).
+ * A pixel becomes source*coverage + pixel*(1 - alpha*coverage), channel by channel,
+ * rounded the same way by every instruction set.
+ * @file blend.h
+ * @author ABM
+*/
+#ifndef BLEND_H
+#define BLEND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "simd.h"
+
+/**
+ * Picks the fastest instruction set the CPU supports for blendSpan.
+ * Called once at startup, blendSpan also calls it itself if it wasn't.
+*/
+void blendInit(void);
+
+/**
+ * Forces an instruction set for blendSpan, for benchmarking.
+ * @param level The instruction set to use from now on.
+ * @return false (and nothing changes) if it isn't supported.
+*/
+bool blendSetLevel(enum SimdLevel level);
+
+/**
+ * Gets the instruction set blendSpan uses.
+ * @return The instruction set in use.
+*/
+enum SimdLevel blendGetLevel(void);
+
+/**
+ * Turns a 0xRRGGBB color and an opacity into a premultiplied color.
+ * @param color The color, its top byte is ignored.
+ * @param alpha Opacity, 0 (invisible) to 255 (opaque).
+ * @return The premultiplied color.
+*/
+uint32_t blendPremultiply(uint32_t color, int alpha);
+
+/**
+ * Blends a color over one pixel value.
+ * @param pixel The pixel value to blend over.
+ * @param coverage How much of the pixel the color covers, 0 to 255.
+ * @param color Premultiplied color.
+ * @return The blended pixel value.
+*/
+uint32_t blendOver(uint32_t pixel, int coverage, uint32_t color);
+
+/**
+ * Blends a color over consecutive pixels, 4 or 8 at a time.
+ * @param pixels First pixel to blend into.
+ * @param coverage Coverage of each pixel, or NULL to cover every pixel completely.
+ * @param count Number of pixels.
+ * @param color Premultiplied color.
+*/
+void blendSpan(uint32_t *pixels, const uint8_t *coverage, size_t count, uint32_t color);
+
+/**
+ * Blends a color over pixels scattered through a buffer, like the edges of an outline
+ * or a line: they are loaded into vector registers, blended 4 or 8 at a time like blendSpan
+ * and stored back one by one.
+ * @param pixels The buffer.
+ * @param offsets Offset of each pixel into the buffer, no offset may appear twice.
+ * @param coverage Coverage of each pixel.
+ * @param count Number of pixels.
+ * @param color Premultiplied color.
+*/
+void blendPixels(uint32_t *pixels, const ptrdiff_t *offsets, const uint8_t *coverage, size_t count, uint32_t color);
+
+#endif
@@ -0,0 +1,690 @@
+/**
+ * Frame capture with a background writer thread.
+ * Buffers move between a free stack and a queue of frames to write under a
+ * mutex, which is only held to move an index: copying a frame in and writing
+ * it out both happen outside of it.
+ * @file capture.c
+ * @author ABM
+*/
+#include "capture.h"
+#include "framebuffer.h"
+#include "thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Largest amount of data in one stored (uncompressed) deflate block. */
+#define DEFLATE_STORED_MAX 65535
+
+struct Capture {
+    enum CaptureFormat format;
+    enum CapturePolicy policy;
+    //Size of every written frame
+    int width;
+    int height;
+    //Open file for raw and Y4M, the path split around the frame number for PNG
+    FILE *file;
+    char *path_prefix;
+    const char *path_extension;
+    enum SimdLevel level;
+
+    //Frame copies, bottom-up like the frame with width pixels per row
+    uint32_t *buffers[CAPTURE_BUFFERS];
+    int free_buffers[CAPTURE_BUFFERS];
+    int free_count;
+    int queue[CAPTURE_BUFFERS];
+    int queue_start;
+    int queue_count;
+    //Converted frame data the writer thread builds before writing
+    uint8_t *scratch;
+    size_t scratch_size;
+
+    struct CaptureStats stats;
+    bool failed;
+    bool quit;
+    struct Mutex mutex;
+    struct Condition wake;
+    struct Thread thread;
+};
+
+//Lookup table for the PNG chunk checksums, filled in by the first captureCreate
+static uint32_t crc_table[256];
+
+/**
+ * Fills in the CRC-32 lookup table.
+*/
+static void crcInit(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        }
+        crc_table[i] = crc;
+    }
+}
+
+/**
+ * Continues a CRC-32 over more bytes.
+ * @param crc CRC of the bytes so far, 0 to start.
+ * @param bytes The bytes to add.
+ * @param count Number of bytes.
+ * @return The CRC including the new bytes.
+*/
+static uint32_t crcUpdate(uint32_t crc, const uint8_t *bytes, size_t count) {
+    crc = ~crc;
+    for (size_t i = 0; i < count; i++) {
+        crc = crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * Computes the Adler-32 checksum zlib streams end with.
+ * @param bytes The uncompressed data.
+ * @param count Number of bytes.
+ * @return The checksum.
+*/
+static uint32_t adler32(const uint8_t *bytes, size_t count) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (count > 0) {
+        //Largest run which can't overflow b before the modulo
+        size_t run = count < 5552 ? count : 5552;
+        count -= run;
+        while (run-- > 0) {
+            a += *bytes++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return b << 16 | a;
+}
+
+/**
+ * Stores a 32 bit value big-endian, as PNG wants it.
+ * @param bytes Where the 4 bytes go.
+ * @param value The value.
+*/
+static void storeBigEndian(uint8_t *bytes, uint32_t value) {
+    bytes[0] = (uint8_t)(value >> 24);
+    bytes[1] = (uint8_t)(value >> 16);
+    bytes[2] = (uint8_t)(value >> 8);
+    bytes[3] = (uint8_t)value;
+}
+
+/**
+ * Computes the luma of a pixel, Y = (77R + 150G + 29B)/256 rounded.
+ * The weights add up to 256, so the sum always fits in 16 bits.
+ * @param pixel The pixel, 0x00RRGGBB.
+ * @return The luma, 0 to 255.
+*/
+static uint8_t luma(uint32_t pixel) {
+    uint32_t red = (pixel >> 16) & 0xFF;
+    uint32_t green = (pixel >> 8) & 0xFF;
+    uint32_t blue = pixel & 0xFF;
+    return (uint8_t)((77*red + 150*green + 29*blue + 128) >> 8);
+}
+
+/**
+ * Computes 256 times the blue difference of a pixel, without the 128 offset.
+ * @param pixel The pixel, 0x00RRGGBB.
+ * @return 128B - 43R - 85G.
+*/
+static int32_t blueDifference(uint32_t pixel) {
+    int32_t red = (pixel >> 16) & 0xFF;
+    int32_t green = (pixel >> 8) & 0xFF;
+    int32_t blue = pixel & 0xFF;
+    return 128*blue - 43*red - 85*green;
+}
+
+/**
+ * Computes 256 times the red difference of a pixel, without the 128 offset.
+ * @param pixel The pixel, 0x00RRGGBB.
+ * @return 128R - 107G - 21B.
+*/
+static int32_t redDifference(uint32_t pixel) {
+    int32_t red = (pixel >> 16) & 0xFF;
+    int32_t green = (pixel >> 8) & 0xFF;
+    int32_t blue = pixel & 0xFF;
+    return 128*red - 107*green - 21*blue;
+}
+
+/**
+ * Turns the sum of the differences of a 2x2 block into a chroma value:
+ * divides by 4*256 rounding to nearest, and adds the 128 offset.
+ * The bias keeps the sum positive, so every instruction set can shift it unsigned.
+ * @param sum Sum of blueDifference or redDifference of the 4 pixels.
+ * @return The chroma value, 0 to 255.
+*/
+static uint8_t chroma(int32_t sum) {
+    uint32_t value = (uint32_t)(sum + 131584) >> 10;
+    return (uint8_t)(value > 255 ? 255 : value);
+}
+
+/**
+ * Converts pixels of two rows from a column onwards, one 2x2 block at a time.
+ * Parameters as for captureRowsToYuv, x being the even column to start at.
+*/
+static void yuvScalar(const uint32_t *top, const uint32_t *bottom, int x, int width,
+                      uint8_t *y_top, uint8_t *y_bottom, uint8_t *u, uint8_t *v) {
+    for (; x < width; x += 2) {
+        //An odd width repeats the last column for the last block
+        int right = x + 1 < width ? x + 1 : x;
+        y_top[x] = luma(top[x]);
+        y_top[right] = luma(top[right]);
+        y_bottom[x] = luma(bottom[x]);
+        y_bottom[right] = luma(bottom[right]);
+        u[x/2] = chroma(blueDifference(top[x]) + blueDifference(top[right]) +
+                        blueDifference(bottom[x]) + blueDifference(bottom[right]));
+        v[x/2] = chroma(redDifference(top[x]) + redDifference(top[right]) +
+                        redDifference(bottom[x]) + redDifference(bottom[right]));
+    }
+}
+
+#ifdef SIMD_X86
+
+//The channels sit in the low 16 bits of each 32 bit lane and every product fits
+//in 16 bits unsigned, so _mm_mullo_epi16 gives whole 32 bit products.
+
+/**
+ * Computes luma, blue and red difference of 4 pixels, as 32 bit lanes.
+ * @param pixels The pixels.
+ * @param y Set to the lumas, shifted down already.
+ * @param blue Set to the blue differences.
+ * @param red Set to the red differences.
+*/
+static void yuvPixelsSse2(__m128i pixels, __m128i *y, __m128i *blue, __m128i *red) {
+    __m128i mask = _mm_set1_epi32(0xFF);
+    __m128i b = _mm_and_si128(pixels, mask);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+    __m128i r = _mm_and_si128(_mm_srli_epi32(pixels, 16), mask);
+    __m128i sum = _mm_add_epi32(_mm_mullo_epi16(r, _mm_set1_epi32(77)), _mm_mullo_epi16(g, _mm_set1_epi32(150)));
+    sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_mullo_epi16(b, _mm_set1_epi32(29)), _mm_set1_epi32(128)));
+    *y = _mm_srli_epi32(sum, 8);
+    *blue = _mm_sub_epi32(_mm_sub_epi32(_mm_slli_epi32(b, 7), _mm_mullo_epi16(r, _mm_set1_epi32(43))),
+                          _mm_mullo_epi16(g, _mm_set1_epi32(85)));
+    *red = _mm_sub_epi32(_mm_sub_epi32(_mm_slli_epi32(r, 7), _mm_mullo_epi16(g, _mm_set1_epi32(107))),
+                         _mm_mullo_epi16(b, _mm_set1_epi32(21)));
+}
+
+/**
+ * Adds up neighbouring pairs of 8 differences of two rows and turns them into 4 chroma values.
+ * @param first Sums of the top and bottom differences of the first 4 columns.
+ * @param second Same for the next 4 columns.
+ * @return The chroma values in the low 4 bytes.
+*/
+static int chromaSse2(__m128i first, __m128i second) {
+    __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(first), _mm_castsi128_ps(second), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(first), _mm_castsi128_ps(second), _MM_SHUFFLE(3, 1, 3, 1));
+    __m128i sum = _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+    sum = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(131584)), 10);
+    sum = _mm_packs_epi32(sum, sum);
+    return _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+}
+
+/**
+ * SSE2 version of yuvScalar, 8 columns at a time.
+*/
+static void yuvSse2(const uint32_t *top, const uint32_t *bottom, int x, int width,
+                    uint8_t *y_top, uint8_t *y_bottom, uint8_t *u, uint8_t *v) {
+    for (; x + 8 <= width; x += 8) {
+        __m128i y[4], blue[4], red[4];
+        yuvPixelsSse2(_mm_loadu_si128((const __m128i *)(top + x)), &y[0], &blue[0], &red[0]);
+        yuvPixelsSse2(_mm_loadu_si128((const __m128i *)(top + x + 4)), &y[1], &blue[1], &red[1]);
+        yuvPixelsSse2(_mm_loadu_si128((const __m128i *)(bottom + x)), &y[2], &blue[2], &red[2]);
+        yuvPixelsSse2(_mm_loadu_si128((const __m128i *)(bottom + x + 4)), &y[3], &blue[3], &red[3]);
+
+        __m128i packed = _mm_packs_epi32(y[0], y[1]);
+        _mm_storel_epi64((__m128i *)(y_top + x), _mm_packus_epi16(packed, packed));
+        packed = _mm_packs_epi32(y[2], y[3]);
+        _mm_storel_epi64((__m128i *)(y_bottom + x), _mm_packus_epi16(packed, packed));
+
+        int chroma_u = chromaSse2(_mm_add_epi32(blue[0], blue[2]), _mm_add_epi32(blue[1], blue[3]));
+        int chroma_v = chromaSse2(_mm_add_epi32(red[0], red[2]), _mm_add_epi32(red[1], red[3]));
+        memcpy(u + x/2, &chroma_u, 4);
+        memcpy(v + x/2, &chroma_v, 4);
+    }
+    yuvScalar(top, bottom, x, width, y_top, y_bottom, u, v);
+}
+
+/**
+ * Computes luma, blue and red difference of 8 pixels, as 32 bit lanes.
+ * Same as yuvPixelsSse2.
+*/
+TARGET_AVX2 static void yuvPixelsAvx2(__m256i pixels, __m256i *y, __m256i *blue, __m256i *red) {
+    __m256i mask = _mm256_set1_epi32(0xFF);
+    __m256i b = _mm256_and_si256(pixels, mask);
+    __m256i g = _mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask);
+    __m256i r = _mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask);
+    __m256i sum = _mm256_add_epi32(_mm256_mullo_epi16(r, _mm256_set1_epi32(77)),
+                                   _mm256_mullo_epi16(g, _mm256_set1_epi32(150)));
+    sum = _mm256_add_epi32(sum, _mm256_add_epi32(_mm256_mullo_epi16(b, _mm256_set1_epi32(29)),
+                                                 _mm256_set1_epi32(128)));
+    *y = _mm256_srli_epi32(sum, 8);
+    *blue = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_slli_epi32(b, 7), _mm256_mullo_epi16(r, _mm256_set1_epi32(43))),
+                             _mm256_mullo_epi16(g, _mm256_set1_epi32(85)));
+    *red = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_slli_epi32(r, 7), _mm256_mullo_epi16(g, _mm256_set1_epi32(107))),
+                            _mm256_mullo_epi16(b, _mm256_set1_epi32(21)));
+}
+
+/**
+ * Packs 16 lumas, held as 32 bit lanes, into bytes.
+ * @param first Lumas of the first 8 columns.
+ * @param second Lumas of the next 8 columns.
+ * @return The 16 lumas in order.
+*/
+TARGET_AVX2 static __m128i packLumaAvx2(__m256i first, __m256i second) {
+    //Packing works within 128 bit halves, leaving columns 0-3 8-11 in the low half
+    //and 4-7 12-15 in the high one
+    __m256i packed = _mm256_packs_epi32(first, second);
+    packed = _mm256_packus_epi16(packed, packed);
+    return _mm_unpacklo_epi32(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+}
+
+/**
+ * Adds up neighbouring pairs of 16 differences of two rows and turns them into 8 chroma values.
+ * @param first Sums of the top and bottom differences of the first 8 columns.
+ * @param second Same for the next 8 columns.
+ * @param chroma_values Where the 8 values go.
+*/
+TARGET_AVX2 static void chromaAvx2(__m256i first, __m256i second, uint8_t *chroma_values) {
+    __m256 even = _mm256_shuffle_ps(_mm256_castsi256_ps(first), _mm256_castsi256_ps(second), _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 odd = _mm256_shuffle_ps(_mm256_castsi256_ps(first), _mm256_castsi256_ps(second), _MM_SHUFFLE(3, 1, 3, 1));
+    __m256i sum = _mm256_add_epi32(_mm256_castps_si256(even), _mm256_castps_si256(odd));
+    //The shuffles work within 128 bit halves too, put the blocks back in order
+    sum = _mm256_permute4x64_epi64(sum, _MM_SHUFFLE(3, 1, 2, 0));
+    sum = _mm256_srli_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(131584)), 10);
+    sum = _mm256_packs_epi32(sum, sum);
+    sum = _mm256_packus_epi16(sum, sum);
+    int low = _mm_cvtsi128_si32(_mm256_castsi256_si128(sum));
+    int high = _mm_cvtsi128_si32(_mm256_extracti128_si256(sum, 1));
+    memcpy(chroma_values, &low, 4);
+    memcpy(chroma_values + 4, &high, 4);
+}
+
+/**
+ * AVX2 version of yuvScalar, 16 columns at a time.
+*/
+TARGET_AVX2 static void yuvAvx2(const uint32_t *top, const uint32_t *bottom, int x, int width,
+                                uint8_t *y_top, uint8_t *y_bottom, uint8_t *u, uint8_t *v) {
+    for (; x + 16 <= width; x += 16) {
+        __m256i y[4], blue[4], red[4];
+        yuvPixelsAvx2(_mm256_loadu_si256((const __m256i *)(top + x)), &y[0], &blue[0], &red[0]);
+        yuvPixelsAvx2(_mm256_loadu_si256((const __m256i *)(top + x + 8)), &y[1], &blue[1], &red[1]);
+        yuvPixelsAvx2(_mm256_loadu_si256((const __m256i *)(bottom + x)), &y[2], &blue[2], &red[2]);
+        yuvPixelsAvx2(_mm256_loadu_si256((const __m256i *)(bottom + x + 8)), &y[3], &blue[3], &red[3]);
+
+        _mm_storeu_si128((__m128i *)(y_top + x), packLumaAvx2(y[0], y[1]));
+        _mm_storeu_si128((__m128i *)(y_bottom + x), packLumaAvx2(y[2], y[3]));
+        chromaAvx2(_mm256_add_epi32(blue[0], blue[2]), _mm256_add_epi32(blue[1], blue[3]), u + x/2);
+        chromaAvx2(_mm256_add_epi32(red[0], red[2]), _mm256_add_epi32(red[1], red[3]), v + x/2);
+    }
+    yuvScalar(top, bottom, x, width, y_top, y_bottom, u, v);
+}
+
+#endif
+
+//Conversion function for each instruction set
+static void (*const yuv_kernels[SIMD_LEVEL_COUNT])(const uint32_t *top, const uint32_t *bottom, int x, int width,
+                                                   uint8_t *y_top, uint8_t *y_bottom, uint8_t *u, uint8_t *v) = {
+    yuvScalar,
+#ifdef SIMD_X86
+    yuvSse2,
+    yuvAvx2,
+#endif
+};
+
+void captureRowsToYuv(enum SimdLevel level, const uint32_t *top, const uint32_t *bottom, int width,
+                      uint8_t *y_top, uint8_t *y_bottom, uint8_t *u, uint8_t *v) {
+    if (level >= SIMD_LEVEL_COUNT || !yuv_kernels[level]) {
+        level = SIMD_SCALAR;
+    }
+    yuv_kernels[level](top, bottom, 0, width, y_top, y_bottom, u, v);
+}
+
+/**
+ * Gets a row of a captured frame, counting from the top of the image.
+ * @param capture The capture.
+ * @param pixels The captured frame, bottom-up.
+ * @param row Row from the top.
+ * @return The row.
+*/
+static const uint32_t *imageRow(const struct Capture *capture, const uint32_t *pixels, int row) {
+    return pixels + (size_t)(capture->height - 1 - row)*capture->width;
+}
+
+/**
+ * Writes a frame as raw BGRA rows, top-down.
+ * @param capture The capture.
+ * @param pixels The captured frame.
+ * @return true if it was written.
+*/
+static bool writeRaw(struct Capture *capture, const uint32_t *pixels) {
+    uint32_t *row = (uint32_t *)capture->scratch;
+    for (int y = 0; y < capture->height; y++) {
+        const uint32_t *source = imageRow(capture, pixels, y);
+        //0x00RRGGBB is already blue, green, red in memory, only the alpha is missing
+        for (int x = 0; x < capture->width; x++) {
+            row[x] = source[x] | 0xFF000000u;
+        }
+        if (fwrite(row, sizeof(uint32_t), capture->width, capture->file) != (size_t)capture->width) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Writes a frame to the Y4M stream, converting it to 4:2:0 two rows at a time.
+ * @param capture The capture.
+ * @param pixels The captured frame.
+ * @return true if it was written.
+*/
+static bool writeY4m(struct Capture *capture, const uint32_t *pixels) {
+    int width = capture->width;
+    int height = capture->height;
+    int chroma_width = (width + 1)/2;
+    int chroma_height = (height + 1)/2;
+    uint8_t *y_plane = capture->scratch;
+    uint8_t *u_plane = y_plane + (size_t)width*height;
+    uint8_t *v_plane = u_plane + (size_t)chroma_width*chroma_height;
+    //Where the luma of the row below an odd last row goes, as it doesn't exist
+    uint8_t *spare_row = v_plane + (size_t)chroma_width*chroma_height;
+
+    for (int y = 0; y < height; y += 2) {
+        bool pair = y + 1 < height;
+        captureRowsToYuv(capture->level,
+                         imageRow(capture, pixels, y),
+                         imageRow(capture, pixels, pair ? y + 1 : y),
+                         width,
+                         y_plane + (size_t)y*width,
+                         pair ? y_plane + (size_t)(y + 1)*width : spare_row,
+                         u_plane + (size_t)(y/2)*chroma_width,
+                         v_plane + (size_t)(y/2)*chroma_width);
+    }
+
+    size_t size = (size_t)width*height + 2*(size_t)chroma_width*chroma_height;
+    return fputs("FRAME\n", capture->file) >= 0 && fwrite(capture->scratch, 1, size, capture->file) == size;
+}
+
+/**
+ * Writes a frame as a PNG file of its own. The image data is stored
+ * in uncompressed deflate blocks, so no compression library is needed.
+ * @param capture The capture.
+ * @param pixels The captured frame.
+ * @param index Number of the frame, which goes into the file name.
+ * @return true if it was written.
+*/
+static bool writePng(struct Capture *capture, const uint32_t *pixels, long index) {
+    int width = capture->width;
+    int height = capture->height;
+    size_t row_size = 1 + 3*(size_t)width;
+    size_t image_size = row_size*height;
+    size_t block_count = (image_size + DEFLATE_STORED_MAX - 1)/DEFLATE_STORED_MAX;
+    //zlib header, block headers, image, Adler-32
+    size_t idat_size = 2 + 5*block_count + image_size + 4;
+
+    //The filtered image goes at the end of the scratch buffer, the IDAT chunk at its start
+    uint8_t *image = capture->scratch + capture->scratch_size - image_size;
+    for (int y = 0; y < height; y++) {
+        const uint32_t *source = imageRow(capture, pixels, y);
+        uint8_t *row = image + row_size*y;
+        //Filter type 0, the bytes as they are
+        row[0] = 0;
+        for (int x = 0; x < width; x++) {
+            row[1 + 3*x] = (uint8_t)(source[x] >> 16);
+            row[2 + 3*x] = (uint8_t)(source[x] >> 8);
+            row[3 + 3*x] = (uint8_t)source[x];
+        }
+    }
+    uint32_t adler = adler32(image, image_size);
+
+    uint8_t *chunk = capture->scratch;
+    storeBigEndian(chunk, (uint32_t)idat_size);
+    memcpy(chunk + 4, "IDAT", 4);
+    uint8_t *data = chunk + 8;
+    //Deflate, 32K window, no dictionary, fastest
+    *data++ = 0x78;
+    *data++ = 0x01;
+    for (size_t offset = 0; offset < image_size; offset += DEFLATE_STORED_MAX) {
+        size_t length = image_size - offset < DEFLATE_STORED_MAX ? image_size - offset : DEFLATE_STORED_MAX;
+        *data++ = offset + length == image_size ? 1 : 0;
+        *data++ = (uint8_t)length;
+        *data++ = (uint8_t)(length >> 8);
+        *data++ = (uint8_t)~length;
+        *data++ = (uint8_t)(~length >> 8);
+        //Moves forward over the image, never onto bytes not yet moved
+        memmove(data, image + offset, length);
+        data += length;
+    }
+    storeBigEndian(data, adler);
+    data += 4;
+    storeBigEndian(data, crcUpdate(0, chunk + 4, 4 + idat_size));
+    data += 4;
+
+    uint8_t header[8 + 25];
+    memcpy(header, "\x89PNG\r\n\x1a\n", 8);
+    storeBigEndian(header + 8, 13);
+    memcpy(header + 12, "IHDR", 4);
+    storeBigEndian(header + 16, (uint32_t)width);
+    storeBigEndian(header + 20, (uint32_t)height);
+    //8 bits per channel, RGB, deflate, no filtering method, not interlaced
+    memcpy(header + 24, "\x08\x02\x00\x00\x00", 5);
+    storeBigEndian(header + 29, crcUpdate(0, header + 12, 17));
+    static const uint8_t end[12] = {0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82};
+
+    size_t name_size = strlen(capture->path_prefix) + strlen(capture->path_extension) + 24;
+    char *name = malloc(name_size);
+    if (!name) {
+        return false;
+    }
+    snprintf(name, name_size, "%s%06ld%s", capture->path_prefix, index, capture->path_extension);
+    FILE *file = fopen(name, "wb");
+    free(name);
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+                   fwrite(chunk, 1, data - chunk, file) == (size_t)(data - chunk) &&
+                   fwrite(end, 1, sizeof(end), file) == sizeof(end);
+    return fclose(file) == 0 && written;
+}
+
+/**
+ * Main function of the writer thread, writes queued frames until the capture quits.
+ * @param argument The capture.
+*/
+static void writerThread(void *argument) {
+    struct Capture *capture = argument;
+    for (;;) {
+        mutexLock(&capture->mutex);
+        while (capture->queue_count == 0 && !capture->quit) {
+            conditionWait(&capture->wake, &capture->mutex);
+        }
+        if (capture->queue_count == 0) {
+            mutexUnlock(&capture->mutex);
+            return;
+        }
+        int buffer = capture->queue[capture->queue_start];
+        capture->queue_start = (capture->queue_start + 1)%CAPTURE_BUFFERS;
+        capture->queue_count--;
+        long index = capture->stats.frames_written;
+        bool failed = capture->failed;
+        mutexUnlock(&capture->mutex);
+
+        //Once a write failed the rest are skipped, the file is broken anyway
+        bool written = false;
+        if (!failed) {
+            switch (capture->format) {
+                case CAPTURE_RAW: written = writeRaw(capture, capture->buffers[buffer]); break;
+                case CAPTURE_Y4M: written = writeY4m(capture, capture->buffers[buffer]); break;
+                default: written = writePng(capture, capture->buffers[buffer], index); break;
+            }
+        }
+
+        mutexLock(&capture->mutex);
+        if (written) {
+            capture->stats.frames_written++;
+        } else {
+            capture->failed = true;
+        }
+        capture->free_buffers[capture->free_count++] = buffer;
+        conditionBroadcast(&capture->wake);
+        mutexUnlock(&capture->mutex);
+    }
+}
+
+enum CaptureFormat captureFormatFromPath(const char *path) {
+    const char *extension = strrchr(path, '.');
+    if (extension && (strcmp(extension, ".y4m") == 0 || strcmp(extension, ".Y4M") == 0)) {
+        return CAPTURE_Y4M;
+    }
+    if (extension && (strcmp(extension, ".png") == 0 || strcmp(extension, ".PNG") == 0)) {
+        return CAPTURE_PNG;
+    }
+    return CAPTURE_RAW;
+}
+
+/**
+ * Releases everything a capture holds, apart from its thread.
+ * @param capture The capture.
+ * @return true if the file was closed without an error.
+*/
+static bool captureFree(struct Capture *capture) {
+    bool closed = !capture->file || fclose(capture->file) == 0;
+    for (int i = 0; i < CAPTURE_BUFFERS; i++) {
+        free(capture->buffers[i]);
+    }
+    free(capture->scratch);
+    free(capture->path_prefix);
+    conditionDestroy(&capture->wake);
+    mutexDestroy(&capture->mutex);
+    free(capture);
+    return closed;
+}
+
+struct Capture *captureCreate(const char *path, enum CaptureFormat format, enum CapturePolicy policy, double fps) {
+    if (!frame.pixels || format >= CAPTURE_FORMAT_COUNT) {
+        return NULL;
+    }
+    struct Capture *capture = calloc(1, sizeof(struct Capture));
+    if (!capture) {
+        return NULL;
+    }
+    capture->format = format;
+    capture->policy = policy;
+    capture->width = frame.width;
+    capture->height = frame.height;
+    capture->level = simdBest();
+    mutexInit(&capture->mutex);
+    conditionInit(&capture->wake);
+
+    size_t pixel_count = (size_t)capture->width*capture->height;
+    bool allocated = true;
+    for (int i = 0; i < CAPTURE_BUFFERS; i++) {
+        capture->buffers[i] = malloc(pixel_count*sizeof(uint32_t));
+        allocated = allocated && capture->buffers[i];
+        capture->free_buffers[i] = i;
+    }
+    capture->free_count = CAPTURE_BUFFERS;
+
+    //Room for the largest thing the format builds before writing
+    if (format == CAPTURE_RAW) {
+        capture->scratch_size = capture->width*sizeof(uint32_t);
+    } else if (format == CAPTURE_Y4M) {
+        size_t chroma_size = (size_t)((capture->width + 1)/2)*((capture->height + 1)/2);
+        capture->scratch_size = pixel_count + 2*chroma_size + capture->width;
+    } else {
+        size_t image_size = (1 + 3*(size_t)capture->width)*capture->height;
+        capture->scratch_size = 8 + 2 + 5*((image_size + DEFLATE_STORED_MAX - 1)/DEFLATE_STORED_MAX) + image_size + 8;
+    }
+    capture->scratch = malloc(capture->scratch_size);
+    allocated = allocated && capture->scratch;
+
+    if (format == CAPTURE_PNG) {
+        crcInit();
+        const char *extension = strrchr(path, '.');
+        size_t prefix_length = extension ? (size_t)(extension - path) : strlen(path);
+        capture->path_extension = extension ? extension : ".png";
+        capture->path_prefix = malloc(prefix_length + 1);
+        if (capture->path_prefix) {
+            memcpy(capture->path_prefix, path, prefix_length);
+            capture->path_prefix[prefix_length] = '\0';
+        }
+        allocated = allocated && capture->path_prefix;
+    } else {
+        capture->file = fopen(path, "wb");
+        allocated = allocated && capture->file;
+    }
+
+    if (allocated && format == CAPTURE_Y4M) {
+        //Frame rate as a fraction with a denominator of 1000, for rates like 59.94.
+        //The samples use all of 0 to 255, which readers take for 16 to 235 unless told otherwise.
+        long rate = fps > 0 ? (long)(fps*1000 + 0.5) : 60000;
+        allocated = fprintf(capture->file, "YUV4MPEG2 W%d H%d F%ld:1000 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n",
+                            capture->width, capture->height, rate) > 0;
+    }
+
+    if (!allocated || !threadStart(&capture->thread, writerThread, capture)) {
+        captureFree(capture);
+        return NULL;
+    }
+    return capture;
+}
+
+bool captureFrame(struct Capture *capture) {
+    mutexLock(&capture->mutex);
+    if (capture->free_count == 0 && capture->policy == CAPTURE_DROP) {
+        capture->stats.frames_dropped++;
+        mutexUnlock(&capture->mutex);
+        return false;
+    }
+    while (capture->free_count == 0) {
+        conditionWait(&capture->wake, &capture->mutex);
+    }
+    int buffer = capture->free_buffers[--capture->free_count];
+    mutexUnlock(&capture->mutex);
+
+    //Copy the part of the frame which fits the capture size, and clear what the frame doesn't cover
+    uint32_t *pixels = capture->buffers[buffer];
+    int width = frame.width < capture->width ? frame.width : capture->width;
+    int height = frame.pixels ? (frame.height < capture->height ? frame.height : capture->height) : 0;
+    struct FrameRect copied = {0, 0, width, height};
+    frameReadPixels(&copied, pixels, capture->width);
+    for (int y = 0; y < height; y++) {
+        memset(pixels + width + (size_t)y*capture->width, 0, (capture->width - width)*sizeof(uint32_t));
+    }
+    memset(pixels + (size_t)height*capture->width, 0, (size_t)(capture->height - height)*capture->width*sizeof(uint32_t));
+
+    mutexLock(&capture->mutex);
+    capture->queue[(capture->queue_start + capture->queue_count)%CAPTURE_BUFFERS] = buffer;
+    capture->queue_count++;
+    capture->stats.frames_captured++;
+    conditionBroadcast(&capture->wake);
+    mutexUnlock(&capture->mutex);
+    return true;
+}
+
+void captureStats(struct Capture *capture, struct CaptureStats *stats) {
+    mutexLock(&capture->mutex);
+    *stats = capture->stats;
+    mutexUnlock(&capture->mutex);
+}
+
+bool captureDestroy(struct Capture *capture, struct CaptureStats *stats) {
+    if (!capture) {
+        return true;
+    }
+    mutexLock(&capture->mutex);
+    capture->quit = true;
+    conditionBroadcast(&capture->wake);
+    mutexUnlock(&capture->mutex);
+    threadJoin(&capture->thread);
+
+    if (stats) {
+        *stats = capture->stats;
+    }
+    bool succeeded = !capture->failed;
+    return captureFree(capture) && succeeded;
+}
@@ -0,0 +1,105 @@
+/**
+ * Records finished frames to disk without holding up the render loop.
+ * Each captured frame is copied into one of CAPTURE_BUFFERS buffers and
+ * written out by a background thread, as raw BGRA, a Y4M video or numbered PNGs.
+ * @file capture.h
+ * @author ABM
+*/
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "simd.h"
+
+/** Number of frames which can wait for the writer thread. */
+#define CAPTURE_BUFFERS 4
+
+/** File formats a capture can be written as. */
+enum CaptureFormat {
+    //Every frame top-down, 4 bytes per pixel in the order blue, green, red, alpha (255)
+    CAPTURE_RAW,
+    //YUV4MPEG2 stream, 4:2:0 full range BT.601, which most video tools read directly
+    CAPTURE_Y4M,
+    //One 24 bit PNG per frame, numbered after the path, stored without compression
+    CAPTURE_PNG,
+    CAPTURE_FORMAT_COUNT
+};
+
+/** What to do with a frame when every buffer is still waiting to be written. */
+enum CapturePolicy {
+    //Skip the frame and count it as dropped, the render loop never waits
+    CAPTURE_DROP,
+    //Wait for the writer thread to free a buffer, so no frame is lost
+    CAPTURE_BLOCK
+};
+
+/**
+ * How far a capture has got.
+*/
+struct CaptureStats {
+    long frames_captured;
+    long frames_written;
+    long frames_dropped;
+};
+
+struct Capture;
+
+/**
+ * Picks the format for a file name from its extension: .y4m, .png, anything else is raw.
+ * @param path The file name.
+ * @return The format.
+*/
+enum CaptureFormat captureFormatFromPath(const char *path);
+
+/**
+ * Opens a capture of frames the size the frame is now. Frames of another size
+ * are cut down or padded with black to it, since the formats can't change size.
+ * @param path File to write. For PNG, frame n goes to the path with n inserted
+ *             before the extension, capture.png becoming capture000000.png and so on.
+ * @param format Format to write.
+ * @param policy What to do with frames which come faster than they can be written.
+ * @param fps Frame rate written into the Y4M header, ignored by the other formats.
+ * @return The capture, or NULL if the frame is empty or the file could not be opened.
+*/
+struct Capture *captureCreate(const char *path, enum CaptureFormat format, enum CapturePolicy policy, double fps);
+
+/**
+ * Queues a copy of the frame to be written.
+ * @param capture The capture.
+ * @return true if the frame was queued, false if it was dropped.
+*/
+bool captureFrame(struct Capture *capture);
+
+/**
+ * Gets how many frames were captured, written and dropped so far.
+ * @param capture The capture.
+ * @param stats Filled out with the counts.
+*/
+void captureStats(struct Capture *capture, struct CaptureStats *stats);
+
+/**
+ * Writes every queued frame, closes the file and releases the capture.
+ * @param capture The capture to release, may be NULL.
+ * @param stats Filled out with the final counts if not NULL.
+ * @return true if every frame was written, false if writing failed.
+*/
+bool captureDestroy(struct Capture *capture, struct CaptureStats *stats);
+
+/**
+ * Converts two rows of pixels to 4:2:0 YUV, full range BT.601: a luma value
+ * per pixel and one chroma pair per 2x2 block. Every instruction set gives
+ * the same values.
+ * @param level Instruction set to convert with, must be supported.
+ * @param top The upper row of pixels.
+ * @param bottom The lower row of pixels, may be the same as top.
+ * @param width Number of pixels in each row.
+ * @param y_top Where the (width) luma values of the upper row go.
+ * @param y_bottom Where the luma values of the lower row go.
+ * @param u Where the ((width + 1)/2) blue difference values go.
+ * @param v Where the red difference values go.
+*/
+void captureRowsToYuv(enum SimdLevel level, const uint32_t *top, const uint32_t *bottom, int width,
+                      uint8_t *y_top, uint8_t *y_bottom, uint8_t *u, uint8_t *v);
+
+#endif
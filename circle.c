@@ -0,0 +1,384 @@
+/**
+ * Integer only midpoint circle rasterizer.
+ * Only the first octant (from the top of the circle clockwise to 45 degrees)
+ * is ever computed, the other seven are mirror images of it.
+ * @file circle.c
+ * @author ABM
+*/
+#include "circle.h"
+#include "framebuffer.h"
+#include "primitives.h"
+#include "blend.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Number of first octant points computed before they are written out. */
+#define OCTANT_CHUNK 256
+
+//How a first octant point (x, y) is mirrored onto each of the 8 octants.
+//When swap is set the point is written at (y, x) instead.
+static const struct {
+    int sign_x;
+    int sign_y;
+    bool swap;
+} octants[8] = {
+    { 1,  1, false},
+    {-1,  1, false},
+    { 1, -1, false},
+    {-1, -1, false},
+    { 1,  1, true},
+    {-1,  1, true},
+    { 1, -1, true},
+    {-1, -1, true},
+};
+
+/**
+ * Narrows first..last down to the indices i for which
+ * low <= center + sign*offsets[i] < high.
+ * The offsets must be monotonic, so the indices which pass form a single range
+ * and can be found with two binary searches instead of a check per pixel.
+ * @param offsets Offsets from the center, monotonic in i.
+ * @param sign 1 or -1, the direction the offsets are applied in.
+ * @param center Coordinate the offsets are relative to.
+ * @param low First column or row which may be drawn into.
+ * @param high Column or row after the last one which may be drawn into.
+ * @param first First index of the range, updated in place.
+ * @param last Last index of the range, updated in place.
+ * @return true if any index is left in the range.
+*/
+static bool clipMonotonic(const int *offsets, int sign, int center, int low, int high, int *first, int *last) {
+    int lo = *first;
+    int hi = *last;
+    if (lo > hi) {
+        return false;
+    }
+
+    bool increasing = center + sign*offsets[hi] >= center + sign*offsets[lo];
+
+    //Search for the first index which is past the near edge of the clip rectangle
+    int a = lo;
+    int b = hi + 1;
+    while (a < b) {
+        int mid = a + (b - a)/2;
+        int position = center + sign*offsets[mid];
+        if (increasing ? position >= low : position < high) {
+            b = mid;
+        } else {
+            a = mid + 1;
+        }
+    }
+    *first = a;
+
+    //Search for the last index which is before the far edge of the clip rectangle
+    a = lo - 1;
+    b = hi;
+    while (a < b) {
+        int mid = a + (b - a + 1)/2;
+        int position = center + sign*offsets[mid];
+        if (increasing ? position < high : position >= low) {
+            a = mid;
+        } else {
+            b = mid - 1;
+        }
+    }
+    *last = a;
+
+    return *first <= *last;
+}
+
+/**
+ * Writes a run of first octant points into all 8 octants of the circle.
+ * Each octant is clipped against the clip rectangle once, then written without any checks.
+ * @param center_x x coordinate of the center of the circle
+ * @param center_y y coordinate of the center of the circle
+ * @param xs x offsets of the points, increasing
+ * @param ys y offsets of the points, never increasing
+ * @param count number of points
+ * @param color color of the points
+*/
+static void writeOctants(int center_x, int center_y, const int *xs, const int *ys, int count, uint32_t color) {
+    struct FrameRect clip = frameClip();
+    for (int octant = 0; octant < 8; octant++) {
+        int sign_x = octants[octant].sign_x;
+        int sign_y = octants[octant].sign_y;
+        const int *offsets_x = octants[octant].swap ? ys : xs;
+        const int *offsets_y = octants[octant].swap ? xs : ys;
+
+        int first = 0;
+        int last = count - 1;
+        if (!clipMonotonic(offsets_x, sign_x, center_x, clip.x_min, clip.x_max, &first, &last)
+            || !clipMonotonic(offsets_y, sign_y, center_y, clip.y_min, clip.y_max, &first, &last)) {
+            continue;
+        }
+
+        if (frame.layout == FRAME_LAYOUT_TILES) {
+            int stride = frame.stride;
+            for (int i = first; i <= last; i++) {
+                frame.pixels[frameTileOffset(center_x + sign_x*offsets_x[i],
+                                             center_y + sign_y*offsets_y[i], stride)] = color;
+            }
+            continue;
+        }
+        ptrdiff_t center = center_x + (ptrdiff_t)center_y*frame.stride;
+        ptrdiff_t row = sign_y*frame.stride;
+        for (int i = first; i <= last; i++) {
+            frame.pixels[center + sign_x*offsets_x[i] + offsets_y[i]*row] = color;
+        }
+    }
+}
+
+/**
+ * Blends a run of first octant points into all 8 octants of the circle.
+ * Mirror images which land on the same pixel are only blended once,
+ * since blending a pixel twice would make it darker than its neighbours.
+ * @param center_x x coordinate of the center of the circle
+ * @param center_y y coordinate of the center of the circle
+ * @param xs x offsets of the points, increasing
+ * @param ys y offsets of the points, never increasing
+ * @param coverage coverage of each point
+ * @param count number of points
+ * @param color premultiplied color of the points
+*/
+static void blendOctants(int center_x, int center_y, const int *xs, const int *ys, const uint8_t *coverage,
+                         int count, uint32_t color) {
+    struct FrameRect clip = frameClip();
+    //Most circles are well inside the clip rectangle, which saves clipping each octant
+    int reach = xs[count - 1] > ys[0] ? xs[count - 1] : ys[0];
+    bool inside = center_x - reach >= clip.x_min && center_x + reach < clip.x_max
+                  && center_y - reach >= clip.y_min && center_y + reach < clip.y_max;
+    ptrdiff_t offsets[8*OCTANT_CHUNK];
+    uint8_t coverage_all[8*OCTANT_CHUNK];
+    size_t count_all = 0;
+    for (int octant = 0; octant < 8; octant++) {
+        int sign_x = octants[octant].sign_x;
+        int sign_y = octants[octant].sign_y;
+        bool swap = octants[octant].swap;
+        const int *offsets_x = swap ? ys : xs;
+        const int *offsets_y = swap ? xs : ys;
+
+        //Points with a 0 offset are their own mirror image, and points on the
+        //diagonal their own swapped image. Being monotonic, those are at the ends.
+        int first = 0;
+        int last = count - 1;
+        while (first <= last && ((sign_x < 0 && offsets_x[first] == 0) || (sign_y < 0 && offsets_y[first] == 0))) {
+            first++;
+        }
+        while (first <= last && ((sign_x < 0 && offsets_x[last] == 0) || (sign_y < 0 && offsets_y[last] == 0) ||
+                                 (swap && xs[last] == ys[last]))) {
+            last--;
+        }
+        if (!inside && (!clipMonotonic(offsets_x, sign_x, center_x, clip.x_min, clip.x_max, &first, &last)
+                        || !clipMonotonic(offsets_y, sign_y, center_y, clip.y_min, clip.y_max, &first, &last))) {
+            continue;
+        }
+        if (first > last) {
+            continue;
+        }
+
+        if (frame.layout == FRAME_LAYOUT_TILES) {
+            int stride = frame.stride;
+            for (int i = first; i <= last; i++) {
+                offsets[count_all] = frameTileOffset(center_x + sign_x*offsets_x[i],
+                                                     center_y + sign_y*offsets_y[i], stride);
+                coverage_all[count_all++] = coverage[i];
+            }
+            continue;
+        }
+        ptrdiff_t center = center_x + (ptrdiff_t)center_y*frame.stride;
+        ptrdiff_t row = sign_y*frame.stride;
+        for (int i = first; i <= last; i++) {
+            offsets[count_all] = center + sign_x*offsets_x[i] + offsets_y[i]*row;
+            coverage_all[count_all++] = coverage[i];
+        }
+    }
+    //With the mirror images left out the points of all octants are different pixels,
+    //so they are blended together
+    blendPixels(frame.pixels, offsets, coverage_all, count_all, color);
+}
+
+/**
+ * Blends the partly covered pixels above (and below) the top (and bottom) rows of a
+ * solid circle: a run of columns whose spans end in the same row, and their mirror image.
+ * @param center_x x coordinate of the center of the circle
+ * @param center_y y coordinate of the center of the circle
+ * @param row offset of the row from the center
+ * @param column offset of the first column from the center
+ * @param coverage coverage of each column, from column on
+ * @param count number of columns, at most OCTANT_CHUNK
+ * @param color premultiplied color of the circle
+*/
+static void blendEdgeRun(int center_x, int center_y, int row, int column, const uint8_t *coverage,
+                         int count, uint32_t color) {
+    //The mirror image runs the other way, and column 0 is its own mirror image
+    uint8_t mirrored[OCTANT_CHUNK];
+    int mirrored_count = column == 0 ? count - 1 : count;
+    for (int i = 0; i < mirrored_count; i++) {
+        mirrored[i] = coverage[count - 1 - i];
+    }
+    for (int sign = -1; sign <= 1; sign += 2) {
+        blendHorizontalSpan(center_y + sign*row, center_x + column, coverage, count, color);
+        blendHorizontalSpan(center_y + sign*row, center_x - column - count + 1, mirrored, mirrored_count, color);
+    }
+}
+
+void circleOutline(int center_x, int center_y, int radius, uint32_t color) {
+    if (radius < 0 || !frame.pixels) {
+        return;
+    }
+
+    int xs[OCTANT_CHUNK];
+    int ys[OCTANT_CHUNK];
+
+    //Midpoint algorithm: step x along the first octant and decide from the sign
+    //of the decision variable d whether the midpoint between the two candidate
+    //pixels is inside the circle (keep y) or outside of it (step y down).
+    int x = 0;
+    int y = radius;
+    int d = 1 - radius;
+    while (x <= y) {
+        int count = 0;
+        while (x <= y && count < OCTANT_CHUNK) {
+            xs[count] = x;
+            ys[count] = y;
+            count++;
+
+            if (d < 0) {
+                d += 2*x + 3;
+            } else {
+                d += 2*(x - y) + 5;
+                y--;
+            }
+            x++;
+        }
+        writeOctants(center_x, center_y, xs, ys, count, color);
+    }
+}
+
+void circleFilled(int center_x, int center_y, int radius, uint32_t color) {
+    if (radius < 0 || !frame.pixels) {
+        return;
+    }
+
+    int x = 0;
+    int y = radius;
+    int d = 1 - radius;
+    while (x <= y) {
+        //The rows x above and below the center are only reached once each
+        drawHorizontalSpan(center_y + x, center_x - y, center_x + y, color);
+        if (x != 0) {
+            drawHorizontalSpan(center_y - x, center_x - y, center_x + y, color);
+        }
+
+        //The rows y above and below the center are reached for several x in a row,
+        //so only fill them on the last one, right before y steps down.
+        //When x == y the row was just filled above.
+        if (d >= 0 && x != y) {
+            drawHorizontalSpan(center_y + y, center_x - x, center_x + x, color);
+            drawHorizontalSpan(center_y - y, center_x - x, center_x + x, color);
+        }
+
+        if (d < 0) {
+            d += 2*x + 3;
+        } else {
+            d += 2*(x - y) + 5;
+            y--;
+        }
+        x++;
+    }
+}
+
+//Both anti-aliased circles walk the first octant like the midpoint algorithm, but keep
+//y = floor(sqrt(radius^2 - x^2)) exactly and cover the pixel past y in proportion to
+//where radius^2 - x^2 lies between y^2 and (y + 1)^2, which needs no square roots.
+
+void circleOutlineAntialiased(int center_x, int center_y, int radius, uint32_t color) {
+    if (radius < 0 || !frame.pixels) {
+        return;
+    }
+
+    int xs[OCTANT_CHUNK];
+    int ys[OCTANT_CHUNK];
+    int ys_far[OCTANT_CHUNK];
+    uint8_t near[OCTANT_CHUNK];
+    uint8_t far[OCTANT_CHUNK];
+    uint32_t source = color | 0xFF000000;
+    int64_t squared = (int64_t)radius*radius;
+
+    int x = 0;
+    int y = radius;
+    while (x <= y) {
+        int count = 0;
+        while (x <= y && count < OCTANT_CHUNK) {
+            int64_t remainder = squared - (int64_t)x*x - (int64_t)y*y;
+            uint8_t coverage = (uint8_t)(remainder*255/(2*(int64_t)y + 1));
+            xs[count] = x;
+            ys[count] = y;
+            ys_far[count] = y + 1;
+            near[count] = 255 - coverage;
+            far[count] = coverage;
+            count++;
+
+            x++;
+            while (y > 0 && (int64_t)y*y > squared - (int64_t)x*x) {
+                y--;
+            }
+        }
+        blendOctants(center_x, center_y, xs, ys, near, count, source);
+        blendOctants(center_x, center_y, xs, ys_far, far, count, source);
+    }
+}
+
+void circleFilledAntialiased(int center_x, int center_y, int radius, uint32_t color) {
+    if (radius < 0 || !frame.pixels) {
+        return;
+    }
+
+    uint32_t source = color | 0xFF000000;
+    int64_t squared = (int64_t)radius*radius;
+    //Coverage of the columns from run_start on, whose spans end in the same row
+    uint8_t edges[OCTANT_CHUNK];
+    int run_start = 0;
+    int run_count = 0;
+
+    int x = 0;
+    int y = radius;
+    while (x <= y) {
+        int64_t remainder = squared - (int64_t)x*x - (int64_t)y*y;
+        uint8_t coverage = (uint8_t)(remainder*255/(2*(int64_t)y + 1));
+
+        //The rows x above and below the center, solid out to y, partly covering the pixel past it
+        for (int sign = -1; sign <= 1; sign += 2) {
+            if (sign < 0 && x == 0) {
+                continue;
+            }
+            drawHorizontalSpan(center_y + sign*x, center_x - y, center_x + y, color);
+            blendHorizontalSpan(center_y + sign*x, center_x + y + 1, &coverage, 1, source);
+            blendHorizontalSpan(center_y + sign*x, center_x - y - 1, &coverage, 1, source);
+        }
+        edges[run_count++] = coverage;
+
+        int next_x = x + 1;
+        int next_y = y;
+        while (next_y > 0 && (int64_t)next_y*next_y > squared - (int64_t)next_x*next_x) {
+            next_y--;
+        }
+
+        //Column x partly covers the pixel in row y + 1, blend the columns
+        //sharing that row together once y steps down
+        if (next_y < y || next_x > next_y || run_count == OCTANT_CHUNK) {
+            blendEdgeRun(center_x, center_y, y + 1, run_start, edges, run_count, source);
+            run_start = next_x;
+            run_count = 0;
+        }
+
+        //The rows y above and below the center are only filled on the last x
+        //before y steps down, like in circleFilled
+        if (next_y < y && x != y) {
+            drawHorizontalSpan(center_y + y, center_x - x, center_x + x, color);
+            drawHorizontalSpan(center_y - y, center_x - x, center_x + x, color);
+        }
+
+        x = next_x;
+        y = next_y;
+    }
+}
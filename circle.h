@@ -0,0 +1,51 @@
+/**
+ * Integer only midpoint circle rasterizer, with anti-aliased variants.
+ * @file circle.h
+ * @author ABM
+*/
+#ifndef CIRCLE_H
+#define CIRCLE_H
+
+#include <stdint.h>
+
+/**
+ * Draws the one pixel wide, gap free outline of a circle into the frame.
+ * Pixels outside of the clip rectangle of the frame are clipped.
+ * @param center_x x coordinate of the center of the circle
+ * @param center_y y coordinate of the center of the circle
+ * @param radius radius of the circle, nothing is drawn if it is negative
+ * @param color color of the outline
+*/
+void circleOutline(int center_x, int center_y, int radius, uint32_t color);
+
+/**
+ * Draws a solid circle into the frame, one horizontal span per row.
+ * Pixels outside of the clip rectangle of the frame are clipped.
+ * @param center_x x coordinate of the center of the circle
+ * @param center_y y coordinate of the center of the circle
+ * @param radius radius of the circle, nothing is drawn if it is negative
+ * @param color color of the circle
+*/
+void circleFilled(int center_x, int center_y, int radius, uint32_t color);
+
+/**
+ * Draws an anti-aliased outline of a circle (Xiaolin Wu's algorithm):
+ * each point of the outline is shared between the two pixels nearest to it.
+ * @param center_x x coordinate of the center of the circle
+ * @param center_y y coordinate of the center of the circle
+ * @param radius radius of the circle, nothing is drawn if it is negative
+ * @param color color of the outline, 0xRRGGBB, drawn opaque
+*/
+void circleOutlineAntialiased(int center_x, int center_y, int radius, uint32_t color);
+
+/**
+ * Draws a solid circle with anti-aliased edges: the same spans as circleFilled,
+ * plus one partly covered pixel past the end of each span and above the top ones.
+ * @param center_x x coordinate of the center of the circle
+ * @param center_y y coordinate of the center of the circle
+ * @param radius radius of the circle, nothing is drawn if it is negative
+ * @param color color of the circle, 0xRRGGBB, drawn opaque
+*/
+void circleFilledAntialiased(int center_x, int center_y, int radius, uint32_t color);
+
+#endif
@@ -0,0 +1,393 @@
+/**
+ * Recorded list of the draw calls for one frame.
+ * @file commandList.c
+ * @author ABM
+*/
+#include "commandList.h"
+#include "framebuffer.h"
+#include "pixelDrawer.h"
+#include "circle.h"
+#include "triangle.h"
+#include "primitives.h"
+#include "fill.h"
+#include "dirty.h"
+#include "points.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Number of commands and points a list starts out with room for. */
+#define COMMAND_LIST_INITIAL_CAPACITY 64
+
+/** Points commands with more points than this mark the rows they span dirty instead of each point. */
+#define COMMAND_LIST_DIRTY_POINTS 1024
+
+/**
+ * Resizes an array to a new capacity.
+ * Running out of memory while recording a frame is fatal, like in the rest of the program.
+ * @param array The array, may be NULL.
+ * @param capacity The new number of elements.
+ * @param element_size Size of one element, in bytes.
+ * @return The resized array.
+*/
+static void *resize(void *array, int capacity, size_t element_size) {
+    void *new_array = realloc(array, (size_t)capacity*element_size);
+    if (!new_array) {
+        printf("Recording the command list failed.\n");
+        exit(1);
+    }
+    return new_array;
+}
+
+/**
+ * Picks the capacity of an array which has run full.
+ * @param capacity The current capacity.
+ * @return Twice the current capacity, or the initial capacity for an empty array.
+*/
+static int nextCapacity(int capacity) {
+    return capacity > 0 ? capacity*2 : COMMAND_LIST_INITIAL_CAPACITY;
+}
+
+/**
+ * Appends a command to a list.
+ * @param list The list to append to.
+ * @param type Type of the command.
+ * @param color Color of the command.
+ * @param x_min Leftmost column the command can draw into.
+ * @param y_min Lowest row the command can draw into.
+ * @param x_max Rightmost column the command can draw into.
+ * @param y_max Highest row the command can draw into.
+ * @return The new command, with its arguments left for the caller to fill in.
+*/
+static struct Command *append(struct CommandList *list, enum CommandType type, uint32_t color,
+                              int x_min, int y_min, int x_max, int y_max) {
+    if (list->count == list->capacity) {
+        list->capacity = nextCapacity(list->capacity);
+        list->commands = resize(list->commands, list->capacity, sizeof(struct Command));
+    }
+    struct Command *command = &list->commands[list->count++];
+    command->type = type;
+    command->color = color;
+    command->x_min = x_min;
+    command->x_max = x_max;
+    command->y_min = y_min;
+    command->y_max = y_max;
+    command->batch = NULL;
+    command->antialias = list->antialias;
+    return command;
+}
+
+void commandListInit(struct CommandList *list) {
+    list->commands = NULL;
+    list->count = 0;
+    list->capacity = 0;
+    list->point_indices = NULL;
+    list->point_colors = NULL;
+    list->point_count = 0;
+    list->point_capacity = 0;
+    list->antialias = false;
+}
+
+void commandListFree(struct CommandList *list) {
+    free(list->commands);
+    free(list->point_indices);
+    free(list->point_colors);
+    commandListInit(list);
+}
+
+void commandListReset(struct CommandList *list) {
+    list->count = 0;
+    list->point_count = 0;
+}
+
+void commandListSetAntialias(struct CommandList *list, bool antialias) {
+    list->antialias = antialias;
+}
+
+void commandListClear(struct CommandList *list, uint32_t color) {
+    append(list, COMMAND_CLEAR, color, 0, 0, frame.width - 1, frame.height - 1);
+}
+
+void commandListDrawCircle(struct CommandList *list, int circle_center_x, int circle_center_y, int circle_radius) {
+    int reach = (circle_radius > 0 ? circle_radius : 0) + 1;
+    struct Command *command = append(list, COMMAND_DRAW_CIRCLE, 0,
+                                     circle_center_x - reach, circle_center_y - reach,
+                                     circle_center_x + reach, circle_center_y + reach);
+    command->args[0] = circle_center_x;
+    command->args[1] = circle_center_y;
+    command->args[2] = circle_radius;
+}
+
+void commandListDrawTriangle(struct CommandList *list, int triangle_top_x, int triangle_top_y, int side_length) {
+    //Generous bounds: the corners are within side_length of the top, the peak up to one row above that
+    int reach = side_length > 0 ? side_length : 0;
+    struct Command *command = append(list, COMMAND_DRAW_TRIANGLE, 0,
+                                     triangle_top_x - reach, triangle_top_y - reach,
+                                     triangle_top_x + reach, triangle_top_y + reach + 1);
+    command->args[0] = triangle_top_x;
+    command->args[1] = triangle_top_y;
+    command->args[2] = side_length;
+}
+
+void commandListCircleOutline(struct CommandList *list, int center_x, int center_y, int radius, uint32_t color) {
+    struct Command *command = append(list, COMMAND_CIRCLE_OUTLINE, color,
+                                     center_x - radius, center_y - radius,
+                                     center_x + radius, center_y + radius);
+    command->args[0] = center_x;
+    command->args[1] = center_y;
+    command->args[2] = radius;
+}
+
+void commandListCircleFilled(struct CommandList *list, int center_x, int center_y, int radius, uint32_t color) {
+    struct Command *command = append(list, COMMAND_CIRCLE_FILLED, color,
+                                     center_x - radius, center_y - radius,
+                                     center_x + radius, center_y + radius);
+    command->args[0] = center_x;
+    command->args[1] = center_y;
+    command->args[2] = radius;
+}
+
+void commandListTriangleFilled(struct CommandList *list, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color) {
+    int x_min = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+    int x_max = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+    int y_min = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+    int y_max = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+    struct Command *command = append(list, COMMAND_TRIANGLE_FILLED, color, x_min, y_min, x_max, y_max);
+    command->args[0] = x0;
+    command->args[1] = y0;
+    command->args[2] = x1;
+    command->args[3] = y1;
+    command->args[4] = x2;
+    command->args[5] = y2;
+}
+
+void commandListLine(struct CommandList *list, int x0, int y0, int x1, int y1, uint32_t color) {
+    struct Command *command = append(list, COMMAND_LINE, color, x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1,
+                                     x0 > x1 ? x0 : x1, y0 > y1 ? y0 : y1);
+    command->args[0] = x0;
+    command->args[1] = y0;
+    command->args[2] = x1;
+    command->args[3] = y1;
+}
+
+/**
+ * Makes room for more points at the end of a list, starting a new points
+ * command unless the last command already is one.
+ * @param list The list to record into.
+ * @param count Number of points to make room for.
+ * @return Index of the first new point in the point arrays.
+*/
+static int appendPoints(struct CommandList *list, int count) {
+    if (list->count == 0 || list->commands[list->count - 1].type != COMMAND_POINTS) {
+        struct Command *command = append(list, COMMAND_POINTS, 0, 0, 0, frame.width - 1, frame.height - 1);
+        command->args[0] = list->point_count;
+        command->args[1] = 0;
+    }
+
+    if (list->point_count + count > list->point_capacity) {
+        while (list->point_count + count > list->point_capacity) {
+            list->point_capacity = nextCapacity(list->point_capacity);
+        }
+        list->point_indices = resize(list->point_indices, list->point_capacity, sizeof(uint32_t));
+        list->point_colors = resize(list->point_colors, list->point_capacity, sizeof(uint32_t));
+    }
+    int first = list->point_count;
+    list->point_count += count;
+    list->commands[list->count - 1].args[1] += count;
+    return first;
+}
+
+void commandListPoint(struct CommandList *list, uint32_t index, uint32_t color) {
+    int first = appendPoints(list, 1);
+    list->point_indices[first] = index;
+    list->point_colors[first] = color;
+}
+
+void commandListPoints(struct CommandList *list, int count, uint32_t **indices, uint32_t **colors) {
+    int first = appendPoints(list, count);
+    *indices = list->point_indices + first;
+    *colors = list->point_colors + first;
+}
+
+void commandListBatch(struct CommandList *list, enum CommandType type, const struct ShapeBatch *batch,
+                      int first, int count, struct FrameRect bounds) {
+    struct Command *command = append(list, type, 0, bounds.x_min, bounds.y_min, bounds.x_max - 1, bounds.y_max - 1);
+    command->args[0] = first;
+    command->args[1] = count;
+    command->batch = batch;
+}
+
+int commandListShapeCount(const struct CommandList *list) {
+    int shapes = 0;
+    for (int i = 0; i < list->count; i++) {
+        const struct Command *command = &list->commands[i];
+        if (command->type == COMMAND_POINTS || command->batch) {
+            shapes += command->args[1];
+        } else if (command->type != COMMAND_CLEAR) {
+            shapes++;
+        }
+    }
+    return shapes;
+}
+
+void commandListMarkDirty(const struct CommandList *list) {
+    uint32_t pixel_count = (uint32_t)frame.width*frame.height;
+    for (int i = 0; i < list->count; i++) {
+        const struct Command *command = &list->commands[i];
+        if (command->type != COMMAND_POINTS) {
+            dirtyAdd(command->x_min, command->y_min, command->x_max + 1, command->y_max + 1);
+            continue;
+        }
+        //Points are spread all over the frame, so mark each one on its own
+        //and let the dirty list decide how to merge them. Past a point that costs
+        //more than it saves, so mark the rows from the lowest to the highest point instead.
+        const uint32_t *indices = list->point_indices + command->args[0];
+        int count = command->args[1];
+        if (count > COMMAND_LIST_DIRTY_POINTS) {
+            uint32_t lowest = UINT32_MAX;
+            uint32_t highest = 0;
+            for (int j = 0; j < count; j++) {
+                if (indices[j] < pixel_count) {
+                    lowest = indices[j] < lowest ? indices[j] : lowest;
+                    highest = indices[j] > highest ? indices[j] : highest;
+                }
+            }
+            if (lowest <= highest) {
+                dirtyAdd(0, lowest/frame.width, frame.width, highest/frame.width + 1);
+            }
+            continue;
+        }
+        for (int j = 0; j < count; j++) {
+            if (indices[j] < pixel_count) {
+                int x = indices[j]%frame.width;
+                int y = indices[j]/frame.width;
+                dirtyAdd(x, y, x + 1, y + 1);
+            }
+        }
+    }
+}
+
+/**
+ * Draws the shapes of a batch command, one tight loop per kind of shape.
+ * @param command The batch command.
+*/
+static void executeBatch(const struct Command *command) {
+    const struct ShapeBatch *batch = command->batch;
+    const int32_t *const *coordinates = batch->coordinates;
+    const uint32_t *colors = batch->colors;
+    int first = command->args[0];
+    int end = first + command->args[1];
+
+    switch (command->type) {
+        case COMMAND_CIRCLE_BATCH: {
+            if (command->antialias) {
+                for (int i = first; i < end; i++) {
+                    if (batch->filled[i]) {
+                        circleFilledAntialiased(coordinates[0][i], coordinates[1][i], coordinates[2][i], colors[i]);
+                    } else {
+                        circleOutlineAntialiased(coordinates[0][i], coordinates[1][i], coordinates[2][i], colors[i]);
+                    }
+                }
+                break;
+            }
+            for (int i = first; i < end; i++) {
+                if (batch->filled[i]) {
+                    circleFilled(coordinates[0][i], coordinates[1][i], coordinates[2][i], colors[i]);
+                } else {
+                    circleOutline(coordinates[0][i], coordinates[1][i], coordinates[2][i], colors[i]);
+                }
+            }
+        } break;
+
+        case COMMAND_TRIANGLE_BATCH: {
+            for (int i = first; i < end; i++) {
+                triangleFilled(coordinates[0][i], coordinates[1][i], coordinates[2][i],
+                               coordinates[3][i], coordinates[4][i], coordinates[5][i], colors[i]);
+            }
+        } break;
+
+        case COMMAND_LINE_BATCH: {
+            void (*line)(int, int, int, int, uint32_t) = command->antialias ? drawLineAntialiased : drawLine;
+            for (int i = first; i < end; i++) {
+                line(coordinates[0][i], coordinates[1][i], coordinates[2][i], coordinates[3][i], colors[i]);
+            }
+        } break;
+
+        default: {
+            struct FrameRect clip = frameClip();
+            for (int i = first; i < end; i++) {
+                int x = coordinates[0][i];
+                int y = coordinates[1][i];
+                if (x >= clip.x_min && x < clip.x_max && y >= clip.y_min && y < clip.y_max) {
+                    frame.pixels[frameOffset(x, y)] = colors[i];
+                }
+            }
+        } break;
+    }
+}
+
+void commandExecute(const struct CommandList *list, const struct Command *command) {
+    const int *args = command->args;
+    switch (command->type) {
+        case COMMAND_CLEAR: {
+            fillClear(command->color);
+        } break;
+
+        case COMMAND_DRAW_CIRCLE: {
+            if (command->antialias) {
+                drawCircleAntialiased(args[0], args[1], args[2]);
+            } else {
+                drawCircle(args[0], args[1], args[2]);
+            }
+        } break;
+
+        case COMMAND_DRAW_TRIANGLE: {
+            drawTriangle(args[0], args[1], args[2]);
+        } break;
+
+        case COMMAND_CIRCLE_OUTLINE: {
+            if (command->antialias) {
+                circleOutlineAntialiased(args[0], args[1], args[2], command->color);
+            } else {
+                circleOutline(args[0], args[1], args[2], command->color);
+            }
+        } break;
+
+        case COMMAND_CIRCLE_FILLED: {
+            if (command->antialias) {
+                circleFilledAntialiased(args[0], args[1], args[2], command->color);
+            } else {
+                circleFilled(args[0], args[1], args[2], command->color);
+            }
+        } break;
+
+        case COMMAND_TRIANGLE_FILLED: {
+            triangleFilled(args[0], args[1], args[2], args[3], args[4], args[5], command->color);
+        } break;
+
+        case COMMAND_LINE: {
+            if (command->antialias) {
+                drawLineAntialiased(args[0], args[1], args[2], args[3], command->color);
+            } else {
+                drawLine(args[0], args[1], args[2], args[3], command->color);
+            }
+        } break;
+
+        case COMMAND_POINTS: {
+            pointsDraw(list->point_indices + command->args[0], list->point_colors + command->args[0],
+                       command->args[1]);
+        } break;
+
+        case COMMAND_CIRCLE_BATCH:
+        case COMMAND_TRIANGLE_BATCH:
+        case COMMAND_LINE_BATCH:
+        case COMMAND_POINT_BATCH: {
+            executeBatch(command);
+        } break;
+    }
+}
+
+void commandListExecute(const struct CommandList *list) {
+    for (int i = 0; i < list->count; i++) {
+        commandExecute(list, &list->commands[i]);
+    }
+}
@@ -0,0 +1,238 @@
+/**
+ * Recorded list of the draw calls for one frame, so the frame can be
+ * rasterized later, on one thread or split across several.
+ * @file commandList.h
+ * @author ABM
+*/
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "framebuffer.h"
+
+/** Most coordinate arrays a shape batch has, one per argument of the draw call (triangles have 6). */
+#define SHAPE_BATCH_ARRAYS 6
+
+/** The kinds of draw calls which can be recorded. */
+enum CommandType {
+    COMMAND_CLEAR,
+    COMMAND_DRAW_CIRCLE,
+    COMMAND_DRAW_TRIANGLE,
+    COMMAND_CIRCLE_OUTLINE,
+    COMMAND_CIRCLE_FILLED,
+    COMMAND_TRIANGLE_FILLED,
+    COMMAND_LINE,
+    COMMAND_POINTS,
+    //Runs of shapes from a ShapeBatch, one command for many shapes
+    COMMAND_CIRCLE_BATCH,
+    COMMAND_TRIANGLE_BATCH,
+    COMMAND_LINE_BATCH,
+    COMMAND_POINT_BATCH
+};
+
+/**
+ * Many shapes of one kind in structure of arrays layout, drawn by batch commands.
+ * coordinates[i][n] is argument i of the draw call for shape n:
+ * center x, center y and radius for circles, x0 y0 x1 y1 x2 y2 for triangles,
+ * x0 y0 x1 y1 for lines and x y for points. The arrays are only read,
+ * so they can point straight into a memory mapped file.
+*/
+struct ShapeBatch {
+    int count;
+    const int32_t *coordinates[SHAPE_BATCH_ARRAYS];
+    const uint32_t *colors;
+    //Nonzero for circles drawn filled rather than as an outline, NULL for the other shapes
+    const uint8_t *filled;
+};
+
+/**
+ * One recorded draw call.
+*/
+struct Command {
+    enum CommandType type;
+    uint32_t color;
+    //Leftmost and rightmost column the command can draw into, used to mark the frame dirty
+    int x_min;
+    int x_max;
+    //Lowest and highest row the command can draw into, used to bin it into bands
+    int y_min;
+    int y_max;
+    //Arguments of the draw call, in the order the draw function takes them.
+    //For COMMAND_POINTS and the batch commands, the first shape and the number of shapes.
+    int args[6];
+    //The shapes of a batch command
+    const struct ShapeBatch *batch;
+    //Whether circles and lines are drawn anti-aliased
+    bool antialias;
+};
+
+/**
+ * The draw calls of a frame, in the order they were made.
+*/
+struct CommandList {
+    struct Command *commands;
+    int count;
+    int capacity;
+    //Pixel indices (x + y*frame.width) and colors of every point in the list
+    uint32_t *point_indices;
+    uint32_t *point_colors;
+    int point_count;
+    int point_capacity;
+    //Whether circles and lines recorded from now on are drawn anti-aliased
+    bool antialias;
+};
+
+/**
+ * Sets up an empty command list.
+ * @param list The list to set up.
+*/
+void commandListInit(struct CommandList *list);
+
+/**
+ * Releases the memory of a command list.
+ * @param list The list to release.
+*/
+void commandListFree(struct CommandList *list);
+
+/**
+ * Empties a command list, keeping its memory for the next frame.
+ * @param list The list to empty.
+*/
+void commandListReset(struct CommandList *list);
+
+/**
+ * Switches anti-aliasing on or off for the circles and lines recorded from now on,
+ * batches included. It stays as it is when the list is reset.
+ * @param list The list to record into.
+ * @param antialias true to draw them anti-aliased (see blend.h), false to draw them aliased.
+*/
+void commandListSetAntialias(struct CommandList *list, bool antialias);
+
+/**
+ * Records a fillClear.
+ * @param list The list to record into.
+ * @param color Color to clear the frame to.
+*/
+void commandListClear(struct CommandList *list, uint32_t color);
+
+/**
+ * Records a drawCircle.
+ * @param list The list to record into.
+ * @param circle_center_x x coordinate of the center of the circle
+ * @param circle_center_y y coordinate of the center of the circle
+ * @param circle_radius radius of the circle
+*/
+void commandListDrawCircle(struct CommandList *list, int circle_center_x, int circle_center_y, int circle_radius);
+
+/**
+ * Records a drawTriangle.
+ * @param list The list to record into.
+ * @param triangle_top_x x coordinate of the peak of the triangle
+ * @param triangle_top_y y coordinate of the peak of the triangle
+ * @param side_length side length of the triangle
+*/
+void commandListDrawTriangle(struct CommandList *list, int triangle_top_x, int triangle_top_y, int side_length);
+
+/**
+ * Records a circleOutline.
+ * @param list The list to record into.
+ * @param center_x x coordinate of the center of the circle
+ * @param center_y y coordinate of the center of the circle
+ * @param radius radius of the circle
+ * @param color color of the outline
+*/
+void commandListCircleOutline(struct CommandList *list, int center_x, int center_y, int radius, uint32_t color);
+
+/**
+ * Records a circleFilled.
+ * @param list The list to record into.
+ * @param center_x x coordinate of the center of the circle
+ * @param center_y y coordinate of the center of the circle
+ * @param radius radius of the circle
+ * @param color color of the circle
+*/
+void commandListCircleFilled(struct CommandList *list, int center_x, int center_y, int radius, uint32_t color);
+
+/**
+ * Records a triangleFilled.
+ * @param list The list to record into.
+ * @param x0 x coordinate of the first vertex
+ * @param y0 y coordinate of the first vertex
+ * @param x1 x coordinate of the second vertex
+ * @param y1 y coordinate of the second vertex
+ * @param x2 x coordinate of the third vertex
+ * @param y2 y coordinate of the third vertex
+ * @param color color of the triangle
+*/
+void commandListTriangleFilled(struct CommandList *list, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color);
+
+/**
+ * Records a drawLine.
+ * @param list The list to record into.
+ * @param x0 x coordinate of the start of the line
+ * @param y0 y coordinate of the start of the line
+ * @param x1 x coordinate of the end of the line
+ * @param y1 y coordinate of the end of the line
+ * @param color color of the line
+*/
+void commandListLine(struct CommandList *list, int x0, int y0, int x1, int y1, uint32_t color);
+
+/**
+ * Records setting a single pixel. Consecutive points are merged into one command.
+ * @param list The list to record into.
+ * @param index Index of the pixel, x + y*frame.width (not frame.stride).
+ * @param color Color to set the pixel to.
+*/
+void commandListPoint(struct CommandList *list, uint32_t index, uint32_t color);
+
+/**
+ * Records count points at once, for the caller to fill in.
+ * @param list The list to record into.
+ * @param count Number of points to record.
+ * @param indices Set to where the indices of the points (x + y*frame.width) go.
+ * @param colors Set to where the colors of the points go.
+*/
+void commandListPoints(struct CommandList *list, int count, uint32_t **indices, uint32_t **colors);
+
+/**
+ * Records drawing a run of shapes from a batch with a single command.
+ * The batch has to stay unchanged until the list is reset.
+ * @param list The list to record into.
+ * @param type COMMAND_CIRCLE_BATCH, COMMAND_TRIANGLE_BATCH, COMMAND_LINE_BATCH or COMMAND_POINT_BATCH.
+ * @param batch The shapes.
+ * @param first Index of the first shape to draw.
+ * @param count Number of shapes to draw.
+ * @param bounds Rectangle every one of the shapes lies in, used to bin the command into bands.
+*/
+void commandListBatch(struct CommandList *list, enum CommandType type, const struct ShapeBatch *batch,
+                      int first, int count, struct FrameRect bounds);
+
+/**
+ * Counts the shapes a list draws: one for each shape command, and every point
+ * and every shape of a batch. Clears aren't counted.
+ * @param list The list to count.
+ * @return The number of shapes.
+*/
+int commandListShapeCount(const struct CommandList *list);
+
+/**
+ * Marks the part of the frame every recorded command can draw into as dirty.
+ * @param list The list to mark.
+*/
+void commandListMarkDirty(const struct CommandList *list);
+
+/**
+ * Runs one recorded command, clipped to the clip rectangle of the calling thread.
+ * @param list The list the command belongs to.
+ * @param command The command to run.
+*/
+void commandExecute(const struct CommandList *list, const struct Command *command);
+
+/**
+ * Runs every recorded command in order on the calling thread.
+ * @param list The list to run.
+*/
+void commandListExecute(const struct CommandList *list);
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ * List of the rectangles of the frame which changed since it was last presented.
+ * Rectangles are kept as they come in until the list runs full, then each new
+ * rectangle is merged into the one it grows the least. Overlapping rectangles
+ * are merged when the list is read, so no pixel gets copied twice.
+ * @file dirty.c
+ * @author ABM
+*/
+#include "dirty.h"
+
+//The changed rectangles, may overlap until mergeOverlapping runs
+static struct FrameRect rects[DIRTY_MAX_RECTS];
+static int rect_count = 0;
+//Set when no two rectangles overlap, so reading the list twice doesn't merge twice
+static bool rects_merged = true;
+
+/**
+ * Tells whether a rectangle lies entirely inside another.
+ * @param outer The containing rectangle.
+ * @param inner The contained rectangle.
+ * @return true if every pixel of inner is inside outer.
+*/
+static bool rectContains(struct FrameRect outer, struct FrameRect inner) {
+    return inner.x_min >= outer.x_min && inner.x_max <= outer.x_max &&
+           inner.y_min >= outer.y_min && inner.y_max <= outer.y_max;
+}
+
+/**
+ * Replaces every pair of overlapping rectangles by their union until none overlap.
+*/
+static void mergeOverlapping(void) {
+    if (rects_merged) {
+        return;
+    }
+    rects_merged = true;
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < rect_count; i++) {
+            for (int j = i + 1; j < rect_count; j++) {
+                if (frameRectsOverlap(rects[i], rects[j])) {
+                    rects[i] = frameRectUnion(rects[i], rects[j]);
+                    rects[j] = rects[--rect_count];
+                    //The grown rectangle may now overlap ones already checked
+                    merged = true;
+                    j = i;
+                }
+            }
+        }
+    }
+}
+
+void dirtyAdd(int x_min, int y_min, int x_max, int y_max) {
+    struct FrameRect rect = {
+        x_min > 0 ? x_min : 0,
+        y_min > 0 ? y_min : 0,
+        x_max < frame.width ? x_max : frame.width,
+        y_max < frame.height ? y_max : frame.height
+    };
+    if (rect.x_min >= rect.x_max || rect.y_min >= rect.y_max) {
+        return;
+    }
+
+    for (int i = 0; i < rect_count; i++) {
+        if (rectContains(rects[i], rect)) {
+            return;
+        }
+    }
+
+    rects_merged = false;
+    if (rect_count < DIRTY_MAX_RECTS) {
+        rects[rect_count++] = rect;
+    } else {
+        //Full, so grow whichever rectangle needs the fewest extra pixels to take it in
+        int best = frameRectGrowsLeast(rects, rect_count, rect);
+        rects[best] = frameRectUnion(rects[best], rect);
+    }
+
+    //Past a point, copying the whole frame in one go beats copying lots of pieces of it.
+    //Overlapping rectangles count their shared pixels twice, so the sum is only a bound:
+    //while it stays under the limit there's no need to merge them to find the real area.
+    int64_t limit = (int64_t)frame.width*frame.height*DIRTY_FULL_FRAME_PERCENT;
+    int64_t area = 0;
+    for (int i = 0; i < rect_count; i++) {
+        area += frameRectArea(rects[i]);
+    }
+    if (area*100 > limit && dirtyArea()*100 > limit) {
+        dirtyAddFrame();
+    }
+}
+
+void dirtyAddFrame(void) {
+    rect_count = 0;
+    rects_merged = true;
+    if (frame.width > 0 && frame.height > 0) {
+        struct FrameRect rect = {0, 0, frame.width, frame.height};
+        rects[rect_count++] = rect;
+    }
+}
+
+void dirtyReset(void) {
+    rect_count = 0;
+    rects_merged = true;
+}
+
+const struct FrameRect *dirtyRects(int *count) {
+    mergeOverlapping();
+    *count = rect_count;
+    return rects;
+}
+
+int64_t dirtyArea(void) {
+    mergeOverlapping();
+    int64_t area = 0;
+    for (int i = 0; i < rect_count; i++) {
+        area += frameRectArea(rects[i]);
+    }
+    return area;
+}
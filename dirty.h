@@ -0,0 +1,51 @@
+/**
+ * List of the rectangles of the frame which changed since it was last presented,
+ * so presenting (or streaming) a frame only has to copy those.
+ * Only the thread recording and presenting frames may use it.
+ * @file dirty.h
+ * @author ABM
+*/
+#ifndef DIRTY_H
+#define DIRTY_H
+
+#include "framebuffer.h"
+
+/** Most rectangles kept at once, past this new ones are merged into the one they grow the least. */
+#define DIRTY_MAX_RECTS 256
+
+/** Once the rectangles add up to this much of the frame, the whole frame is marked instead. */
+#define DIRTY_FULL_FRAME_PERCENT 50
+
+/**
+ * Marks a rectangle of the frame as changed.
+ * @param x_min x coordinate of the left column of the rectangle
+ * @param y_min y coordinate of the bottom row of the rectangle
+ * @param x_max x coordinate one past the right column of the rectangle
+ * @param y_max y coordinate one past the top row of the rectangle
+*/
+void dirtyAdd(int x_min, int y_min, int x_max, int y_max);
+
+/**
+ * Marks the whole frame as changed.
+*/
+void dirtyAddFrame(void);
+
+/**
+ * Forgets every changed rectangle, called once the frame has been presented.
+*/
+void dirtyReset(void);
+
+/**
+ * Gets the changed rectangles, none of which overlap.
+ * @param count Set to the number of rectangles.
+ * @return The rectangles, valid until the next call to any dirty function.
+*/
+const struct FrameRect *dirtyRects(int *count);
+
+/**
+ * Adds up the area of the changed rectangles.
+ * @return Number of pixels inside the changed rectangles.
+*/
+int64_t dirtyArea(void);
+
+#endif
@@ -0,0 +1,328 @@
+/**
+ * Vectorized 32 bit fill kernels for clearing the frame and filling spans and rectangles.
+ * Each kernel writes single pixels until the pointer is aligned to its vector size,
+ * fills whole vectors, then writes the remaining tail pixels one at a time.
+ * @file fill.c
+ * @author ABM
+*/
+#include "fill.h"
+#include "framebuffer.h"
+#include "simd.h"
+
+/**
+ * A fill kernel, sets count consecutive pixels to color.
+*/
+typedef void (*FillFunction)(uint32_t *pixels, size_t count, uint32_t color);
+
+/**
+ * Sets pixels one at a time.
+ * @param pixels First pixel to set.
+ * @param count Number of pixels to set.
+ * @param color Color to set them to.
+*/
+static void fillScalar(uint32_t *pixels, size_t count, uint32_t color) {
+    for (size_t i = 0; i < count; i++) {
+        pixels[i] = color;
+    }
+}
+
+#ifdef SIMD_X86
+
+/**
+ * Sets pixels 4 at a time with SSE2 stores.
+ * @param pixels First pixel to set.
+ * @param count Number of pixels to set.
+ * @param color Color to set them to.
+*/
+static void fillSse2(uint32_t *pixels, size_t count, uint32_t color) {
+    while (count > 0 && ((uintptr_t)pixels & 15)) {
+        *pixels++ = color;
+        count--;
+    }
+    __m128i colors = _mm_set1_epi32((int)color);
+    for (; count >= 16; count -= 16, pixels += 16) {
+        _mm_store_si128((__m128i *)pixels, colors);
+        _mm_store_si128((__m128i *)pixels + 1, colors);
+        _mm_store_si128((__m128i *)pixels + 2, colors);
+        _mm_store_si128((__m128i *)pixels + 3, colors);
+    }
+    for (; count >= 4; count -= 4, pixels += 4) {
+        _mm_store_si128((__m128i *)pixels, colors);
+    }
+    while (count > 0) {
+        *pixels++ = color;
+        count--;
+    }
+}
+
+/**
+ * Sets pixels 4 at a time with SSE2 non-temporal stores, which bypass the cache.
+ * @param pixels First pixel to set.
+ * @param count Number of pixels to set.
+ * @param color Color to set them to.
+*/
+static void streamSse2(uint32_t *pixels, size_t count, uint32_t color) {
+    while (count > 0 && ((uintptr_t)pixels & 15)) {
+        *pixels++ = color;
+        count--;
+    }
+    __m128i colors = _mm_set1_epi32((int)color);
+    for (; count >= 16; count -= 16, pixels += 16) {
+        _mm_stream_si128((__m128i *)pixels, colors);
+        _mm_stream_si128((__m128i *)pixels + 1, colors);
+        _mm_stream_si128((__m128i *)pixels + 2, colors);
+        _mm_stream_si128((__m128i *)pixels + 3, colors);
+    }
+    for (; count >= 4; count -= 4, pixels += 4) {
+        _mm_stream_si128((__m128i *)pixels, colors);
+    }
+    //Non-temporal stores are weakly ordered, make them visible before returning
+    _mm_sfence();
+    while (count > 0) {
+        *pixels++ = color;
+        count--;
+    }
+}
+
+/**
+ * Sets pixels 8 at a time with AVX2 stores.
+ * @param pixels First pixel to set.
+ * @param count Number of pixels to set.
+ * @param color Color to set them to.
+*/
+TARGET_AVX2 static void fillAvx2(uint32_t *pixels, size_t count, uint32_t color) {
+    while (count > 0 && ((uintptr_t)pixels & 31)) {
+        *pixels++ = color;
+        count--;
+    }
+    __m256i colors = _mm256_set1_epi32((int)color);
+    for (; count >= 32; count -= 32, pixels += 32) {
+        _mm256_store_si256((__m256i *)pixels, colors);
+        _mm256_store_si256((__m256i *)pixels + 1, colors);
+        _mm256_store_si256((__m256i *)pixels + 2, colors);
+        _mm256_store_si256((__m256i *)pixels + 3, colors);
+    }
+    for (; count >= 8; count -= 8, pixels += 8) {
+        _mm256_store_si256((__m256i *)pixels, colors);
+    }
+    while (count > 0) {
+        *pixels++ = color;
+        count--;
+    }
+}
+
+/**
+ * Sets pixels 8 at a time with AVX2 non-temporal stores, which bypass the cache.
+ * @param pixels First pixel to set.
+ * @param count Number of pixels to set.
+ * @param color Color to set them to.
+*/
+TARGET_AVX2 static void streamAvx2(uint32_t *pixels, size_t count, uint32_t color) {
+    while (count > 0 && ((uintptr_t)pixels & 31)) {
+        *pixels++ = color;
+        count--;
+    }
+    __m256i colors = _mm256_set1_epi32((int)color);
+    for (; count >= 32; count -= 32, pixels += 32) {
+        _mm256_stream_si256((__m256i *)pixels, colors);
+        _mm256_stream_si256((__m256i *)pixels + 1, colors);
+        _mm256_stream_si256((__m256i *)pixels + 2, colors);
+        _mm256_stream_si256((__m256i *)pixels + 3, colors);
+    }
+    for (; count >= 8; count -= 8, pixels += 8) {
+        _mm256_stream_si256((__m256i *)pixels, colors);
+    }
+    //Non-temporal stores are weakly ordered, make them visible before returning
+    _mm_sfence();
+    while (count > 0) {
+        *pixels++ = color;
+        count--;
+    }
+}
+
+#endif
+
+//Kernels by enum FillKernel, NULL where they weren't compiled in.
+static const struct {
+    const char *name;
+    FillFunction fill;
+    FillFunction stream;
+} kernels[FILL_KERNEL_COUNT] = {
+    [FILL_SCALAR] = {"scalar", fillScalar, fillScalar},
+#ifdef SIMD_X86
+    [FILL_SSE2] = {"sse2", fillSse2, streamSse2},
+    [FILL_AVX2] = {"avx2", fillAvx2, streamAvx2},
+#else
+    [FILL_SSE2] = {"sse2", NULL, NULL},
+    [FILL_AVX2] = {"avx2", NULL, NULL},
+#endif
+};
+
+//The kernel in use, and whether fillInit has picked it yet.
+static enum FillKernel current_kernel = FILL_SCALAR;
+static bool initialized = false;
+
+void fillInit(void) {
+    current_kernel = FILL_SCALAR;
+    for (int kernel = FILL_KERNEL_COUNT - 1; kernel > FILL_SCALAR; kernel--) {
+        if (fillKernelSupported(kernel)) {
+            current_kernel = kernel;
+            break;
+        }
+    }
+    initialized = true;
+}
+
+bool fillKernelSupported(enum FillKernel kernel) {
+    switch (kernel) {
+        case FILL_SCALAR:
+            return true;
+        case FILL_SSE2:
+            return simdSupported(SIMD_SSE2);
+        case FILL_AVX2:
+            return simdSupported(SIMD_AVX2);
+        default:
+            return false;
+    }
+}
+
+bool fillSetKernel(enum FillKernel kernel) {
+    if (!fillKernelSupported(kernel)) {
+        return false;
+    }
+    current_kernel = kernel;
+    initialized = true;
+    return true;
+}
+
+enum FillKernel fillGetKernel(void) {
+    if (!initialized) {
+        fillInit();
+    }
+    return current_kernel;
+}
+
+const char *fillKernelName(enum FillKernel kernel) {
+    return kernel < FILL_KERNEL_COUNT ? kernels[kernel].name : "unknown";
+}
+
+void fillPixels(uint32_t *pixels, size_t count, uint32_t color) {
+    if (!initialized) {
+        fillInit();
+    }
+    kernels[current_kernel].fill(pixels, count, color);
+}
+
+/**
+ * Fills a rectangle of a tiled frame a tile at a time. The rows of a tile are stored
+ * one after the other, so wherever the rectangle covers a tile's whole width its rows
+ * in that tile are a single run, and rows of tiles as wide as the frame are one run altogether.
+ * @param rect The rectangle, inside the clip rectangle and not empty.
+ * @param color Color to fill it with.
+ * @param fill The kernel to fill the runs with.
+*/
+static void fillTiles(struct FrameRect rect, uint32_t color, FillFunction fill) {
+    int mask = FRAME_TILE_SIZE - 1;
+    if (rect.x_min == 0 && rect.x_max == frame.width) {
+        //The padding rows above the top of the frame can be set too
+        int y_start = (rect.y_min + mask) & ~mask;
+        int y_end = rect.y_max == frame.height ? (rect.y_max + mask) & ~mask : rect.y_max & ~mask;
+        if (y_start < y_end) {
+            fill(frame.pixels + (size_t)y_start*frame.stride, (size_t)(y_end - y_start)*frame.stride, color);
+            struct FrameRect below = rect;
+            struct FrameRect above = rect;
+            below.y_max = y_start;
+            above.y_min = y_end;
+            if (below.y_min < below.y_max) {
+                fillTiles(below, color, fill);
+            }
+            if (above.y_min < above.y_max) {
+                fillTiles(above, color, fill);
+            }
+            return;
+        }
+    }
+
+    for (int y = rect.y_min; y < rect.y_max; ) {
+        int band_end = (y | mask) + 1 < rect.y_max ? (y | mask) + 1 : rect.y_max;
+        for (int x = rect.x_min; x < rect.x_max; ) {
+            int run_end = (x | mask) + 1 < rect.x_max ? (x | mask) + 1 : rect.x_max;
+            uint32_t *pixels = frame.pixels + frameTileOffset(x, y, frame.stride);
+            if (run_end - x == FRAME_TILE_SIZE) {
+                fill(pixels, (size_t)(band_end - y)*FRAME_TILE_SIZE, color);
+            } else {
+                for (int row = 0; row < band_end - y; row++) {
+                    fill(pixels + row*FRAME_TILE_SIZE, run_end - x, color);
+                }
+            }
+            x = run_end;
+        }
+        y = band_end;
+    }
+}
+
+void fillClear(uint32_t color) {
+    if (!initialized) {
+        fillInit();
+    }
+    struct FrameRect clip = frameClip();
+    if (clip.x_min >= clip.x_max || clip.y_min >= clip.y_max) {
+        return;
+    }
+    if (frame.layout == FRAME_LAYOUT_TILES) {
+        fillTiles(clip, color, kernels[current_kernel].stream);
+        return;
+    }
+
+    //Rows as wide as the frame are one contiguous run of pixels,
+    //setting the padding between them too is harmless
+    if (clip.x_min == 0 && clip.x_max == frame.width) {
+        kernels[current_kernel].stream(frame.pixels + (size_t)clip.y_min*frame.stride,
+                                       (size_t)(clip.y_max - clip.y_min)*frame.stride,
+                                       color);
+        return;
+    }
+
+    for (int row = clip.y_min; row < clip.y_max; row++) {
+        kernels[current_kernel].stream(frame.pixels + clip.x_min + (size_t)row*frame.stride,
+                                       clip.x_max - clip.x_min,
+                                       color);
+    }
+}
+
+void fillRect(int x, int y, int width, int height, uint32_t color) {
+    //One intersection with the clip rectangle for the whole rectangle
+    struct FrameRect clip = frameClip();
+    int x_end = x + width;
+    int y_end = y + height;
+    if (x < clip.x_min) {
+        x = clip.x_min;
+    }
+    if (y < clip.y_min) {
+        y = clip.y_min;
+    }
+    if (x_end > clip.x_max) {
+        x_end = clip.x_max;
+    }
+    if (y_end > clip.y_max) {
+        y_end = clip.y_max;
+    }
+    if (x >= x_end || y >= y_end) {
+        return;
+    }
+    if (frame.layout == FRAME_LAYOUT_TILES) {
+        struct FrameRect rect = {x, y, x_end, y_end};
+        fillTiles(rect, color, fillPixels);
+        return;
+    }
+
+    //Rectangles as wide as the frame are one contiguous run of pixels
+    if (x == 0 && x_end == frame.width) {
+        fillPixels(frame.pixels + (size_t)y*frame.stride, (size_t)(y_end - y)*frame.stride, color);
+        return;
+    }
+
+    for (int row = y; row < y_end; row++) {
+        fillPixels(frame.pixels + x + (size_t)row*frame.stride, x_end - x, color);
+    }
+}
@@ -0,0 +1,81 @@
+/**
+ * Vectorized 32 bit fill kernels for clearing the frame and filling spans and rectangles.
+ * The fastest kernel the CPU supports is picked at startup by fillInit.
+ * @file fill.h
+ * @author ABM
+*/
+#ifndef FILL_H
+#define FILL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** The fill kernel implementations, from slowest to fastest. */
+enum FillKernel {
+    FILL_SCALAR,
+    FILL_SSE2,
+    FILL_AVX2,
+    FILL_KERNEL_COUNT
+};
+
+/**
+ * Picks the fastest kernel the CPU supports, using CPUID.
+ * Called once at startup, the fills also call it themselves if it wasn't.
+*/
+void fillInit(void);
+
+/**
+ * Checks whether a kernel can run on this CPU (and was compiled in).
+ * @param kernel The kernel to check.
+ * @return true if the kernel can be used.
+*/
+bool fillKernelSupported(enum FillKernel kernel);
+
+/**
+ * Forces a specific kernel, for benchmarking.
+ * @param kernel The kernel to use from now on.
+ * @return false (and nothing changes) if the kernel isn't supported.
+*/
+bool fillSetKernel(enum FillKernel kernel);
+
+/**
+ * Gets the kernel currently in use.
+ * @return The kernel in use.
+*/
+enum FillKernel fillGetKernel(void);
+
+/**
+ * Gets the name of a kernel.
+ * @param kernel The kernel.
+ * @return Short lower case name, like "avx2".
+*/
+const char *fillKernelName(enum FillKernel kernel);
+
+/**
+ * Sets count consecutive pixels to color.
+ * @param pixels First pixel to set.
+ * @param count Number of pixels to set.
+ * @param color Color to set them to.
+*/
+void fillPixels(uint32_t *pixels, size_t count, uint32_t color);
+
+/**
+ * Sets every pixel of the frame (inside the clip rectangle) to color.
+ * Uses non-temporal stores, since a whole frame does not fit in cache
+ * and is not read again until it is presented.
+ * @param color Color to clear the frame to.
+*/
+void fillClear(uint32_t color);
+
+/**
+ * Fills a rectangle of the frame, clipped to the clip rectangle.
+ * @param x x coordinate of the left edge of the rectangle
+ * @param y y coordinate of the bottom edge of the rectangle
+ * @param width width of the rectangle, in pixels
+ * @param height height of the rectangle, in pixels
+ * @param color color of the rectangle
+*/
+void fillRect(int x, int y, int width, int height, uint32_t color);
+
+#endif
@@ -0,0 +1,406 @@
+/**
+ * Platform neutral framebuffer which all of the drawing code writes into.
+ * @file framebuffer.c
+ * @author ABM
+*/
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+#include "framebuffer.h"
+#include "thread.h"
+#include "dirty.h"
+#include "fill.h"
+#include "simd.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+struct Frame frame = {0};
+
+//Rectangle the current thread may draw into, if clip_active is set.
+static THREAD_LOCAL struct FrameRect clip;
+static THREAD_LOCAL bool clip_active = false;
+
+//The pixel array allocation and its size in bytes, kept while the frame is empty
+static uint32_t *pool = NULL;
+static size_t pool_capacity = 0;
+
+//Function called by framePresent, and the data it is called with.
+static FramePresentHook present_hook = NULL;
+static void *present_hook_data = NULL;
+
+/**
+ * Rounds an allocation size up to the next of the FRAME_CAPACITY_STEPS sizes
+ * between two powers of two.
+ * @param size Number of bytes needed.
+ * @return Number of bytes to allocate.
+*/
+static size_t capacityFor(size_t size) {
+    if (size <= FRAME_MIN_CAPACITY) {
+        return FRAME_MIN_CAPACITY;
+    }
+    size_t power = FRAME_MIN_CAPACITY;
+    while (power*2 < size) {
+        power *= 2;
+    }
+    size_t step = power/FRAME_CAPACITY_STEPS;
+    return (size + step - 1)/step*step;
+}
+
+/**
+ * Moves what was drawn into a pixel array laid out for the new size,
+ * then clears the pixels which had nothing drawn into them.
+ * The two arrays may be the same, rows are then moved in an order
+ * which never overwrites a row still to be moved.
+ * @param pixels The pixel array to fill.
+ * @param width New width of the frame.
+ * @param height New height of the frame.
+ * @param stride New stride of the frame.
+*/
+static void relayout(uint32_t *pixels, int width, int height, int stride) {
+    int kept_width = frame.pixels ? (width < frame.width ? width : frame.width) : 0;
+    int kept_height = frame.pixels ? (height < frame.height ? height : frame.height) : 0;
+    size_t row_size = (size_t)kept_width*sizeof(uint32_t);
+
+    if (pixels != frame.pixels || stride < frame.stride) {
+        for (int y = 0; y < kept_height; y++) {
+            memmove(pixels + (size_t)y*stride, frame.pixels + (size_t)y*frame.stride, row_size);
+        }
+    } else if (stride > frame.stride) {
+        for (int y = kept_height - 1; y >= 0; y--) {
+            memmove(pixels + (size_t)y*stride, frame.pixels + (size_t)y*frame.stride, row_size);
+        }
+    }
+
+    //Clear right of the kept pixels, padding included, then every row above them
+    if (kept_width < stride) {
+        for (int y = 0; y < kept_height; y++) {
+            fillPixels(pixels + kept_width + (size_t)y*stride, stride - kept_width, 0);
+        }
+    }
+    fillPixels(pixels + (size_t)kept_height*stride, (size_t)(height - kept_height)*stride, 0);
+}
+
+/**
+ * Copies one row of a tile, FRAME_TILE_SIZE pixels.
+ * @param destination Where the pixels go.
+ * @param source The pixels to copy.
+*/
+static void copyTileRow(uint32_t *destination, const uint32_t *source) {
+#ifdef SIMD_X86
+    for (int i = 0; i < FRAME_TILE_SIZE; i += 4) {
+        _mm_storeu_si128((__m128i *)(destination + i), _mm_loadu_si128((const __m128i *)(source + i)));
+    }
+#else
+    memcpy(destination, source, FRAME_TILE_SIZE*sizeof(uint32_t));
+#endif
+}
+
+/**
+ * Copies pixels of one row between a tiled frame and a row by row array, one at a time.
+ * @param x_start x coordinate of the first pixel.
+ * @param x_end x coordinate one past the last pixel.
+ * @param y Row of the pixels.
+ * @param pixels The array, with pixel x_start first.
+ * @param to_frame true to copy the array into the frame, false to copy the frame into the array.
+*/
+static void copyTilePixels(int x_start, int x_end, int y, uint32_t *pixels, bool to_frame) {
+    for (int x = x_start; x < x_end; x++) {
+        uint32_t *pixel = frame.pixels + frameTileOffset(x, y, frame.stride);
+        if (to_frame) {
+            *pixel = pixels[x - x_start];
+        } else {
+            pixels[x - x_start] = *pixel;
+        }
+    }
+}
+
+/**
+ * Copies a rectangle between the frame and a pixel array laid out row by row.
+ * In a tiled frame a row of the rectangle is spread over one row of each tile it crosses,
+ * those are copied whole and only the partly covered tiles at either end pixel by pixel.
+ * @param rect The rectangle, inside the frame.
+ * @param pixels The row by row array, with the bottom left pixel of the rectangle first.
+ * @param pixels_stride Pixels from one row of the array to the next.
+ * @param to_frame true to copy the array into the frame, false to copy the frame into the array.
+*/
+static void copyRect(const struct FrameRect *rect, uint32_t *pixels, int pixels_stride, bool to_frame) {
+    size_t row_size = (size_t)(rect->x_max - rect->x_min)*sizeof(uint32_t);
+    //Columns of the tiles the rectangle covers the whole width of
+    int whole_start = (rect->x_min + FRAME_TILE_SIZE - 1) & ~(FRAME_TILE_SIZE - 1);
+    int whole_end = rect->x_max & ~(FRAME_TILE_SIZE - 1);
+    if (whole_start >= whole_end) {
+        whole_start = rect->x_max;
+        whole_end = rect->x_max;
+    }
+
+    for (int y = rect->y_min; y < rect->y_max; y++) {
+        uint32_t *row = pixels + (size_t)(y - rect->y_min)*pixels_stride;
+        if (frame.layout == FRAME_LAYOUT_ROWS) {
+            uint32_t *frame_row = frame.pixels + rect->x_min + (size_t)y*frame.stride;
+            memcpy(to_frame ? frame_row : row, to_frame ? row : frame_row, row_size);
+            continue;
+        }
+
+        copyTilePixels(rect->x_min, whole_start, y, row, to_frame);
+        ptrdiff_t offset = frameTileOffset(whole_start, y, frame.stride);
+        uint32_t *row_pixel = row + (whole_start - rect->x_min);
+        for (int x = whole_start; x < whole_end; x += FRAME_TILE_SIZE) {
+            uint32_t *tile_row = frame.pixels + offset;
+            copyTileRow(to_frame ? tile_row : row_pixel, to_frame ? row_pixel : tile_row);
+            offset += FRAME_TILE_SIZE*FRAME_TILE_SIZE;
+            row_pixel += FRAME_TILE_SIZE;
+        }
+        copyTilePixels(whole_end, rect->x_max, y, row + (whole_end - rect->x_min), to_frame);
+    }
+}
+
+void *frameAlignedAlloc(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, FRAME_ALIGNMENT);
+#else
+    void *memory = NULL;
+    if (posix_memalign(&memory, FRAME_ALIGNMENT, size) != 0) {
+        return NULL;
+    }
+    return memory;
+#endif
+}
+
+void frameAlignedFree(void *memory) {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+bool frameResize(int width, int height) {
+    //Negative sizes can come from a minimized window, treat them as empty
+    if (width < 0) {
+        width = 0;
+    }
+    if (height < 0) {
+        height = 0;
+    }
+
+    if (width == frame.width && height == frame.height) {
+        return true;
+    }
+
+    //Round rows up to whole cache lines so every row starts aligned,
+    //and the height up to whole tiles so the frame can be tiled
+    int row_alignment = FRAME_ALIGNMENT/sizeof(uint32_t);
+    int stride = (width + row_alignment - 1)/row_alignment*row_alignment;
+    size_t rows = ((size_t)height + FRAME_TILE_SIZE - 1)/FRAME_TILE_SIZE*FRAME_TILE_SIZE;
+    size_t size = (size_t)stride*rows*sizeof(uint32_t);
+
+    //Nothing to draw into for an empty frame, but keep the size
+    //so the window dimensions are still known, and keep the allocation
+    //for when the window comes back
+    if (size == 0) {
+        frame.pixels = NULL;
+        frame.width = width;
+        frame.height = height;
+        frame.stride = stride;
+        return true;
+    }
+
+    //Tiles can't be moved around row by row, so a tiled frame keeps what was drawn
+    //in a row by row copy and tiles it again once the frame has its new size
+    bool tiled = frame.layout == FRAME_LAYOUT_TILES;
+    struct FrameRect kept_rect = {0, 0, 0, 0};
+    uint32_t *kept = NULL;
+    if (tiled && frame.pixels) {
+        kept_rect.x_max = width < frame.width ? width : frame.width;
+        kept_rect.y_max = height < frame.height ? height : frame.height;
+        kept = malloc((size_t)kept_rect.x_max*kept_rect.y_max*sizeof(uint32_t) + 1);
+        if (!kept) {
+            return false;
+        }
+        copyRect(&kept_rect, kept, kept_rect.x_max, false);
+    }
+
+    uint32_t *pixels = pool;
+    if (size > pool_capacity) {
+        size_t capacity = capacityFor(size);
+        pixels = frameAlignedAlloc(capacity);
+        if (!pixels) {
+            free(kept);
+            return false;
+        }
+        if (!tiled) {
+            relayout(pixels, width, height, stride);
+        }
+        frameAlignedFree(pool);
+        pool = pixels;
+        pool_capacity = capacity;
+    } else if (!tiled) {
+        relayout(pixels, width, height, stride);
+    }
+
+    frame.pixels = pixels;
+    frame.width = width;
+    frame.height = height;
+    frame.stride = stride;
+    if (tiled) {
+        fillPixels(pixels, size/sizeof(uint32_t), 0);
+        if (kept) {
+            copyRect(&kept_rect, kept, kept_rect.x_max, true);
+            free(kept);
+        }
+    }
+    //The whole resized frame has to be shown, not only what gets drawn into it
+    dirtyAddFrame();
+    return true;
+}
+
+void frameFree(void) {
+    frameAlignedFree(pool);
+    pool = NULL;
+    pool_capacity = 0;
+    frame.pixels = NULL;
+    frame.width = 0;
+    frame.height = 0;
+    frame.stride = 0;
+}
+
+bool frameSetLayout(enum FrameLayout layout) {
+    if (layout == frame.layout || !frame.pixels) {
+        frame.layout = layout;
+        return true;
+    }
+
+    //Both layouts take the same room, but a pixel's new place can hold one
+    //not moved yet, so the pixels go through a row by row copy
+    struct FrameRect whole = {0, 0, frame.width, frame.height};
+    uint32_t *copy = malloc((size_t)frame.width*frame.height*sizeof(uint32_t));
+    if (!copy) {
+        return false;
+    }
+    copyRect(&whole, copy, frame.width, false);
+    frame.layout = layout;
+    copyRect(&whole, copy, frame.width, true);
+    free(copy);
+    return true;
+}
+
+const char *frameLayoutName(enum FrameLayout layout) {
+    static const char *names[FRAME_LAYOUT_COUNT] = {"rows", "tiles"};
+    return layout < FRAME_LAYOUT_COUNT ? names[layout] : "unknown";
+}
+
+void frameReadPixels(const struct FrameRect *rect, uint32_t *destination, int destination_stride) {
+    copyRect(rect, destination, destination_stride, false);
+}
+
+void frameWritePixels(const struct FrameRect *rect, const uint32_t *source, int source_stride) {
+    //Only read when copying into the frame
+    copyRect(rect, (uint32_t *)source, source_stride, true);
+}
+
+void frameSetClip(int x_min, int y_min, int x_max, int y_max) {
+    clip.x_min = x_min;
+    clip.y_min = y_min;
+    clip.x_max = x_max;
+    clip.y_max = y_max;
+    clip_active = true;
+}
+
+void frameResetClip(void) {
+    clip_active = false;
+}
+
+struct FrameRect frameClip(void) {
+    struct FrameRect rect = {0, 0, frame.width, frame.height};
+    //Without a pixel array there is nothing to draw into
+    if (!frame.pixels) {
+        rect.x_max = 0;
+        rect.y_max = 0;
+        return rect;
+    }
+    if (clip_active) {
+        if (clip.x_min > rect.x_min) {
+            rect.x_min = clip.x_min;
+        }
+        if (clip.y_min > rect.y_min) {
+            rect.y_min = clip.y_min;
+        }
+        if (clip.x_max < rect.x_max) {
+            rect.x_max = clip.x_max;
+        }
+        if (clip.y_max < rect.y_max) {
+            rect.y_max = clip.y_max;
+        }
+    }
+    return rect;
+}
+
+int64_t frameRectArea(struct FrameRect rect) {
+    return (int64_t)(rect.x_max - rect.x_min)*(rect.y_max - rect.y_min);
+}
+
+struct FrameRect frameRectUnion(struct FrameRect a, struct FrameRect b) {
+    struct FrameRect rect = a;
+    if (b.x_min < rect.x_min) {
+        rect.x_min = b.x_min;
+    }
+    if (b.y_min < rect.y_min) {
+        rect.y_min = b.y_min;
+    }
+    if (b.x_max > rect.x_max) {
+        rect.x_max = b.x_max;
+    }
+    if (b.y_max > rect.y_max) {
+        rect.y_max = b.y_max;
+    }
+    return rect;
+}
+
+bool frameRectsOverlap(struct FrameRect a, struct FrameRect b) {
+    return a.x_min < b.x_max && b.x_min < a.x_max && a.y_min < b.y_max && b.y_min < a.y_max;
+}
+
+int frameRectGrowsLeast(const struct FrameRect *rects, int count, struct FrameRect rect) {
+    int best = 0;
+    int64_t best_growth = INT64_MAX;
+    for (int i = 0; i < count; i++) {
+        int64_t growth = frameRectArea(frameRectUnion(rects[i], rect)) - frameRectArea(rects[i]);
+        if (growth < best_growth) {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    return best;
+}
+
+uint64_t frameChecksum(void) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    //Row by row, the padding at the end of each row isn't part of the frame.
+    //A tiled frame hashes its pixels in the same order, so both layouts hash the same.
+    for (int y = 0; frame.pixels && y < frame.height; y++) {
+        const uint32_t *row = frame.pixels + (size_t)y*frame.stride;
+        for (int x = 0; x < frame.width; x++) {
+            uint32_t pixel = frame.layout == FRAME_LAYOUT_TILES ? frame.pixels[frameTileOffset(x, y, frame.stride)] : row[x];
+            for (int byte = 0; byte < 4; byte++) {
+                hash ^= (pixel >> (8*byte)) & 0xFF;
+                hash *= 0x100000001b3ull;
+            }
+        }
+    }
+    return hash;
+}
+
+void frameSetPresentHook(FramePresentHook hook, void *user_data) {
+    present_hook = hook;
+    present_hook_data = user_data;
+}
+
+void framePresent(void) {
+    if (present_hook) {
+        present_hook(present_hook_data);
+    }
+    dirtyReset();
+}
@@ -0,0 +1,250 @@
+/**
+ * Platform neutral framebuffer which all of the drawing code writes into.
+ * Backends (Win32/GDI, headless) own the presentation of the buffer
+ * and hook themselves in through framePresent.
+ * @file framebuffer.h
+ * @author ABM
+*/
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Alignment, in bytes, of the pixel array and of each row. One cache line, enough for any SIMD load. */
+#define FRAME_ALIGNMENT 64
+
+/** Smallest pixel array allocation, in bytes, so small windows don't reallocate on every resize. */
+#define FRAME_MIN_CAPACITY (1 << 20)
+
+/**
+ * Number of allocation sizes between two powers of two. A resize which needs a larger
+ * pixel array allocates the next of these sizes, so dragging the window bigger only
+ * reallocates now and then, and wastes at most 1/FRAME_CAPACITY_STEPS of the memory.
+*/
+#define FRAME_CAPACITY_STEPS 4
+
+/** Tiles of the tiled layout are 1 << FRAME_TILE_SHIFT pixels on a side. */
+#define FRAME_TILE_SHIFT 3
+
+/** Width and height of a tile, 8x8 pixels or 256 bytes, so a tile is 4 cache lines with 2 of its rows in each. */
+#define FRAME_TILE_SIZE (1 << FRAME_TILE_SHIFT)
+
+/**
+ * How the pixels are stored in the pixel array.
+*/
+enum FrameLayout {
+    //Row by row, pixel x, y is pixels[x + y*stride]
+    FRAME_LAYOUT_ROWS,
+    //FRAME_TILE_SIZE x FRAME_TILE_SIZE tiles, each stored row by row, and the tiles
+    //themselves stored row by row, see frameTileOffset. Pixels above and below each other
+    //are then FRAME_TILE_SIZE pixels apart instead of a whole row, so tall shapes touch
+    //fewer cache lines and pages, but the frame has to be put back into rows to be shown.
+    FRAME_LAYOUT_TILES,
+    FRAME_LAYOUT_COUNT
+};
+
+/**
+ * The pixel array and its dimensions.
+ * Pixels are 32 bit 0x00RRGGBB values with row 0 being the bottom of the window,
+ * stored row by row unless the layout was changed with frameSetLayout.
+ * Rows are padded to FRAME_ALIGNMENT bytes and the array has room for the height
+ * rounded up to whole tiles. Pixel x, y is pixels[frameOffset(x, y)] in either layout.
+*/
+struct Frame {
+    int width;
+    int height;
+    //Pixels from the start of one row to the start of the next, at least width
+    int stride;
+    uint32_t *pixels;
+    enum FrameLayout layout;
+};
+
+/** The frame every primitive draws into. */
+extern struct Frame frame;
+
+/**
+ * Rectangle of pixels from x_min, y_min up to but not including x_max, y_max.
+*/
+struct FrameRect {
+    int x_min;
+    int y_min;
+    int x_max;
+    int y_max;
+};
+
+/**
+ * Function called by framePresent to show the finished frame.
+ * @param user_data The pointer passed to frameSetPresentHook.
+*/
+typedef void (*FramePresentHook)(void *user_data);
+
+/**
+ * Allocates memory aligned to FRAME_ALIGNMENT, a cache line,
+ * for the pixel array and for other arrays written a cache line at a time.
+ * @param size Number of bytes to allocate.
+ * @return The memory, or NULL if the allocation failed.
+*/
+void *frameAlignedAlloc(size_t size);
+
+/**
+ * Frees memory returned by frameAlignedAlloc.
+ * @param memory The memory to free, may be NULL.
+*/
+void frameAlignedFree(void *memory);
+
+/**
+ * Resizes the frame. The pixel array is only reallocated when it has to grow
+ * past its capacity, shrinking reuses it.
+ * What was drawn is kept where it overlaps the new size and the rest is cleared to black.
+ * @param width New width of the frame, in pixels.
+ * @param height New height of the frame, in pixels.
+ * @return true if the frame has the requested size,
+ *         false if the allocation failed (the frame is then left as it was).
+*/
+bool frameResize(int width, int height);
+
+/**
+ * Releases the pixel array and resets the frame to an empty 0x0 frame.
+ * Unlike resizing to 0x0, this gives the memory back.
+*/
+void frameFree(void);
+
+/**
+ * Changes how the pixels are stored, moving what was drawn into the new layout.
+ * The frame keeps its layout across resizes.
+ * @param layout The new layout.
+ * @return true if the frame has the requested layout,
+ *         false if the copy the pixels are moved through couldn't be allocated.
+*/
+bool frameSetLayout(enum FrameLayout layout);
+
+/**
+ * Gets the name of a layout.
+ * @param layout The layout.
+ * @return Short lower case name, like "tiles".
+*/
+const char *frameLayoutName(enum FrameLayout layout);
+
+/**
+ * Index of pixel x, y in the pixel array of a tiled frame.
+ * @param x x coordinate of the pixel, inside the frame
+ * @param y y coordinate of the pixel, inside the frame
+ * @param stride frame.stride, passed in so loops writing pixels can keep it in a register
+ * @return The index.
+*/
+static inline ptrdiff_t frameTileOffset(int x, int y, int stride) {
+    ptrdiff_t tile = (ptrdiff_t)(y >> FRAME_TILE_SHIFT)*stride + ((x >> FRAME_TILE_SHIFT) << FRAME_TILE_SHIFT);
+    return tile*FRAME_TILE_SIZE + ((y & (FRAME_TILE_SIZE - 1)) << FRAME_TILE_SHIFT) + (x & (FRAME_TILE_SIZE - 1));
+}
+
+/**
+ * Index of pixel x, y in the pixel array, in the frame's layout.
+ * @param x x coordinate of the pixel, inside the frame
+ * @param y y coordinate of the pixel, inside the frame
+ * @return The index.
+*/
+static inline ptrdiff_t frameOffset(int x, int y) {
+    if (frame.layout == FRAME_LAYOUT_TILES) {
+        return frameTileOffset(x, y, frame.stride);
+    }
+    return x + (ptrdiff_t)y*frame.stride;
+}
+
+/**
+ * Copies a rectangle of the frame into a pixel array laid out row by row,
+ * a row of a tile at a time with vector loads and stores if the frame is tiled.
+ * This is how presenting and capturing read the frame, whatever its layout.
+ * @param rect The rectangle to copy, inside the frame.
+ * @param destination Where the bottom left pixel of the rectangle goes.
+ * @param destination_stride Pixels from one row of destination to the next.
+*/
+void frameReadPixels(const struct FrameRect *rect, uint32_t *destination, int destination_stride);
+
+/**
+ * Copies a pixel array laid out row by row into a rectangle of the frame,
+ * the other way from frameReadPixels.
+ * @param rect The rectangle to copy into, inside the frame.
+ * @param source Where the bottom left pixel of the rectangle comes from.
+ * @param source_stride Pixels from one row of source to the next.
+*/
+void frameWritePixels(const struct FrameRect *rect, const uint32_t *source, int source_stride);
+
+/**
+ * Restricts drawing on the calling thread to a rectangle of the frame.
+ * Every primitive clips against this rectangle instead of the whole frame,
+ * which lets several threads draw into their own part of the frame at once.
+ * @param x_min x coordinate of the left column of the rectangle
+ * @param y_min y coordinate of the bottom row of the rectangle
+ * @param x_max x coordinate one past the right column of the rectangle
+ * @param y_max y coordinate one past the top row of the rectangle
+*/
+void frameSetClip(int x_min, int y_min, int x_max, int y_max);
+
+/**
+ * Lets the calling thread draw into the whole frame again.
+*/
+void frameResetClip(void);
+
+/**
+ * Gets the rectangle the calling thread may draw into,
+ * which is the clip rectangle cut down to the frame.
+ * @return The rectangle, empty (min >= max) if nothing may be drawn.
+*/
+struct FrameRect frameClip(void);
+
+/**
+ * Gets the number of pixels in a rectangle.
+ * @param rect The rectangle.
+ * @return Its area.
+*/
+int64_t frameRectArea(struct FrameRect rect);
+
+/**
+ * Gets the smallest rectangle containing two rectangles.
+ * @param a The first rectangle.
+ * @param b The second rectangle.
+ * @return The bounding rectangle of both.
+*/
+struct FrameRect frameRectUnion(struct FrameRect a, struct FrameRect b);
+
+/**
+ * Tells whether two rectangles share any pixel.
+ * @param a The first rectangle.
+ * @param b The second rectangle.
+ * @return true if they overlap.
+*/
+bool frameRectsOverlap(struct FrameRect a, struct FrameRect b);
+
+/**
+ * Finds the rectangle of a full list which a new one grows the least, to merge it into.
+ * @param rects The list.
+ * @param count Number of rectangles in the list, at least 1.
+ * @param rect The new rectangle.
+ * @return Index of the rectangle whose union with rect has the fewest extra pixels.
+*/
+int frameRectGrowsLeast(const struct FrameRect *rects, int count, struct FrameRect rect);
+
+/**
+ * Computes a 64 bit FNV-1a hash of every pixel of the frame,
+ * for checking that two ways of drawing produce the same frame.
+ * @return The hash.
+*/
+uint64_t frameChecksum(void);
+
+/**
+ * Sets the function called by framePresent.
+ * @param hook The function to call, or NULL to make presenting a no-op.
+ * @param user_data Pointer handed back to the hook on every call.
+*/
+void frameSetPresentHook(FramePresentHook hook, void *user_data);
+
+/**
+ * Hands the finished frame to the backend for presentation.
+ * The hook can ask dirtyRects which parts of the frame changed,
+ * the list is emptied once the hook returns.
+*/
+void framePresent(void);
+
+#endif
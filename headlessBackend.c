@@ -0,0 +1,395 @@
+/**
+ * Headless backend which runs the animation into an offscreen frame
+ * without opening a window, for servers and for measuring throughput.
+ * @file headlessBackend.c
+ * @author ABM
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "framebuffer.h"
+#include "pixelDrawer.h"
+#include "commandList.h"
+#include "renderer.h"
+#include "fill.h"
+#include "blend.h"
+#include "benchmark.h"
+#include "timer.h"
+#include "dirty.h"
+#include "random.h"
+#include "profiler.h"
+#include "pacer.h"
+#include "swapChain.h"
+#include "capture.h"
+#include "scene.h"
+#include "retained.h"
+
+/** Number of frames to render when --frames is not given. */
+#define DEFAULT_FRAMES 1000
+
+/** Width of the offscreen frame when --width is not given, in pixels. */
+#define DEFAULT_WIDTH 1280
+
+/** Height of the offscreen frame when --height is not given, in pixels. */
+#define DEFAULT_HEIGHT 720
+
+/** Number of swap chain buffers when --buffers is not given. */
+#define DEFAULT_BUFFERS 3
+
+/**
+ * What the offscreen present thread has seen so far.
+*/
+struct PresentStats {
+    long frames_presented;
+    //Pixels inside the dirty rectangles of every presented frame, which is
+    //what a consumer streaming only the changes would have had to copy
+    int64_t dirty_pixels;
+    //Stands in for the window, every presented frame is copied into it
+    uint32_t *screen;
+    int width;
+    int height;
+    int stride;
+};
+
+/**
+ * Swap chain sink which copies the dirty rectangles of each frame to an offscreen
+ * screen and counts them, since there is no window to show them in.
+ * @param buffer The frame to present.
+ * @param user_data Pointer to the PresentStats.
+*/
+static void presentOffscreen(const struct SwapBuffer *buffer, void *user_data) {
+    struct PresentStats *stats = user_data;
+    stats->frames_presented++;
+    if (!stats->screen || buffer->width != stats->width || buffer->height != stats->height) {
+        free(stats->screen);
+        stats->screen = calloc((size_t)buffer->stride*buffer->height, sizeof(uint32_t));
+        stats->width = stats->screen ? buffer->width : 0;
+        stats->height = stats->screen ? buffer->height : 0;
+        stats->stride = stats->screen ? buffer->stride : 0;
+    }
+    for (int i = 0; i < buffer->rect_count; i++) {
+        const struct FrameRect *rect = &buffer->rects[i];
+        stats->dirty_pixels += (int64_t)(rect->x_max - rect->x_min)*(rect->y_max - rect->y_min);
+        if (!stats->screen) {
+            continue;
+        }
+        size_t row_size = (size_t)(rect->x_max - rect->x_min)*sizeof(uint32_t);
+        for (int y = rect->y_min; y < rect->y_max; y++) {
+            size_t offset = rect->x_min + (size_t)y*buffer->stride;
+            memcpy(stats->screen + offset, buffer->pixels + offset, row_size);
+        }
+    }
+}
+
+/**
+ * Prints how to use the program.
+ * @param program_name Name the program was started with.
+*/
+static void printUsage(const char *program_name) {
+    printf("Usage: %s [--frames N] [--width W] [--height H] [--threads N] [--pixels N] [--seed N]\n"
+           "       [--fps N] [--buffers N] [--profile FILE] [--overlay] [--capture FILE] [--capture-drop]\n"
+           "       [--scene FILE] [--save-scene FILE] [--antialias] [--tiled] [--retained]\n"
+           "       [--bench NAME]\n",
+           program_name);
+    printf("--threads 0 (the default) uses one thread per logical CPU.\n");
+    printf("--pixels sets how many random pixels are drawn per frame, --seed which ones.\n");
+    printf("--fps 0 (the default) draws frames as fast as possible, one animation step per frame,\n"
+           "so runs are reproducible. Otherwise the animation steps %d times per second of real time.\n",
+           ANIMATION_STEPS_PER_SECOND);
+    printf("--buffers sets how many frames can wait for the present thread, 1 to %d (default %d).\n",
+           SWAP_CHAIN_MAX_BUFFERS, DEFAULT_BUFFERS);
+    printf("--profile writes the frame times to FILE, as a Chrome trace if it ends in .json, CSV otherwise.\n");
+    printf("--overlay draws the frame time graph into the frames.\n");
+    printf("--capture records every frame to FILE: .y4m video, .png numbered images, raw BGRA otherwise.\n"
+           "With --capture-drop frames the writer can't keep up with are dropped instead of waited for.\n");
+    printf("--scene draws the shapes of a scene file every frame instead of the animation,\n"
+           "--save-scene writes it back out in the binary format, which loads without parsing.\n");
+    printf("--antialias draws circles and lines anti-aliased.\n");
+    printf("--tiled stores the frame in %dx%d tiles, put back into rows when presented or captured.\n",
+           FRAME_TILE_SIZE, FRAME_TILE_SIZE);
+    printf("--retained keeps the shapes from one frame to the next and only draws the ones which changed,\n"
+           "erasing where they were, instead of drawing every shape every frame. Not with --antialias.\n");
+    printf("Benchmarks:\n");
+    benchmarkList();
+}
+
+/**
+ * Starting point for the program.
+ * @param argc Number of command line arguments.
+ * @param argv The command line arguments.
+ * @return 0 if the program terminates successfully, non-zero otherwise.
+*/
+int main(int argc, char *argv[]) {
+    int frames = DEFAULT_FRAMES;
+    int width = DEFAULT_WIDTH;
+    int height = DEFAULT_HEIGHT;
+    int threads = 0;
+    int pixels = -1;
+    double fps = 0;
+    int buffers = DEFAULT_BUFFERS;
+    uint64_t seed = RANDOM_DEFAULT_SEED;
+    const char *bench = NULL;
+    const char *profile_path = NULL;
+    bool overlay = false;
+    const char *capture_path = NULL;
+    enum CapturePolicy capture_policy = CAPTURE_BLOCK;
+    const char *scene_path = NULL;
+    const char *save_scene_path = NULL;
+    bool antialias = false;
+    bool tiled = false;
+    bool retained_mode = false;
+
+    //Read the command line arguments, each option takes one value
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) {
+            frames = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--width") == 0) {
+            width = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--height") == 0) {
+            height = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) {
+            threads = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--pixels") == 0) {
+            pixels = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && strcmp(argv[i], "--fps") == 0) {
+            fps = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--buffers") == 0) {
+            buffers = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--profile") == 0) {
+            profile_path = argv[++i];
+        } else if (strcmp(argv[i], "--overlay") == 0) {
+            overlay = true;
+        } else if (i + 1 < argc && strcmp(argv[i], "--capture") == 0) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--capture-drop") == 0) {
+            capture_policy = CAPTURE_DROP;
+        } else if (i + 1 < argc && strcmp(argv[i], "--scene") == 0) {
+            scene_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--save-scene") == 0) {
+            save_scene_path = argv[++i];
+        } else if (strcmp(argv[i], "--antialias") == 0) {
+            antialias = true;
+        } else if (strcmp(argv[i], "--tiled") == 0) {
+            tiled = true;
+        } else if (strcmp(argv[i], "--retained") == 0) {
+            retained_mode = true;
+        } else if (i + 1 < argc && strcmp(argv[i], "--bench") == 0) {
+            bench = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (frames < 0 || width <= 0 || height <= 0 || threads < 0 || fps < 0 ||
+        buffers < 1 || buffers > SWAP_CHAIN_MAX_BUFFERS || (save_scene_path && !scene_path) ||
+        (retained_mode && antialias)) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    //Pick the fastest fill and blend kernels for this CPU
+    fillInit();
+    blendInit();
+
+    if (!frameResize(width, height)) {
+        printf("frameResize failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    //Benchmarks replace the animation entirely
+    if (bench) {
+        enum BenchmarkResult result = benchmarkRun(bench);
+        if (result == BENCHMARK_UNKNOWN) {
+            printUsage(argv[0]);
+        }
+        frameFree();
+        return result == BENCHMARK_PASSED ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    //Benchmarks pick their own layout, the animation draws into the one asked for
+    if (tiled && !frameSetLayout(FRAME_LAYOUT_TILES)) {
+        printf("frameSetLayout failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    //A scene file takes the place of the animation, and stays the same every frame
+    struct Scene scene;
+    if (scene_path) {
+        if (!sceneLoad(&scene, scene_path)) {
+            return EXIT_FAILURE;
+        }
+        if (save_scene_path && !sceneSave(&scene, save_scene_path)) {
+            printf("Writing %s failed.\n", save_scene_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    struct Renderer *renderer = rendererCreate(threads);
+    if (!renderer) {
+        printf("rendererCreate failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    //Frames are presented on their own thread while the next one is drawn
+    struct PresentStats stats = {0, 0, NULL, 0, 0, 0};
+    struct SwapChain *swap_chain = swapChainCreate(buffers, presentOffscreen, &stats);
+    if (!swap_chain) {
+        printf("swapChainCreate failed.\n");
+        return EXIT_FAILURE;
+    }
+    frameSetPresentHook(swapChainPresent, swap_chain);
+
+    //Everything which changes from one frame to the next.
+    struct Animation animation;
+    animationInit(&animation);
+    randomSeed(&animation.random, seed);
+    if (pixels >= 0) {
+        animation.random_pixels = pixels;
+    }
+
+    //The draw calls of the current frame
+    struct CommandList commands;
+    commandListInit(&commands);
+    commandListSetAntialias(&commands, antialias);
+
+    //Shapes kept between frames for --retained, ids given by the order they are recorded in
+    struct Retained retained;
+    retainedInit(&retained, 0);
+
+    struct FramePacer pacer;
+    pacerInit(&pacer, fps, ANIMATION_STEPS_PER_SECOND);
+
+    //Frames are written on their own thread, by default waiting for it so none are lost
+    struct Capture *capture = NULL;
+    if (capture_path) {
+        capture = captureCreate(capture_path, captureFormatFromPath(capture_path), capture_policy, fps);
+        if (!capture) {
+            printf("captureCreate failed.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint64_t start = timerNow();
+
+    //Same loop as the windowed backend, minus the message pump
+    for (int i = 0; i < frames; i++) {
+        profileFrameBegin();
+
+        profileStageBegin(PROFILE_RECORD);
+        commandListReset(&commands);
+        if (scene_path) {
+            sceneRecord(&scene, &commands);
+        } else {
+            animationRecord(&animation, &commands);
+        }
+        profileStageEnd(PROFILE_RECORD);
+
+        profileStageBegin(PROFILE_RASTERIZE);
+        if (retained_mode) {
+            retainedDrawList(&retained, &commands);
+        } else {
+            rendererExecute(renderer, &commands);
+        }
+        profileStageEnd(PROFILE_RASTERIZE);
+
+        if (overlay) {
+            profileStageBegin(PROFILE_OVERLAY);
+            //Counters of the frame just drawn, written under the frame rate
+            char counters[2][64];
+            snprintf(counters[0], sizeof(counters[0]), "%d shapes  %d commands",
+                     commandListShapeCount(&commands), commands.count);
+            snprintf(counters[1], sizeof(counters[1]), "radius %d  side %d",
+                     animation.circle_radius, animation.side_length);
+            const char *lines[2] = {counters[0], counters[1]};
+            profileDrawOverlay(lines, scene_path ? 1 : 2);
+            profileStageEnd(PROFILE_OVERLAY);
+        }
+
+        profileStageBegin(PROFILE_UPDATE);
+        int steps = pacerSteps(&pacer);
+        for (int step = 0; step < steps && !scene_path; step++) {
+            animationUpdate(&animation);
+        }
+        profileStageEnd(PROFILE_UPDATE);
+
+        profileStageBegin(PROFILE_PRESENT);
+        if (capture) {
+            captureFrame(capture);
+        }
+        framePresent();
+        profileStageEnd(PROFILE_PRESENT);
+
+        profileStageBegin(PROFILE_WAIT);
+        pacerWait(&pacer);
+        profileStageEnd(PROFILE_WAIT);
+
+        profileFrameEnd();
+    }
+
+    //Wait for the queued frames, the stats are only safe to read once the present thread stopped
+    swapChainDestroy(swap_chain);
+    frameSetPresentHook(NULL, NULL);
+    double elapsed = timerSeconds(start, timerNow());
+    if (capture) {
+        struct CaptureStats capture_stats;
+        bool written = captureDestroy(capture, &capture_stats);
+        printf("Captured %ld frames to %s, dropped %ld%s\n", capture_stats.frames_written, capture_path,
+               capture_stats.frames_dropped, written ? "" : ", writing failed");
+    }
+
+    printf("Rendered %ld frames at %dx%d on %d threads in %.3f s (%.1f frames/s)\n",
+           stats.frames_presented, frame.width, frame.height, rendererThreadCount(renderer), elapsed,
+           elapsed > 0 ? stats.frames_presented/elapsed : 0.0);
+    if (stats.frames_presented > 0) {
+        printf("Dirty rectangles covered %.1f%% of the frame on average\n",
+               100.0*stats.dirty_pixels/((double)stats.frames_presented*frame.width*frame.height));
+    }
+    //Statistics cover the last PROFILE_HISTORY frames
+    struct ProfileStats profile;
+    profileStats(&profile);
+    printf("Last %d frames: %.1f frames/s, p50 %.3f ms, p99 %.3f ms\n",
+           profile.frames, profile.fps, profile.frame_ms_p50, profile.frame_ms_p99);
+    printf("Average ms per frame:");
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        printf(" %s %.3f", profileStageName(stage), profile.stage_ms[stage]);
+    }
+    printf("\n");
+    if (profile_path) {
+        size_t length = strlen(profile_path);
+        bool trace = length >= 5 && strcmp(profile_path + length - 5, ".json") == 0;
+        if (!(trace ? profileExportTrace(profile_path) : profileExportCsv(profile_path))) {
+            printf("Writing %s failed.\n", profile_path);
+        }
+    }
+
+    //The same seed and options always give the same checksum
+    printf("Final frame checksum %016llx\n", (unsigned long long)frameChecksum());
+    if (frames > 0) {
+        bool match = stats.screen && stats.width == frame.width && stats.height == frame.height;
+        uint32_t *row = match ? malloc(frame.width*sizeof(uint32_t)) : NULL;
+        for (int y = 0; row && match && y < frame.height; y++) {
+            struct FrameRect rect = {0, y, frame.width, y + 1};
+            frameReadPixels(&rect, row, frame.width);
+            match = memcmp(stats.screen + (size_t)y*stats.stride, row, frame.width*sizeof(uint32_t)) == 0;
+        }
+        match = match && row;
+        free(row);
+        printf("Presented frame %s the final frame\n", match ? "matches" : "DIFFERS FROM");
+    }
+    free(stats.screen);
+
+    commandListFree(&commands);
+    retainedFree(&retained);
+    if (scene_path) {
+        sceneFree(&scene);
+    }
+    rendererDestroy(renderer);
+    frameFree();
+
+    return EXIT_SUCCESS;
+}
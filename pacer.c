@@ -0,0 +1,57 @@
+/**
+ * Frame pacing with a fixed simulation timestep and a sleep then spin wait.
+ * @file pacer.c
+ * @author ABM
+*/
+#include "pacer.h"
+#include "timer.h"
+
+void pacerInit(struct FramePacer *pacer, double target_fps, double steps_per_second) {
+    pacer->frame_ns = target_fps > 0 ? (uint64_t)(1e9/target_fps) : 0;
+    pacer->step_ns = steps_per_second > 0 ? (uint64_t)(1e9/steps_per_second) : 0;
+    pacer->deadline = timerNow();
+    pacer->last_time = pacer->deadline;
+    pacer->accumulator = 0;
+}
+
+int pacerSteps(struct FramePacer *pacer) {
+    if (pacer->frame_ns == 0 || pacer->step_ns == 0) {
+        return 1;
+    }
+
+    uint64_t now = timerNow();
+    pacer->accumulator += now - pacer->last_time;
+    pacer->last_time = now;
+
+    uint64_t steps = pacer->accumulator/pacer->step_ns;
+    //After a stall (a window drag, a debugger break) catching up step by step
+    //would only make the next frame late too, so drop what is too far behind
+    if (steps > PACER_MAX_STEPS) {
+        pacer->accumulator = 0;
+        return PACER_MAX_STEPS;
+    }
+    pacer->accumulator -= steps*pacer->step_ns;
+    return (int)steps;
+}
+
+void pacerWait(struct FramePacer *pacer) {
+    if (pacer->frame_ns == 0) {
+        return;
+    }
+
+    pacer->deadline += pacer->frame_ns;
+    uint64_t now = timerNow();
+    //Fell behind, start counting again from now instead of rushing out frames to catch up
+    if (pacer->deadline <= now) {
+        pacer->deadline = now;
+        return;
+    }
+
+    while (now < pacer->deadline && pacer->deadline - now > PACER_SPIN_NS) {
+        timerSleep(pacer->deadline - now - PACER_SPIN_NS);
+        now = timerNow();
+    }
+    while (now < pacer->deadline) {
+        now = timerNow();
+    }
+}
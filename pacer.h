@@ -0,0 +1,58 @@
+/**
+ * Frame pacing: caps the frame rate and decides how many fixed length
+ * simulation steps each frame runs, so the animation moves at the same
+ * speed however fast the machine draws.
+ * @file pacer.h
+ * @author ABM
+*/
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdint.h>
+
+/** The last part of the wait before a frame is spun instead of slept, to make up for late wakeups. */
+#define PACER_SPIN_NS 2000000ull
+
+/** Most simulation steps a single frame runs, after a long stall the rest are dropped. */
+#define PACER_MAX_STEPS 8
+
+/**
+ * State of the frame pacing.
+*/
+struct FramePacer {
+    //Time between frames, 0 to draw frames as fast as possible
+    uint64_t frame_ns;
+    //Length of one simulation step
+    uint64_t step_ns;
+    //When the next frame is due
+    uint64_t deadline;
+    //When pacerSteps last ran, and the time since then not yet simulated
+    uint64_t last_time;
+    uint64_t accumulator;
+};
+
+/**
+ * Sets up frame pacing.
+ * Uncapped (target_fps 0) is the benchmark mode: no waiting, and exactly one
+ * step per frame, so a run gives the same frames however long it takes.
+ * @param pacer The pacing state to set up.
+ * @param target_fps Frames per second to draw at, 0 for as fast as possible.
+ * @param steps_per_second Simulation steps per second of real time when capped.
+*/
+void pacerInit(struct FramePacer *pacer, double target_fps, double steps_per_second);
+
+/**
+ * Counts the simulation steps which fell due since the last call.
+ * @param pacer The pacing state.
+ * @return Number of steps to run before drawing the next frame.
+*/
+int pacerSteps(struct FramePacer *pacer);
+
+/**
+ * Waits until the next frame is due, sleeping for most of the wait
+ * and spinning the last PACER_SPIN_NS. Returns at once when uncapped.
+ * @param pacer The pacing state.
+*/
+void pacerWait(struct FramePacer *pacer);
+
+#endif
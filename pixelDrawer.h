@@ -0,0 +1,93 @@
+/**
+ * Drawing primitives and the animation which the backends run once per frame.
+ * @file pixelDrawer.h
+ * @author ABM
+*/
+#ifndef PIXEL_DRAWER_H
+#define PIXEL_DRAWER_H
+
+#include "commandList.h"
+#include "random.h"
+
+/** Number of times per second the animation advances, whatever the frame rate. */
+#define ANIMATION_STEPS_PER_SECOND 60
+
+/**
+ * Everything about the animation which changes from one frame to the next.
+*/
+struct Animation {
+    //Circle radius
+    int circle_radius;
+    //Circle center x coordinate (how far from the left)
+    int circle_center_x;
+    //Circle center y coordinate (how far from the bottom)
+    int circle_center_y;
+    //Triangle side length
+    int side_length;
+    //Triangle top x coordinate (how far from the left)
+    int triangle_top_x;
+    //Triangle top y coordinate (how far from the bottom)
+    int triangle_top_y;
+    //Number of random pixels set each frame
+    int random_pixels;
+    //Picks the random pixels and the triangle positions, reseed it to replay the same frames
+    struct Random random;
+};
+
+/**
+ * Draws a circle centered at circle_center_x, circle_center_y with radius circle_radius,
+ * with its center marked in red and green
+ * @param circle_center_x x coordinate of the center of the circle
+ * @param circle_center_y y coordinate of the center of the circle
+ * @param circle_radius radius of the circle
+*/
+void drawCircle(int circle_center_x, int circle_center_y, int circle_radius);
+
+/**
+ * Same as drawCircle, with the outline anti-aliased.
+ * @param circle_center_x x coordinate of the center of the circle
+ * @param circle_center_y y coordinate of the center of the circle
+ * @param circle_radius radius of the circle
+*/
+void drawCircleAntialiased(int circle_center_x, int circle_center_y, int circle_radius);
+
+/**
+ * Draws a circle the way drawCircle did before the midpoint rasterizer,
+ * with sqrt per column and extra pixels to hide the gaps.
+ * Only kept as the baseline for the circle benchmark, it ignores the clip rectangle.
+ * @param circle_center_x x coordinate of the center of the circle
+ * @param circle_center_y y coordinate of the center of the circle
+ * @param circle_radius radius of the circle
+*/
+void drawCircleSqrt(int circle_center_x, int circle_center_y, int circle_radius);
+
+/**
+ * Draws a solid 45 45 90 triangle with peak at
+ * triangle_top_x, triangle_top_y and with side length side_length,
+ * with the peak marked in red
+ * @param triangle_top_x x coordinate of the center of the triangle
+ * @param triangle_top_y y coordinate of the center of the triangle
+ * @param side_length side length of the triangle
+*/
+void drawTriangle(int triangle_top_x, int triangle_top_y, int side_length);
+
+/**
+ * Sets up the animation for the current size of the frame.
+ * @param animation The animation to set up.
+*/
+void animationInit(struct Animation *animation);
+
+/**
+ * Records the draw calls for one frame of the animation.
+ * @param animation The animation to draw, its generator advances past the random pixels.
+ * @param commands The command list to record into.
+*/
+void animationRecord(struct Animation *animation, struct CommandList *commands);
+
+/**
+ * Advances the animation by one step, 1/ANIMATION_STEPS_PER_SECOND of a second.
+ * @param animation The animation to advance.
+*/
+void animationUpdate(struct Animation *animation);
+
+#endif
@@ -0,0 +1,261 @@
+/**
+ * Writes large numbers of points into the frame, sorted into bins with a counting sort:
+ * count the points in each bin, work out where each bin starts, then copy every point
+ * to the next free place in its bin. The copies go through a cache line per bin,
+ * written out whole, so the scattered writes don't have to read the memory they overwrite.
+ * @file points.c
+ * @author ABM
+*/
+#include "points.h"
+#include "framebuffer.h"
+#include "simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+/** Packed points per cache line. */
+#define POINT_LINE (FRAME_ALIGNMENT/sizeof(uint64_t))
+
+/**
+ * Writes a whole cache line of points, past the cache when the CPU can.
+ * @param destination Where the line goes, aligned to a cache line.
+ * @param line The points, aligned to a cache line.
+*/
+static void writeLine(uint64_t *destination, const uint64_t *line) {
+#ifdef SIMD_X86
+    _mm_stream_si128((__m128i *)destination, _mm_load_si128((const __m128i *)line));
+    _mm_stream_si128((__m128i *)destination + 1, _mm_load_si128((const __m128i *)line + 1));
+    _mm_stream_si128((__m128i *)destination + 2, _mm_load_si128((const __m128i *)line + 2));
+    _mm_stream_si128((__m128i *)destination + 3, _mm_load_si128((const __m128i *)line + 3));
+#else
+    memcpy(destination, line, POINT_LINE*sizeof(uint64_t));
+#endif
+}
+
+void pointsDraw(const uint32_t *indices, const uint32_t *colors, int count) {
+    struct FrameRect clip = frameClip();
+    if (clip.x_min >= clip.x_max || clip.y_min >= clip.y_max) {
+        return;
+    }
+
+    //A clip rectangle as wide as the frame is one contiguous range of indices,
+    //so a single unsigned comparison tells whether a point is inside it.
+    //A tiled frame needs the coordinates of every point anyway.
+    if (clip.x_min == 0 && clip.x_max == frame.width && frame.layout == FRAME_LAYOUT_ROWS) {
+        uint32_t low = (uint32_t)clip.y_min*frame.width;
+        uint32_t size = (uint32_t)(clip.y_max - clip.y_min)*frame.width;
+        if (frame.stride == frame.width) {
+            for (int i = 0; i < count; i++) {
+                if (indices[i] - low < size) {
+                    frame.pixels[indices[i]] = colors[i];
+                }
+            }
+            return;
+        }
+        //Indices don't count the row padding, skip it for every row below the point
+        uint32_t padding = frame.stride - frame.width;
+        for (int i = 0; i < count; i++) {
+            if (indices[i] - low < size) {
+                frame.pixels[indices[i] + indices[i]/frame.width*padding] = colors[i];
+            }
+        }
+        return;
+    }
+
+    uint32_t pixel_count = (uint32_t)frame.width*frame.height;
+    for (int i = 0; i < count; i++) {
+        if (indices[i] >= pixel_count) {
+            continue;
+        }
+        int x = indices[i]%frame.width;
+        int y = indices[i]/frame.width;
+        if (x >= clip.x_min && x < clip.x_max && y >= clip.y_min && y < clip.y_max) {
+            frame.pixels[frameOffset(x, y)] = colors[i];
+        }
+    }
+}
+
+void pointBinsInit(struct PointBins *bins) {
+    bins->source_indices = NULL;
+    bins->source_colors = NULL;
+    bins->count = 0;
+    bins->points = NULL;
+    bins->capacity = 0;
+    bins->starts = NULL;
+    bins->bin_count = 0;
+    bins->chunk_count = 0;
+    bins->next = NULL;
+    bins->first = NULL;
+    bins->lines = NULL;
+    bins->chunk_capacity = 0;
+}
+
+void pointBinsFree(struct PointBins *bins) {
+    frameAlignedFree(bins->points);
+    free(bins->starts);
+    free(bins->next);
+    free(bins->first);
+    frameAlignedFree(bins->lines);
+    pointBinsInit(bins);
+}
+
+void pointBinsBegin(struct PointBins *bins, const uint32_t *indices, const uint32_t *colors,
+                    int count, int chunk_count) {
+    bins->source_indices = indices;
+    bins->source_colors = colors;
+    bins->count = count;
+    bins->bin_count = (int)(((uint64_t)frame.width*frame.height + (1u << POINT_BIN_SHIFT) - 1) >> POINT_BIN_SHIFT);
+    bins->chunk_count = chunk_count > 0 ? chunk_count : 1;
+
+    if (count > bins->capacity) {
+        frameAlignedFree(bins->points);
+        bins->points = frameAlignedAlloc((size_t)count*sizeof(uint64_t));
+        if (!bins->points) {
+            printf("Sorting the points failed.\n");
+            exit(1);
+        }
+        bins->capacity = count;
+    }
+    //One more start than bins, so the last bin has an end too
+    int size = bins->chunk_count*bins->bin_count + 1;
+    if (size > bins->chunk_capacity) {
+        free(bins->starts);
+        free(bins->next);
+        free(bins->first);
+        frameAlignedFree(bins->lines);
+        bins->starts = malloc(size*sizeof(int));
+        bins->next = malloc(size*sizeof(int));
+        bins->first = malloc(size*sizeof(int));
+        bins->lines = frameAlignedAlloc((size_t)size*POINT_LINE*sizeof(uint64_t));
+        if (!bins->starts || !bins->next || !bins->first || !bins->lines) {
+            printf("Sorting the points failed.\n");
+            exit(1);
+        }
+        bins->chunk_capacity = size;
+    }
+}
+
+void pointBinsCount(struct PointBins *bins, int chunk) {
+    int *counts = bins->next + (ptrdiff_t)chunk*bins->bin_count;
+    for (int bin = 0; bin < bins->bin_count; bin++) {
+        counts[bin] = 0;
+    }
+
+    uint32_t pixel_count = (uint32_t)frame.width*frame.height;
+    const uint32_t *indices = bins->source_indices;
+    int end = (int)((int64_t)bins->count*(chunk + 1)/bins->chunk_count);
+    for (int i = (int)((int64_t)bins->count*chunk/bins->chunk_count); i < end; i++) {
+        //Points outside the frame are dropped here, so drawing never sees them
+        if (indices[i] < pixel_count) {
+            counts[indices[i] >> POINT_BIN_SHIFT]++;
+        }
+    }
+}
+
+void pointBinsOffsets(struct PointBins *bins) {
+    //Bins in order, and within each bin the chunks in order,
+    //so the points of a bin keep the order they were submitted in
+    int start = 0;
+    for (int bin = 0; bin < bins->bin_count; bin++) {
+        bins->starts[bin] = start;
+        for (int chunk = 0; chunk < bins->chunk_count; chunk++) {
+            int slot = chunk*bins->bin_count + bin;
+            int points = bins->next[slot];
+            bins->next[slot] = start;
+            bins->first[slot] = start;
+            start += points;
+        }
+    }
+    bins->starts[bins->bin_count] = start;
+}
+
+void pointBinsScatter(struct PointBins *bins, int chunk) {
+    ptrdiff_t slot = (ptrdiff_t)chunk*bins->bin_count;
+    int *next = bins->next + slot;
+    const int *first = bins->first + slot;
+    uint64_t *lines = bins->lines + slot*POINT_LINE;
+    uint64_t *points = bins->points;
+    uint32_t pixel_count = (uint32_t)frame.width*frame.height;
+    const uint32_t *indices = bins->source_indices;
+    const uint32_t *colors = bins->source_colors;
+
+    int end = (int)((int64_t)bins->count*(chunk + 1)/bins->chunk_count);
+    for (int i = (int)((int64_t)bins->count*chunk/bins->chunk_count); i < end; i++) {
+        uint32_t index = indices[i];
+        if (index >= pixel_count) {
+            continue;
+        }
+        uint32_t bin = index >> POINT_BIN_SHIFT;
+        int place = next[bin]++;
+        uint64_t *line = lines + bin*POINT_LINE;
+        line[place%POINT_LINE] = (uint64_t)colors[i] << 32 | index;
+        if (place%POINT_LINE != POINT_LINE - 1) {
+            continue;
+        }
+        //The line is full. If it starts before this chunk's part of the bin,
+        //the start of it belongs to another chunk or bin, so only this chunk's points are written.
+        int line_start = place - (int)(POINT_LINE - 1);
+        if (line_start >= first[bin]) {
+            writeLine(points + line_start, line);
+        } else {
+            for (int j = first[bin]; j <= place; j++) {
+                points[j] = line[j%POINT_LINE];
+            }
+        }
+    }
+
+    //Write out the lines which never filled up
+    for (int bin = 0; bin < bins->bin_count; bin++) {
+        int start = next[bin] - next[bin]%POINT_LINE;
+        start = start > first[bin] ? start : first[bin];
+        for (int j = start; j < next[bin]; j++) {
+            points[j] = lines[bin*POINT_LINE + j%POINT_LINE];
+        }
+    }
+#ifdef SIMD_X86
+    //The streaming stores have to land before another thread reads the points
+    _mm_sfence();
+#endif
+}
+
+void pointBinsSort(struct PointBins *bins, const uint32_t *indices, const uint32_t *colors, int count) {
+    pointBinsBegin(bins, indices, colors, count, 1);
+    pointBinsCount(bins, 0);
+    pointBinsOffsets(bins);
+    pointBinsScatter(bins, 0);
+}
+
+void pointBinsDraw(const struct PointBins *bins) {
+    struct FrameRect clip = frameClip();
+    if (clip.x_min >= clip.x_max || clip.y_min >= clip.y_max || bins->bin_count == 0) {
+        return;
+    }
+
+    //Only the bins holding the rows of the clip rectangle, the ones at
+    //either end can also hold points from outside it, which are skipped
+    uint32_t low = (uint32_t)clip.y_min*frame.width;
+    uint32_t size = (uint32_t)(clip.y_max - clip.y_min)*frame.width;
+    const uint64_t *point = bins->points + bins->starts[low >> POINT_BIN_SHIFT];
+    const uint64_t *end = bins->points + bins->starts[((low + size - 1) >> POINT_BIN_SHIFT) + 1];
+
+    if (clip.x_min == 0 && clip.x_max == frame.width && frame.layout == FRAME_LAYOUT_ROWS) {
+        uint32_t padding = frame.stride - frame.width;
+        for (; point < end; point++) {
+            uint32_t index = (uint32_t)*point;
+            if (index - low < size) {
+                frame.pixels[index + (padding ? index/frame.width*padding : 0)] = (uint32_t)(*point >> 32);
+            }
+        }
+        return;
+    }
+
+    for (; point < end; point++) {
+        uint32_t index = (uint32_t)*point;
+        int x = index%frame.width;
+        int y = index/frame.width;
+        if (x >= clip.x_min && x < clip.x_max && y >= clip.y_min && y < clip.y_max) {
+            frame.pixels[frameOffset(x, y)] = (uint32_t)(*point >> 32);
+        }
+    }
+}
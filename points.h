@@ -0,0 +1,115 @@
+/**
+ * Writes large numbers of points into the frame. Big batches are sorted into bins
+ * of neighbouring pixels first, so the writes of each bin land in a small part of the
+ * frame which stays in the cache, instead of nearly every write missing the cache and the TLB.
+ * The sort is stable, so a pixel set by several points still ends up
+ * with the color of the last one submitted, exactly as if they were written in order.
+ * @file points.h
+ * @author ABM
+*/
+#ifndef POINTS_H
+#define POINTS_H
+
+#include <stdint.h>
+
+/** Bins are 1 << POINT_BIN_SHIFT pixels, 128 KiB of the frame or about 8 rows at 4K. */
+#define POINT_BIN_SHIFT 15
+
+/** Points commands with at least this many points are sorted into bins when rendered on several threads. */
+#define POINT_SORT_THRESHOLD 65536
+
+/**
+ * Points sorted into bins by their pixel index. The sort can be split into chunks
+ * of the points, which can be counted and scattered on different threads, see pointBinsBegin.
+*/
+struct PointBins {
+    //Points being sorted, indices are x + y*frame.width (not frame.stride)
+    const uint32_t *source_indices;
+    const uint32_t *source_colors;
+    int count;
+    //The points sorted by bin, in submission order within a bin, each packed as color << 32 | index
+    uint64_t *points;
+    int capacity;
+    //Bin b holds the sorted points starts[b] to starts[b + 1] - 1
+    int *starts;
+    int bin_count;
+    int chunk_count;
+    //For chunk c and bin b, [c*bin_count + b] of: the number of points the chunk has in the bin,
+    //then where the next one goes once pointBinsOffsets has run, and where the first one went
+    int *next;
+    int *first;
+    //A cache line of points per chunk and bin, collected before being written out whole
+    uint64_t *lines;
+    int chunk_capacity;
+};
+
+/**
+ * Sets the pixels of points which are inside the clip rectangle, in order.
+ * @param indices Index of each pixel, x + y*frame.width. Points outside the frame are skipped.
+ * @param colors Color of each point.
+ * @param count Number of points.
+*/
+void pointsDraw(const uint32_t *indices, const uint32_t *colors, int count);
+
+/**
+ * Sets up empty point bins.
+ * @param bins The bins to set up.
+*/
+void pointBinsInit(struct PointBins *bins);
+
+/**
+ * Releases the memory of point bins.
+ * @param bins The bins to release.
+*/
+void pointBinsFree(struct PointBins *bins);
+
+/**
+ * Starts sorting points into bins for the current frame. Each chunk then has to be
+ * counted with pointBinsCount, then pointBinsOffsets run once, then each chunk
+ * scattered with pointBinsScatter. Different chunks can be counted or scattered at the same time.
+ * @param bins The bins to sort into, their memory is kept from the last sort.
+ * @param indices Index of each pixel, x + y*frame.width. Must stay unchanged until the sort is done.
+ * @param colors Color of each point. Must stay unchanged until the sort is done.
+ * @param count Number of points.
+ * @param chunk_count Number of chunks to split the points into.
+*/
+void pointBinsBegin(struct PointBins *bins, const uint32_t *indices, const uint32_t *colors,
+                    int count, int chunk_count);
+
+/**
+ * Counts the points of one chunk in each bin.
+ * @param bins The bins being sorted into.
+ * @param chunk The chunk, 0 to chunk_count - 1.
+*/
+void pointBinsCount(struct PointBins *bins, int chunk);
+
+/**
+ * Works out where every bin, and every chunk within it, starts once every chunk is counted.
+ * @param bins The bins being sorted into.
+*/
+void pointBinsOffsets(struct PointBins *bins);
+
+/**
+ * Copies the points of one chunk into their bins.
+ * @param bins The bins being sorted into.
+ * @param chunk The chunk, 0 to chunk_count - 1.
+*/
+void pointBinsScatter(struct PointBins *bins, int chunk);
+
+/**
+ * Sorts points into bins on the calling thread.
+ * @param bins The bins to sort into.
+ * @param indices Index of each pixel, x + y*frame.width.
+ * @param colors Color of each point.
+ * @param count Number of points.
+*/
+void pointBinsSort(struct PointBins *bins, const uint32_t *indices, const uint32_t *colors, int count);
+
+/**
+ * Sets the pixels of the sorted points which are inside the clip rectangle,
+ * only reading the bins which overlap its rows.
+ * @param bins The sorted points.
+*/
+void pointBinsDraw(const struct PointBins *bins);
+
+#endif
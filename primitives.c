@@ -0,0 +1,410 @@
+/**
+ * Clipped spans and line segments which every shape is built from.
+ * @file primitives.c
+ * @author ABM
+*/
+#include "primitives.h"
+#include "framebuffer.h"
+#include "fill.h"
+#include "blend.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Spans at least this long are handed to the vectorized fill kernel, shorter ones are filled in place. */
+#define SPAN_KERNEL_THRESHOLD 16
+
+/** Number of steps of an anti-aliased line whose pixels are blended together. */
+#define LINE_CHUNK 128
+
+/**
+ * Divides and rounds towards negative infinity.
+ * @param a dividend
+ * @param b divisor, must be positive
+ * @return floor(a/b)
+*/
+static int64_t floorDiv(int64_t a, int64_t b) {
+    return a >= 0 ? a/b : -((-a + b - 1)/b);
+}
+
+/**
+ * Divides and rounds towards positive infinity.
+ * @param a dividend
+ * @param b divisor, must be positive
+ * @return ceil(a/b)
+*/
+static int64_t ceilDiv(int64_t a, int64_t b) {
+    return -floorDiv(-a, b);
+}
+
+/**
+ * How far a pixel of a tiled frame is from its neighbour to the left or right.
+ * @param x Column of the pixel.
+ * @param sign 1 for the neighbour to the right, -1 for the one to the left.
+ * @return Index of the neighbour minus index of the pixel.
+*/
+static ptrdiff_t tileStepX(int x, int sign) {
+    //Past the edge of a tile is the same row of the next tile
+    ptrdiff_t next_tile = FRAME_TILE_SIZE*FRAME_TILE_SIZE - (FRAME_TILE_SIZE - 1);
+    if (sign > 0) {
+        return (x & (FRAME_TILE_SIZE - 1)) == FRAME_TILE_SIZE - 1 ? next_tile : 1;
+    }
+    return (x & (FRAME_TILE_SIZE - 1)) == 0 ? -next_tile : -1;
+}
+
+/**
+ * How far a pixel of a tiled frame is from its neighbour above or below.
+ * @param y Row of the pixel.
+ * @param sign 1 for the neighbour above, -1 for the one below.
+ * @param row_of_tiles Pixels in a row of tiles, frame.stride*FRAME_TILE_SIZE.
+ * @return Index of the neighbour minus index of the pixel.
+*/
+static ptrdiff_t tileStepY(int y, int sign, ptrdiff_t row_of_tiles) {
+    //Past the edge of a tile is the same column of the tile above or below
+    ptrdiff_t next_tile = row_of_tiles - (FRAME_TILE_SIZE - 1)*FRAME_TILE_SIZE;
+    if (sign > 0) {
+        return (y & (FRAME_TILE_SIZE - 1)) == FRAME_TILE_SIZE - 1 ? next_tile : FRAME_TILE_SIZE;
+    }
+    return (y & (FRAME_TILE_SIZE - 1)) == 0 ? -next_tile : -FRAME_TILE_SIZE;
+}
+
+void drawHorizontalSpan(int y, int x_start, int x_end, uint32_t color) {
+    if (x_start > x_end) {
+        int swap = x_start;
+        x_start = x_end;
+        x_end = swap;
+    }
+
+    //One intersection with the clip rectangle for the whole span
+    struct FrameRect clip = frameClip();
+    if (y < clip.y_min || y >= clip.y_max || x_end < clip.x_min || x_start >= clip.x_max) {
+        return;
+    }
+    if (x_start < clip.x_min) {
+        x_start = clip.x_min;
+    }
+    if (x_end >= clip.x_max) {
+        x_end = clip.x_max - 1;
+    }
+
+    //A row of a tiled frame is a short run of pixels in each tile it crosses
+    if (frame.layout == FRAME_LAYOUT_TILES) {
+        int stride = frame.stride;
+        for (int x = x_start; x <= x_end; ) {
+            uint32_t *pixel = frame.pixels + frameTileOffset(x, y, stride);
+            int run_end = (x | (FRAME_TILE_SIZE - 1)) < x_end ? (x | (FRAME_TILE_SIZE - 1)) : x_end;
+            for (; x <= run_end; x++) {
+                *pixel++ = color;
+            }
+        }
+        return;
+    }
+
+    uint32_t *pixel = frame.pixels + x_start + (ptrdiff_t)y*frame.stride;
+    int count = x_end - x_start + 1;
+    if (count >= SPAN_KERNEL_THRESHOLD) {
+        fillPixels(pixel, count, color);
+        return;
+    }
+    uint32_t *end = pixel + count;
+    while (pixel < end) {
+        *pixel++ = color;
+    }
+}
+
+void drawVerticalSpan(int x, int y_start, int y_end, uint32_t color) {
+    if (y_start > y_end) {
+        int swap = y_start;
+        y_start = y_end;
+        y_end = swap;
+    }
+
+    //One intersection with the clip rectangle for the whole span
+    struct FrameRect clip = frameClip();
+    if (x < clip.x_min || x >= clip.x_max || y_end < clip.y_min || y_start >= clip.y_max) {
+        return;
+    }
+    if (y_start < clip.y_min) {
+        y_start = clip.y_min;
+    }
+    if (y_end >= clip.y_max) {
+        y_end = clip.y_max - 1;
+    }
+
+    //A column of a tiled frame steps a tile row at a time inside a tile,
+    //and on to the tile above after its top row
+    if (frame.layout == FRAME_LAYOUT_TILES) {
+        ptrdiff_t offset = frameTileOffset(x, y_start, frame.stride);
+        ptrdiff_t next_tile = (ptrdiff_t)frame.stride*FRAME_TILE_SIZE - (FRAME_TILE_SIZE - 1)*FRAME_TILE_SIZE;
+        for (int y = y_start; y <= y_end; y++) {
+            frame.pixels[offset] = color;
+            offset += (y & (FRAME_TILE_SIZE - 1)) == FRAME_TILE_SIZE - 1 ? next_tile : FRAME_TILE_SIZE;
+        }
+        return;
+    }
+
+    uint32_t *pixel = frame.pixels + x + (ptrdiff_t)y_start*frame.stride;
+    for (int count = y_end - y_start + 1; count > 0; count--) {
+        *pixel = color;
+        pixel += frame.stride;
+    }
+}
+
+void drawLine(int x0, int y0, int x1, int y1, uint32_t color) {
+    struct FrameRect clip = frameClip();
+    if (clip.x_min >= clip.x_max || clip.y_min >= clip.y_max) {
+        return;
+    }
+
+    int64_t dx = x1 >= x0 ? (int64_t)x1 - x0 : (int64_t)x0 - x1;
+    int64_t dy = y1 >= y0 ? (int64_t)y1 - y0 : (int64_t)y0 - y1;
+    int sign_x = x1 >= x0 ? 1 : -1;
+    int sign_y = y1 >= y0 ? 1 : -1;
+
+    //Work along the major axis, the one the line is longer in.
+    //Step t (0 to major_length) is at major0 + major_sign*t on the major axis and
+    //minor0 + minor_sign*q(t) on the minor axis, where q(t) is t*minor_length/major_length
+    //rounded to nearest: q(t) = floor((2*t*minor_length + major_length)/(2*major_length))
+    bool steep = dy > dx;
+    int64_t major_length = steep ? dy : dx;
+    int64_t minor_length = steep ? dx : dy;
+    int64_t major0 = steep ? y0 : x0;
+    int64_t minor0 = steep ? x0 : y0;
+    int major_sign = steep ? sign_y : sign_x;
+    int minor_sign = steep ? sign_x : sign_y;
+    int64_t major_min = steep ? clip.y_min : clip.x_min;
+    int64_t major_max = (steep ? clip.y_max : clip.x_max) - 1;
+    int64_t minor_min = steep ? clip.x_min : clip.y_min;
+    int64_t minor_max = (steep ? clip.x_max : clip.y_max) - 1;
+
+    //Steps which are inside the clip rectangle on the major axis
+    int64_t t_first = major_sign > 0 ? major_min - major0 : major0 - major_max;
+    int64_t t_last = major_sign > 0 ? major_max - major0 : major0 - major_min;
+
+    //Values of q(t) which are inside the clip rectangle on the minor axis
+    int64_t q_first = minor_sign > 0 ? minor_min - minor0 : minor0 - minor_max;
+    int64_t q_last = minor_sign > 0 ? minor_max - minor0 : minor0 - minor_min;
+
+    //q(t) never decreases, so the steps with q(t) in range are a single range too
+    if (minor_length == 0) {
+        if (q_first > 0 || q_last < 0) {
+            return;
+        }
+    } else {
+        int64_t t_min = ceilDiv(2*major_length*q_first - major_length, 2*minor_length);
+        int64_t t_max = floorDiv(2*major_length*(q_last + 1) - major_length - 1, 2*minor_length);
+        if (t_min > t_first) {
+            t_first = t_min;
+        }
+        if (t_max < t_last) {
+            t_last = t_max;
+        }
+    }
+
+    if (t_first < 0) {
+        t_first = 0;
+    }
+    if (t_last > major_length) {
+        t_last = major_length;
+    }
+    if (t_first > t_last) {
+        return;
+    }
+
+    //Start Bresenham at the first visible step, with the error term it would have had there
+    int64_t two_major = 2*major_length;
+    int64_t numerator = 2*t_first*minor_length + major_length;
+    int64_t q = two_major > 0 ? numerator/two_major : 0;
+    int64_t error = two_major > 0 ? numerator%two_major : 0;
+
+    int64_t major = major0 + major_sign*t_first;
+    int64_t minor = minor0 + minor_sign*q;
+
+    //A step in a tiled frame moves further when it crosses into the next tile
+    if (frame.layout == FRAME_LAYOUT_TILES) {
+        int x = (int)(steep ? minor : major);
+        int y = (int)(steep ? major : minor);
+        ptrdiff_t offset = frameTileOffset(x, y, frame.stride);
+        ptrdiff_t row_of_tiles = (ptrdiff_t)frame.stride*FRAME_TILE_SIZE;
+        for (int64_t count = t_last - t_first + 1; ; ) {
+            frame.pixels[offset] = color;
+            if (--count == 0) {
+                break;
+            }
+            bool minor_step = false;
+            error += 2*minor_length;
+            if (error >= two_major) {
+                error -= two_major;
+                minor_step = true;
+            }
+            if (!steep || minor_step) {
+                offset += tileStepX(x, sign_x);
+                x += sign_x;
+            }
+            if (steep || minor_step) {
+                offset += tileStepY(y, sign_y, row_of_tiles);
+                y += sign_y;
+            }
+        }
+        return;
+    }
+
+    uint32_t *pixel = frame.pixels + (steep ? minor + major*frame.stride : major + minor*frame.stride);
+    ptrdiff_t major_stride = steep ? (ptrdiff_t)sign_y*frame.stride : sign_x;
+    ptrdiff_t minor_stride = steep ? sign_x : (ptrdiff_t)sign_y*frame.stride;
+
+    for (int64_t count = t_last - t_first + 1; ; ) {
+        *pixel = color;
+        if (--count == 0) {
+            break;
+        }
+        pixel += major_stride;
+        error += 2*minor_length;
+        if (error >= two_major) {
+            error -= two_major;
+            pixel += minor_stride;
+        }
+    }
+}
+
+void blendHorizontalSpan(int y, int x_start, const uint8_t *coverage, int count, uint32_t color) {
+    //One intersection with the clip rectangle for the whole span
+    struct FrameRect clip = frameClip();
+    int x_end = x_start + count;
+    if (y < clip.y_min || y >= clip.y_max || x_end <= clip.x_min || x_start >= clip.x_max) {
+        return;
+    }
+    if (x_start < clip.x_min) {
+        coverage += clip.x_min - x_start;
+        x_start = clip.x_min;
+    }
+    if (x_end > clip.x_max) {
+        x_end = clip.x_max;
+    }
+
+    if (frame.layout == FRAME_LAYOUT_TILES) {
+        for (int x = x_start; x < x_end; ) {
+            int run_end = (x | (FRAME_TILE_SIZE - 1)) + 1 < x_end ? (x | (FRAME_TILE_SIZE - 1)) + 1 : x_end;
+            blendSpan(frame.pixels + frameTileOffset(x, y, frame.stride), coverage + (x - x_start), run_end - x, color);
+            x = run_end;
+        }
+        return;
+    }
+    blendSpan(frame.pixels + x_start + (ptrdiff_t)y*frame.stride, coverage, x_end - x_start, color);
+}
+
+void drawLineAntialiased(int x0, int y0, int x1, int y1, uint32_t color) {
+    struct FrameRect clip = frameClip();
+    if (clip.x_min >= clip.x_max || clip.y_min >= clip.y_max) {
+        return;
+    }
+
+    int64_t dx = x1 >= x0 ? (int64_t)x1 - x0 : (int64_t)x0 - x1;
+    int64_t dy = y1 >= y0 ? (int64_t)y1 - y0 : (int64_t)y0 - y1;
+    bool steep = dy > dx;
+
+    //Always walk the major axis upwards, the line covers the same pixels whichever end it starts from
+    if (steep ? y1 < y0 : x1 < x0) {
+        int swap = x0;
+        x0 = x1;
+        x1 = swap;
+        swap = y0;
+        y0 = y1;
+        y1 = swap;
+    }
+    int64_t major_length = steep ? dy : dx;
+    int64_t minor_length = steep ? dx : dy;
+    int64_t major0 = steep ? y0 : x0;
+    int64_t minor0 = steep ? x0 : y0;
+    int minor_sign = (steep ? x1 >= x0 : y1 >= y0) ? 1 : -1;
+
+    //Steps which are inside the clip rectangle on the major axis
+    int64_t major_min = steep ? clip.y_min : clip.x_min;
+    int64_t major_max = (steep ? clip.y_max : clip.x_max) - 1;
+    int64_t t_first = major_min - major0 > 0 ? major_min - major0 : 0;
+    int64_t t_last = major_max - major0 < major_length ? major_max - major0 : major_length;
+    if (t_first > t_last) {
+        return;
+    }
+
+    //Step t is exactly t*minor_length/major_length pixels along the minor axis:
+    //q whole pixels and error/major_length of the next one
+    int64_t q = major_length > 0 ? t_first*minor_length/major_length : 0;
+    int64_t error = major_length > 0 ? t_first*minor_length%major_length : 0;
+    //Turns error into the coverage of the far pixel with a multiplication instead of a division
+    uint64_t to_coverage = major_length > 0 ? (255ull << 32)/(uint64_t)major_length : 0;
+    uint32_t source = color | 0xFF000000;
+
+    //The line can leave the clip rectangle on the minor axis,
+    //so each of the two pixels is checked with a single unsigned comparison
+    int64_t minor_min = steep ? clip.x_min : clip.y_min;
+    uint64_t minor_range = (uint64_t)((steep ? clip.x_max : clip.y_max) - 1 - minor_min);
+    int64_t minor = minor0 + minor_sign*q;
+    int64_t major = major0 + t_first;
+
+    //Both pixels of each step are collected and blended together every LINE_CHUNK steps.
+    //The near pixels of a line are all different, as are the far ones, and the near and
+    //far pixels of different steps are in different columns (or rows), so none is blended twice.
+    //In a frame of rows, pixels outside the clip rectangle are written into the arrays but not counted.
+    ptrdiff_t offsets[2*LINE_CHUNK];
+    uint8_t coverage[2*LINE_CHUNK];
+    int64_t remaining = t_last - t_first + 1;
+
+    //Same walk through a tiled frame, finding both pixels from their coordinates
+    if (frame.layout == FRAME_LAYOUT_TILES) {
+        int stride = frame.stride;
+        while (remaining > 0) {
+            int steps = remaining < LINE_CHUNK ? (int)remaining : LINE_CHUNK;
+            size_t count = 0;
+            for (int step = 0; step < steps; step++) {
+                uint32_t far = (uint32_t)(((uint64_t)error*to_coverage) >> 32);
+                int64_t far_minor = minor + minor_sign;
+                if ((uint64_t)(minor - minor_min) <= minor_range) {
+                    offsets[count] = steep ? frameTileOffset((int)minor, (int)major, stride)
+                                           : frameTileOffset((int)major, (int)minor, stride);
+                    coverage[count++] = (uint8_t)(255 - far);
+                }
+                if (far != 0 && (uint64_t)(far_minor - minor_min) <= minor_range) {
+                    offsets[count] = steep ? frameTileOffset((int)far_minor, (int)major, stride)
+                                           : frameTileOffset((int)major, (int)far_minor, stride);
+                    coverage[count++] = (uint8_t)far;
+                }
+                major++;
+                error += minor_length;
+                if (major_length > 0 && error >= major_length) {
+                    error -= major_length;
+                    minor += minor_sign;
+                }
+            }
+            blendPixels(frame.pixels, offsets, coverage, count, source);
+            remaining -= steps;
+        }
+        return;
+    }
+
+    ptrdiff_t offset = steep ? minor + major*frame.stride : major + minor*frame.stride;
+    ptrdiff_t major_stride = steep ? frame.stride : 1;
+    ptrdiff_t minor_stride = steep ? minor_sign : (ptrdiff_t)minor_sign*frame.stride;
+
+    while (remaining > 0) {
+        int steps = remaining < LINE_CHUNK ? (int)remaining : LINE_CHUNK;
+        size_t count = 0;
+        for (int step = 0; step < steps; step++) {
+            uint32_t far = (uint32_t)(((uint64_t)error*to_coverage) >> 32);
+            offsets[count] = offset;
+            coverage[count] = (uint8_t)(255 - far);
+            count += (uint64_t)(minor - minor_min) <= minor_range;
+            offsets[count] = offset + minor_stride;
+            coverage[count] = (uint8_t)far;
+            count += far != 0 && (uint64_t)(minor + minor_sign - minor_min) <= minor_range;
+            offset += major_stride;
+            error += minor_length;
+            if (major_length > 0 && error >= major_length) {
+                error -= major_length;
+                offset += minor_stride;
+                minor += minor_sign;
+            }
+        }
+        blendPixels(frame.pixels, offsets, coverage, count, source);
+        remaining -= steps;
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * Clipped spans and line segments which every shape is built from.
+ * Each primitive is intersected with the clip rectangle of the frame
+ * (see frameSetClip) once, then written
+ * through a pointer with a fixed stride, without any per-pixel checks.
+ * In a tiled frame spans are written a tile at a time and lines a pixel at a time.
+ * @file primitives.h
+ * @author ABM
+*/
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include <stdint.h>
+
+/**
+ * Fills the pixels x_start to x_end (inclusive) of row y.
+ * @param y row of the span
+ * @param x_start x coordinate of one end of the span
+ * @param x_end x coordinate of the other end of the span
+ * @param color color of the span
+*/
+void drawHorizontalSpan(int y, int x_start, int x_end, uint32_t color);
+
+/**
+ * Fills the pixels y_start to y_end (inclusive) of column x.
+ * @param x column of the span
+ * @param y_start y coordinate of one end of the span
+ * @param y_end y coordinate of the other end of the span
+ * @param color color of the span
+*/
+void drawVerticalSpan(int x, int y_start, int y_end, uint32_t color);
+
+/**
+ * Draws a Bresenham line from x0, y0 to x1, y1, both ends included.
+ * The pixels drawn are the same as for the unclipped line,
+ * minus the ones outside of the clip rectangle.
+ * @param x0 x coordinate of the start of the line
+ * @param y0 y coordinate of the start of the line
+ * @param x1 x coordinate of the end of the line
+ * @param y1 y coordinate of the end of the line
+ * @param color color of the line
+*/
+void drawLine(int x0, int y0, int x1, int y1, uint32_t color);
+
+/**
+ * Blends a color over count pixels of row y, starting at x_start and going right.
+ * @param y row of the span
+ * @param x_start x coordinate of the leftmost pixel
+ * @param coverage coverage of each pixel, 0 to 255
+ * @param count number of pixels
+ * @param color premultiplied color, see blend.h
+*/
+void blendHorizontalSpan(int y, int x_start, const uint8_t *coverage, int count, uint32_t color);
+
+/**
+ * Draws an anti-aliased line from x0, y0 to x1, y1 (Xiaolin Wu's algorithm):
+ * at each step along the longer axis the exact position of the line is shared
+ * between the two nearest pixels, in proportion to how close it is to each.
+ * The ends fall on pixel centers, so they are drawn solid.
+ * @param x0 x coordinate of the start of the line
+ * @param y0 y coordinate of the start of the line
+ * @param x1 x coordinate of the end of the line
+ * @param y1 y coordinate of the end of the line
+ * @param color color of the line, 0xRRGGBB, drawn opaque
+*/
+void drawLineAntialiased(int x0, int y0, int x1, int y1, uint32_t color);
+
+#endif
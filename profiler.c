@@ -0,0 +1,302 @@
+/**
+ * Frame time profiler with a fixed size ring buffer of the last frames,
+ * so timing a stage is two clock reads and never allocates.
+ * @file profiler.c
+ * @author ABM
+*/
+#include "profiler.h"
+#include "framebuffer.h"
+#include "fill.h"
+#include "primitives.h"
+#include "dirty.h"
+#include "text.h"
+#include "timer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Timings of one frame, all in timerNow nanoseconds.
+*/
+struct ProfileFrame {
+    uint64_t start;
+    uint64_t end;
+    //When each stage first began this frame, and when it last began
+    uint64_t stage_first[PROFILE_STAGE_COUNT];
+    uint64_t stage_start[PROFILE_STAGE_COUNT];
+    //Total time spent in each stage this frame
+    uint64_t stage_ns[PROFILE_STAGE_COUNT];
+};
+
+//The last PROFILE_HISTORY frames, the current one at frame_count%PROFILE_HISTORY
+static struct ProfileFrame history[PROFILE_HISTORY];
+//Number of frames finished so far
+static uint64_t frame_count = 0;
+
+//Scratch space for sorting frame times, kept out of the stack
+static uint64_t sorted_ns[PROFILE_HISTORY];
+
+//Stage names and overlay colors, by enum ProfileStage
+static const struct {
+    const char *name;
+    uint32_t color;
+} stages[PROFILE_STAGE_COUNT] = {
+    [PROFILE_MESSAGES] = {"messages", 0x00808080},
+    [PROFILE_RECORD] = {"record", 0x0000C0FF},
+    [PROFILE_RASTERIZE] = {"rasterize", 0x0000FF00},
+    [PROFILE_OVERLAY] = {"overlay", 0x00FF00FF},
+    [PROFILE_UPDATE] = {"update", 0x00FFFF00},
+    [PROFILE_PRESENT] = {"present", 0x00FF4040},
+    [PROFILE_WAIT] = {"wait", 0x00203040},
+};
+
+/** Color of the part of a frame no stage accounts for. */
+#define OTHER_COLOR 0x00404040
+
+/** Background color of the overlay graph. */
+#define BACKGROUND_COLOR 0x00101010
+
+/** Color of the target frame time line of the overlay graph. */
+#define TARGET_COLOR 0x00FFFFFF
+
+/** Color of the overlay text, drawn on BACKGROUND_COLOR. */
+#define TEXT_COLOR 0x00E0E0E0
+
+/** Pixels between lines of overlay text, and between the text and the graph. */
+#define TEXT_SPACING 2
+
+//Lines of text of the overlay as they were last drawn, the frame rate line first
+static struct TextRun text_runs[PROFILE_OVERLAY_LINES];
+//The frame rate line, only updated every PROFILE_OVERLAY_TEXT_FRAMES frames
+static char rate_line[96];
+
+/**
+ * Gets the frame currently being timed.
+ * @return The frame.
+*/
+static struct ProfileFrame *currentFrame(void) {
+    return &history[frame_count%PROFILE_HISTORY];
+}
+
+/**
+ * Gets a finished frame from the history.
+ * @param age 0 for the oldest frame still in the history, counting up to the newest.
+ * @return The frame.
+*/
+static const struct ProfileFrame *historyFrame(int age) {
+    uint64_t frames = frame_count < PROFILE_HISTORY ? frame_count : PROFILE_HISTORY;
+    return &history[(frame_count - frames + age)%PROFILE_HISTORY];
+}
+
+/**
+ * Gets the number of finished frames in the history.
+ * @return The number of frames.
+*/
+static int historyCount(void) {
+    return frame_count < PROFILE_HISTORY ? (int)frame_count : PROFILE_HISTORY;
+}
+
+/**
+ * Compares two frame times for qsort.
+ * @param a The first time.
+ * @param b The second time.
+ * @return Negative, zero or positive as a is less than, equal to or greater than b.
+*/
+static int compareTimes(const void *a, const void *b) {
+    uint64_t time_a = *(const uint64_t *)a;
+    uint64_t time_b = *(const uint64_t *)b;
+    return (time_a > time_b) - (time_a < time_b);
+}
+
+void profileFrameBegin(void) {
+    struct ProfileFrame *current = currentFrame();
+    memset(current, 0, sizeof(*current));
+    current->start = timerNow();
+}
+
+void profileFrameEnd(void) {
+    currentFrame()->end = timerNow();
+    frame_count++;
+}
+
+void profileStageBegin(enum ProfileStage stage) {
+    struct ProfileFrame *current = currentFrame();
+    current->stage_start[stage] = timerNow();
+    if (current->stage_first[stage] == 0) {
+        current->stage_first[stage] = current->stage_start[stage];
+    }
+}
+
+void profileStageEnd(enum ProfileStage stage) {
+    struct ProfileFrame *current = currentFrame();
+    current->stage_ns[stage] += timerNow() - current->stage_start[stage];
+}
+
+void profileReset(void) {
+    frame_count = 0;
+}
+
+const char *profileStageName(enum ProfileStage stage) {
+    return stage < PROFILE_STAGE_COUNT ? stages[stage].name : "unknown";
+}
+
+void profileStats(struct ProfileStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    int frames = historyCount();
+    if (frames == 0) {
+        return;
+    }
+
+    for (int i = 0; i < frames; i++) {
+        const struct ProfileFrame *past = historyFrame(i);
+        sorted_ns[i] = past->end - past->start;
+        for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+            stats->stage_ms[stage] += past->stage_ns[stage]*1e-6/frames;
+        }
+    }
+    qsort(sorted_ns, frames, sizeof(uint64_t), compareTimes);
+
+    //Nearest rank percentiles
+    stats->frames = frames;
+    stats->frame_ms_p50 = sorted_ns[(int)ceil(0.50*frames) - 1]*1e-6;
+    stats->frame_ms_p99 = sorted_ns[(int)ceil(0.99*frames) - 1]*1e-6;
+    double seconds = timerSeconds(historyFrame(0)->start, historyFrame(frames - 1)->end);
+    stats->fps = seconds > 0 ? frames/seconds : 0;
+}
+
+bool profileExportCsv(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "frame,start_ms,frame_ms");
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        fprintf(file, ",%s_ms", stages[stage].name);
+    }
+    fprintf(file, "\n");
+
+    int frames = historyCount();
+    for (int i = 0; i < frames; i++) {
+        const struct ProfileFrame *past = historyFrame(i);
+        fprintf(file, "%llu,%.6f,%.6f", (unsigned long long)(frame_count - frames + i),
+                (past->start - historyFrame(0)->start)*1e-6, (past->end - past->start)*1e-6);
+        for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+            fprintf(file, ",%.6f", past->stage_ns[stage]*1e-6);
+        }
+        fprintf(file, "\n");
+    }
+
+    return fclose(file) == 0;
+}
+
+bool profileExportTrace(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    //Complete ("X") events with microsecond timestamps. A stage which ran
+    //more than once in a frame shows up once, from its first start.
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int frames = historyCount();
+    bool first_event = true;
+    for (int i = 0; i < frames; i++) {
+        const struct ProfileFrame *past = historyFrame(i);
+        uint64_t origin = historyFrame(0)->start;
+        fprintf(file, "%s{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                first_event ? "" : ",\n", (past->start - origin)*1e-3, (past->end - past->start)*1e-3);
+        first_event = false;
+        for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+            if (past->stage_first[stage] == 0) {
+                continue;
+            }
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                    stages[stage].name, (past->stage_first[stage] - origin)*1e-3, past->stage_ns[stage]*1e-3);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    return fclose(file) == 0;
+}
+
+/**
+ * Writes the lines of text of the overlay above its graph, the top one first.
+ * @param bottom Row the panel the text is written on starts at.
+ * @param lines The lines.
+ * @param line_count Number of lines, at most PROFILE_OVERLAY_LINES.
+*/
+static void drawOverlayText(int bottom, const char *const *lines, int line_count) {
+    int width = 0;
+    for (int line = 0; line < line_count; line++) {
+        int line_width = textWidth(lines[line]);
+        width = line_width > width ? line_width : width;
+    }
+    //Background for the gaps between the lines, the lines themselves are opaque
+    int x_max = width + 2*TEXT_SPACING;
+    int y_max = bottom + line_count*(TEXT_GLYPH_HEIGHT + TEXT_SPACING);
+    fillRect(0, bottom, x_max, y_max - bottom, BACKGROUND_COLOR);
+    for (int line = 0; line < line_count; line++) {
+        int y = bottom + (line_count - 1 - line)*(TEXT_GLYPH_HEIGHT + TEXT_SPACING) + TEXT_SPACING;
+        textRunDraw(&text_runs[line], TEXT_SPACING, y, lines[line], TEXT_COLOR, BACKGROUND_COLOR);
+    }
+    dirtyAdd(0, bottom, x_max, y_max);
+}
+
+void profileDrawOverlay(const char *const *lines, int line_count) {
+    int frames = historyCount();
+    int columns = frames < frame.width ? frames : frame.width;
+    //Room for twice the target frame time, slower frames are cut off at the top
+    int height = (int)(2*PROFILE_OVERLAY_TARGET_MS*PROFILE_OVERLAY_PIXELS_PER_MS);
+    if (height > frame.height) {
+        height = frame.height;
+    }
+    if (columns == 0 || height == 0) {
+        return;
+    }
+
+    fillRect(0, 0, columns, height, BACKGROUND_COLOR);
+    //Newest frame on the right
+    for (int column = 0; column < columns; column++) {
+        const struct ProfileFrame *past = historyFrame(frames - columns + column);
+        double bottom_ms = 0;
+        for (int stage = 0; stage <= PROFILE_STAGE_COUNT; stage++) {
+            //The last segment is whatever no stage accounts for
+            double ms;
+            uint32_t color;
+            if (stage < PROFILE_STAGE_COUNT) {
+                ms = past->stage_ns[stage]*1e-6;
+                color = stages[stage].color;
+            } else {
+                ms = (past->end - past->start)*1e-6 - bottom_ms;
+                color = OTHER_COLOR;
+            }
+            int y_start = (int)(bottom_ms*PROFILE_OVERLAY_PIXELS_PER_MS);
+            int y_end = (int)((bottom_ms + ms)*PROFILE_OVERLAY_PIXELS_PER_MS);
+            if (y_end > height) {
+                y_end = height;
+            }
+            if (y_end > y_start) {
+                drawVerticalSpan(column, y_start, y_end - 1, color);
+            }
+            bottom_ms += ms;
+        }
+    }
+    drawHorizontalSpan((int)(PROFILE_OVERLAY_TARGET_MS*PROFILE_OVERLAY_PIXELS_PER_MS), 0, columns - 1, TARGET_COLOR);
+    dirtyAdd(0, 0, columns, height);
+
+    //Statistics sort the whole history, so they are only worked out now and then
+    if (rate_line[0] == '\0' || frame_count%PROFILE_OVERLAY_TEXT_FRAMES == 0) {
+        struct ProfileStats stats;
+        profileStats(&stats);
+        snprintf(rate_line, sizeof(rate_line), "%.1f fps  p50 %.2f ms  p99 %.2f ms",
+                 stats.fps, stats.frame_ms_p50, stats.frame_ms_p99);
+    }
+    const char *text[PROFILE_OVERLAY_LINES] = {rate_line};
+    int text_count = 1;
+    for (int line = 0; line < line_count && text_count < PROFILE_OVERLAY_LINES; line++) {
+        text[text_count++] = lines[line];
+    }
+    drawOverlayText(height, text, text_count);
+}
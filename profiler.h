@@ -0,0 +1,125 @@
+/**
+ * Frame time profiler. The main loop brackets each stage of a frame with
+ * profileStageBegin and profileStageEnd; the last PROFILE_HISTORY frames are
+ * kept in a ring buffer for statistics, export and the on-frame overlay.
+ * Only the thread running the main loop may use it.
+ * @file profiler.h
+ * @author ABM
+*/
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Number of frames kept for statistics and export. */
+#define PROFILE_HISTORY 1024
+
+/** Vertical scale of the overlay graph. */
+#define PROFILE_OVERLAY_PIXELS_PER_MS 4
+
+/** Frame time the overlay draws a reference line at, in milliseconds (60 frames per second). */
+#define PROFILE_OVERLAY_TARGET_MS (1000.0/60)
+
+/** Most lines of text the overlay writes above its graph, its own frame rate line included. */
+#define PROFILE_OVERLAY_LINES 4
+
+/** Frames between updates of the frame rate the overlay writes, slow enough to be read. */
+#define PROFILE_OVERLAY_TEXT_FRAMES 30
+
+/** The stages of a frame. */
+enum ProfileStage {
+    PROFILE_MESSAGES,
+    PROFILE_RECORD,
+    PROFILE_RASTERIZE,
+    PROFILE_OVERLAY,
+    PROFILE_UPDATE,
+    PROFILE_PRESENT,
+    PROFILE_WAIT,
+    PROFILE_STAGE_COUNT
+};
+
+/**
+ * Statistics over the frames in the history.
+*/
+struct ProfileStats {
+    //Number of frames the statistics cover
+    int frames;
+    //Frames per second, from the first frame starting to the last one ending
+    double fps;
+    //Median and 99th percentile frame time, in milliseconds
+    double frame_ms_p50;
+    double frame_ms_p99;
+    //Average time per frame spent in each stage, in milliseconds
+    double stage_ms[PROFILE_STAGE_COUNT];
+};
+
+/**
+ * Starts timing a frame.
+*/
+void profileFrameBegin(void);
+
+/**
+ * Finishes timing a frame and adds it to the history.
+*/
+void profileFrameEnd(void);
+
+/**
+ * Starts timing a stage of the current frame.
+ * A stage may run several times per frame, the times add up.
+ * @param stage The stage.
+*/
+void profileStageBegin(enum ProfileStage stage);
+
+/**
+ * Finishes timing a stage of the current frame.
+ * @param stage The stage, the same one passed to profileStageBegin.
+*/
+void profileStageEnd(enum ProfileStage stage);
+
+/**
+ * Forgets every frame in the history.
+*/
+void profileReset(void);
+
+/**
+ * Gets the name of a stage.
+ * @param stage The stage.
+ * @return Short lower case name, like "rasterize".
+*/
+const char *profileStageName(enum ProfileStage stage);
+
+/**
+ * Computes statistics over the frames in the history.
+ * @param stats Filled in with the statistics, all zero if there are no frames.
+*/
+void profileStats(struct ProfileStats *stats);
+
+/**
+ * Writes the frames in the history to a CSV file, one frame per row
+ * with its start, its length and the time spent in each stage.
+ * @param path The file to write.
+ * @return false if the file could not be written.
+*/
+bool profileExportCsv(const char *path);
+
+/**
+ * Writes the frames in the history to a Chrome trace file,
+ * which chrome://tracing and Perfetto can open.
+ * @param path The file to write.
+ * @return false if the file could not be written.
+*/
+bool profileExportTrace(const char *path);
+
+/**
+ * Draws a graph of the frame times in the history into the bottom left of the frame,
+ * one column per frame with the stages stacked in their colors, and writes the
+ * frame rate and frame times above it followed by the caller's counters.
+ * Each line of text is kept in a TextRun (text.h), so lines which are the same
+ * as in the last frame are only copied into the frame.
+ * @param lines Lines of text to write under the frame rate, like "radius 42".
+ * @param line_count Number of lines, past PROFILE_OVERLAY_LINES - 1 the rest are left out.
+*/
+void profileDrawOverlay(const char *const *lines, int line_count);
+
+#endif
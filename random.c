@@ -0,0 +1,346 @@
+/**
+ * Fast seedable random number generator.
+ * Each lane is an independent xoshiro128++ generator; stepping all lanes at
+ * once gives RANDOM_LANES numbers, which are handed out in lane order.
+ * Ranges are reduced with Lemire's multiply and shift, which only needs a
+ * divide (one per batch) to find the few products that have to be redrawn.
+ * @file random.c
+ * @author ABM
+*/
+#include "random.h"
+#include "thread.h"
+#include <stdatomic.h>
+
+/**
+ * Steps every lane blocks times, writing RANDOM_LANES numbers per step.
+*/
+typedef void (*GenerateFunction)(uint32_t state[4][RANDOM_LANES], uint32_t *values, size_t blocks);
+
+/**
+ * Reduces random numbers in place to 0 up to but not including range.
+*/
+typedef void (*ReduceFunction)(struct Random *random, uint32_t *values, size_t count, uint32_t range, uint32_t threshold);
+
+/**
+ * Rotates a 32 bit value left.
+ * @param value The value to rotate.
+ * @param bits Number of bits to rotate by, 1 to 31.
+ * @return The rotated value.
+*/
+static uint32_t rotateLeft(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/**
+ * Steps the lanes one at a time.
+ * @param state The state of the lanes.
+ * @param values Where to write the numbers.
+ * @param blocks Number of times to step every lane.
+*/
+static void generateScalar(uint32_t state[4][RANDOM_LANES], uint32_t *values, size_t blocks) {
+    for (int lane = 0; lane < RANDOM_LANES; lane++) {
+        uint32_t s0 = state[0][lane];
+        uint32_t s1 = state[1][lane];
+        uint32_t s2 = state[2][lane];
+        uint32_t s3 = state[3][lane];
+        for (size_t block = 0; block < blocks; block++) {
+            values[block*RANDOM_LANES + lane] = rotateLeft(s0 + s3, 7) + s0;
+            uint32_t t = s1 << 9;
+            s2 ^= s0;
+            s3 ^= s1;
+            s1 ^= s2;
+            s0 ^= s3;
+            s2 ^= t;
+            s3 = rotateLeft(s3, 11);
+        }
+        state[0][lane] = s0;
+        state[1][lane] = s1;
+        state[2][lane] = s2;
+        state[3][lane] = s3;
+    }
+}
+
+/**
+ * Reduces one random number to 0 up to but not including range,
+ * redrawing it while the low half of its product with range is below threshold.
+ * @param random The generator to redraw from.
+ * @param value The number to reduce.
+ * @param range Number of possible results.
+ * @param threshold 2^32 % range, the low halves which make some results more likely than others.
+ * @return The reduced number.
+*/
+static uint32_t reduceOne(struct Random *random, uint32_t value, uint32_t range, uint32_t threshold) {
+    uint64_t product = (uint64_t)value*range;
+    while ((uint32_t)product < threshold) {
+        product = (uint64_t)randomNext(random)*range;
+    }
+    return (uint32_t)(product >> 32);
+}
+
+/**
+ * Reduces random numbers one at a time.
+ * @param random The generator to redraw from.
+ * @param values The numbers to reduce.
+ * @param count Number of numbers.
+ * @param range Number of possible results.
+ * @param threshold 2^32 % range.
+*/
+static void reduceScalar(struct Random *random, uint32_t *values, size_t count, uint32_t range, uint32_t threshold) {
+    for (size_t i = 0; i < count; i++) {
+        values[i] = reduceOne(random, values[i], range, threshold);
+    }
+}
+
+#ifdef SIMD_X86
+
+/**
+ * Rotates each 32 bit value of an SSE2 register left.
+ * @param value The values to rotate.
+ * @param bits Number of bits to rotate by, 1 to 31.
+ * @return The rotated values.
+*/
+static __m128i rotateLeftSse2(__m128i value, int bits) {
+    return _mm_or_si128(_mm_slli_epi32(value, bits), _mm_srli_epi32(value, 32 - bits));
+}
+
+/**
+ * Steps 4 lanes at a time with SSE2, two registers per state word.
+ * @param state The state of the lanes.
+ * @param values Where to write the numbers.
+ * @param blocks Number of times to step every lane.
+*/
+static void generateSse2(uint32_t state[4][RANDOM_LANES], uint32_t *values, size_t blocks) {
+    for (int half = 0; half < RANDOM_LANES; half += 4) {
+        __m128i s0 = _mm_loadu_si128((const __m128i *)&state[0][half]);
+        __m128i s1 = _mm_loadu_si128((const __m128i *)&state[1][half]);
+        __m128i s2 = _mm_loadu_si128((const __m128i *)&state[2][half]);
+        __m128i s3 = _mm_loadu_si128((const __m128i *)&state[3][half]);
+        for (size_t block = 0; block < blocks; block++) {
+            __m128i result = _mm_add_epi32(rotateLeftSse2(_mm_add_epi32(s0, s3), 7), s0);
+            _mm_storeu_si128((__m128i *)&values[block*RANDOM_LANES + half], result);
+            __m128i t = _mm_slli_epi32(s1, 9);
+            s2 = _mm_xor_si128(s2, s0);
+            s3 = _mm_xor_si128(s3, s1);
+            s1 = _mm_xor_si128(s1, s2);
+            s0 = _mm_xor_si128(s0, s3);
+            s2 = _mm_xor_si128(s2, t);
+            s3 = rotateLeftSse2(s3, 11);
+        }
+        _mm_storeu_si128((__m128i *)&state[0][half], s0);
+        _mm_storeu_si128((__m128i *)&state[1][half], s1);
+        _mm_storeu_si128((__m128i *)&state[2][half], s2);
+        _mm_storeu_si128((__m128i *)&state[3][half], s3);
+    }
+}
+
+/**
+ * Reduces random numbers 4 at a time with SSE2, multiplying the even and odd lanes separately.
+ * A group with a number to redraw is done one at a time, so the redraws come in the same order.
+ * @param random The generator to redraw from.
+ * @param values The numbers to reduce.
+ * @param count Number of numbers.
+ * @param range Number of possible results.
+ * @param threshold 2^32 % range.
+*/
+static void reduceSse2(struct Random *random, uint32_t *values, size_t count, uint32_t range, uint32_t threshold) {
+    __m128i ranges = _mm_set1_epi32((int)range);
+    //Unsigned comparison through a signed one, by flipping the sign bits
+    __m128i sign = _mm_set1_epi32((int)0x80000000u);
+    __m128i thresholds = _mm_xor_si128(_mm_set1_epi32((int)threshold), sign);
+    __m128i high_mask = _mm_set_epi32(-1, 0, -1, 0);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i numbers = _mm_loadu_si128((const __m128i *)&values[i]);
+        __m128i even = _mm_mul_epu32(numbers, ranges);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(numbers, 32), ranges);
+        __m128i low = _mm_or_si128(_mm_andnot_si128(high_mask, even), _mm_slli_epi64(odd, 32));
+        if (_mm_movemask_epi8(_mm_cmplt_epi32(_mm_xor_si128(low, sign), thresholds))) {
+            reduceScalar(random, values + i, 4, range, threshold);
+            continue;
+        }
+        __m128i high = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_and_si128(high_mask, odd));
+        _mm_storeu_si128((__m128i *)&values[i], high);
+    }
+    reduceScalar(random, values + i, count - i, range, threshold);
+}
+
+/**
+ * Rotates each 32 bit value of an AVX2 register left.
+ * @param value The values to rotate.
+ * @param bits Number of bits to rotate by, 1 to 31.
+ * @return The rotated values.
+*/
+TARGET_AVX2 static __m256i rotateLeftAvx2(__m256i value, int bits) {
+    return _mm256_or_si256(_mm256_slli_epi32(value, bits), _mm256_srli_epi32(value, 32 - bits));
+}
+
+/**
+ * Steps all 8 lanes at once with AVX2.
+ * @param state The state of the lanes.
+ * @param values Where to write the numbers.
+ * @param blocks Number of times to step every lane.
+*/
+TARGET_AVX2 static void generateAvx2(uint32_t state[4][RANDOM_LANES], uint32_t *values, size_t blocks) {
+    __m256i s0 = _mm256_loadu_si256((const __m256i *)state[0]);
+    __m256i s1 = _mm256_loadu_si256((const __m256i *)state[1]);
+    __m256i s2 = _mm256_loadu_si256((const __m256i *)state[2]);
+    __m256i s3 = _mm256_loadu_si256((const __m256i *)state[3]);
+    for (size_t block = 0; block < blocks; block++) {
+        __m256i result = _mm256_add_epi32(rotateLeftAvx2(_mm256_add_epi32(s0, s3), 7), s0);
+        _mm256_storeu_si256((__m256i *)&values[block*RANDOM_LANES], result);
+        __m256i t = _mm256_slli_epi32(s1, 9);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = rotateLeftAvx2(s3, 11);
+    }
+    _mm256_storeu_si256((__m256i *)state[0], s0);
+    _mm256_storeu_si256((__m256i *)state[1], s1);
+    _mm256_storeu_si256((__m256i *)state[2], s2);
+    _mm256_storeu_si256((__m256i *)state[3], s3);
+}
+
+/**
+ * Reduces random numbers 8 at a time with AVX2, multiplying the even and odd lanes separately.
+ * A group with a number to redraw is done one at a time, so the redraws come in the same order.
+ * @param random The generator to redraw from.
+ * @param values The numbers to reduce.
+ * @param count Number of numbers.
+ * @param range Number of possible results.
+ * @param threshold 2^32 % range.
+*/
+TARGET_AVX2 static void reduceAvx2(struct Random *random, uint32_t *values, size_t count, uint32_t range, uint32_t threshold) {
+    __m256i ranges = _mm256_set1_epi32((int)range);
+    //Unsigned comparison through a signed one, by flipping the sign bits
+    __m256i sign = _mm256_set1_epi32((int)0x80000000u);
+    __m256i thresholds = _mm256_xor_si256(_mm256_set1_epi32((int)threshold), sign);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i numbers = _mm256_loadu_si256((const __m256i *)&values[i]);
+        __m256i even = _mm256_mul_epu32(numbers, ranges);
+        __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(numbers, 32), ranges);
+        __m256i low = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(thresholds, _mm256_xor_si256(low, sign)))) {
+            reduceScalar(random, values + i, 8, range, threshold);
+            continue;
+        }
+        __m256i high = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+        _mm256_storeu_si256((__m256i *)&values[i], high);
+    }
+    reduceScalar(random, values + i, count - i, range, threshold);
+}
+
+#endif
+
+//Kernels by enum SimdLevel, NULL where they weren't compiled in.
+static const struct {
+    GenerateFunction generate;
+    ReduceFunction reduce;
+} kernels[SIMD_LEVEL_COUNT] = {
+    [SIMD_SCALAR] = {generateScalar, reduceScalar},
+#ifdef SIMD_X86
+    [SIMD_SSE2] = {generateSse2, reduceSse2},
+    [SIMD_AVX2] = {generateAvx2, reduceAvx2},
+#endif
+};
+
+//Generator of each thread, and how many threads have seeded theirs so far.
+static THREAD_LOCAL struct Random thread_random;
+static THREAD_LOCAL bool thread_random_seeded = false;
+static atomic_uint thread_random_count = 0;
+
+/**
+ * Steps a splitmix64 generator, used to turn a seed into xoshiro state.
+ * @param seed The splitmix64 state, advanced by one step.
+ * @return The next splitmix64 number.
+*/
+static uint64_t splitMix64(uint64_t *seed) {
+    uint64_t z = (*seed += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void randomSeed(struct Random *random, uint64_t seed) {
+    for (int lane = 0; lane < RANDOM_LANES; lane++) {
+        uint64_t low = splitMix64(&seed);
+        uint64_t high = splitMix64(&seed);
+        random->state[0][lane] = (uint32_t)low;
+        random->state[1][lane] = (uint32_t)(low >> 32);
+        random->state[2][lane] = (uint32_t)high;
+        random->state[3][lane] = (uint32_t)(high >> 32);
+        //xoshiro gets stuck at an all zero state
+        if ((low | high) == 0) {
+            random->state[0][lane] = 1;
+        }
+    }
+    random->buffered = 0;
+    random->level = simdBest();
+}
+
+bool randomSetLevel(struct Random *random, enum SimdLevel level) {
+    if (!simdSupported(level) || !kernels[level].generate) {
+        return false;
+    }
+    random->level = level;
+    return true;
+}
+
+struct Random *randomThread(void) {
+    if (!thread_random_seeded) {
+        randomSeed(&thread_random, RANDOM_DEFAULT_SEED + atomic_fetch_add(&thread_random_count, 1));
+        thread_random_seeded = true;
+    }
+    return &thread_random;
+}
+
+uint32_t randomNext(struct Random *random) {
+    if (random->buffered == 0) {
+        kernels[random->level].generate(random->state, random->buffer, 1);
+        random->buffered = RANDOM_LANES;
+    }
+    return random->buffer[RANDOM_LANES - random->buffered--];
+}
+
+uint32_t randomBelow(struct Random *random, uint32_t range) {
+    if (range == 0) {
+        return 0;
+    }
+    uint32_t value = randomNext(random);
+    //Only a low half below range can be below the threshold,
+    //so the divide is skipped almost every time
+    if ((uint32_t)((uint64_t)value*range) >= range) {
+        return (uint32_t)(((uint64_t)value*range) >> 32);
+    }
+    return reduceOne(random, value, range, (0u - range)%range);
+}
+
+void randomFill(struct Random *random, uint32_t *values, size_t count) {
+    //Hand out what is left of the last step first, so the order stays the same
+    size_t i = 0;
+    while (i < count && random->buffered > 0) {
+        values[i++] = randomNext(random);
+    }
+
+    size_t blocks = (count - i)/RANDOM_LANES;
+    kernels[random->level].generate(random->state, values + i, blocks);
+    i += blocks*RANDOM_LANES;
+
+    while (i < count) {
+        values[i++] = randomNext(random);
+    }
+}
+
+void randomFillBelow(struct Random *random, uint32_t *values, size_t count, uint32_t range) {
+    if (range == 0) {
+        for (size_t i = 0; i < count; i++) {
+            values[i] = 0;
+        }
+        return;
+    }
+
+    randomFill(random, values, count);
+    kernels[random->level].reduce(random, values, count, range, (0u - range)%range);
+}
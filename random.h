@@ -0,0 +1,91 @@
+/**
+ * Fast seedable random number generator, RANDOM_LANES interleaved xoshiro128++
+ * generators stepped together with SIMD. The same seed gives the same numbers
+ * whichever instruction set does the stepping, so frames are reproducible.
+ * @file random.h
+ * @author ABM
+*/
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "simd.h"
+
+/** Number of interleaved generators, one AVX2 register of 32 bit values. */
+#define RANDOM_LANES 8
+
+/** Seed of the per-thread generators until randomSeed reseeds them. */
+#define RANDOM_DEFAULT_SEED 0x5EED5EED5EED5EEDull
+
+/**
+ * A random number generator. Numbers come out lane by lane,
+ * so the n-th number is the same whether it was asked for alone or in a batch.
+*/
+struct Random {
+    //xoshiro128++ state words, one column per lane
+    uint32_t state[4][RANDOM_LANES];
+    //Output of the last step of all lanes, the last buffered of them not handed out yet
+    uint32_t buffer[RANDOM_LANES];
+    int buffered;
+    //Instruction set used to step the lanes
+    enum SimdLevel level;
+};
+
+/**
+ * Seeds a generator, using the fastest instruction set the CPU supports.
+ * @param random The generator to seed.
+ * @param seed Any value, the same seed always gives the same numbers.
+*/
+void randomSeed(struct Random *random, uint64_t seed);
+
+/**
+ * Forces the instruction set a generator is stepped with, for benchmarking.
+ * The numbers don't change, only how fast they come.
+ * @param random The generator.
+ * @param level The instruction set to use.
+ * @return false (and nothing changes) if the instruction set isn't supported.
+*/
+bool randomSetLevel(struct Random *random, enum SimdLevel level);
+
+/**
+ * Gets the generator of the calling thread, seeded with RANDOM_DEFAULT_SEED
+ * and the order in which threads first asked for theirs.
+ * @return The generator of the calling thread.
+*/
+struct Random *randomThread(void);
+
+/**
+ * Draws a random 32 bit number.
+ * @param random The generator.
+ * @return The number.
+*/
+uint32_t randomNext(struct Random *random);
+
+/**
+ * Draws an unbiased random number from 0 up to but not including range,
+ * using a multiply instead of a divide.
+ * @param random The generator.
+ * @param range Number of possible results, 0 always gives 0.
+ * @return The number.
+*/
+uint32_t randomBelow(struct Random *random, uint32_t range);
+
+/**
+ * Fills an array with random 32 bit numbers.
+ * @param random The generator.
+ * @param values The array to fill.
+ * @param count Number of values to draw.
+*/
+void randomFill(struct Random *random, uint32_t *values, size_t count);
+
+/**
+ * Fills an array with unbiased random numbers from 0 up to but not including range.
+ * @param random The generator.
+ * @param values The array to fill.
+ * @param count Number of values to draw.
+ * @param range Number of possible results, 0 fills the array with 0.
+*/
+void randomFillBelow(struct Random *random, uint32_t *values, size_t count, uint32_t range);
+
+#endif
@@ -0,0 +1,435 @@
+/**
+ * Multithreaded renderer which splits the frame into horizontal bands.
+ * Every command is binned into the bands its rows overlap, then the bands are
+ * handed out to the threads, each starting with a contiguous run of bands.
+ * A thread which runs out of bands steals from the far end of another thread's run.
+ * Big points commands are sorted into bins first, every thread sorting a chunk of the points,
+ * so each band only reads its own points instead of all of them.
+ * @file renderer.c
+ * @author ABM
+*/
+#include "renderer.h"
+#include "framebuffer.h"
+#include "thread.h"
+#include "points.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Number of commands a bin starts out with room for. */
+#define BIN_INITIAL_CAPACITY 64
+
+/**
+ * Indices of the commands which touch one band, in recording order.
+*/
+struct Bin {
+    int *commands;
+    int count;
+    int capacity;
+};
+
+/**
+ * One rasterizing thread. Worker 0 is the thread calling rendererExecute.
+*/
+struct Worker {
+    struct Renderer *renderer;
+    int index;
+    struct Thread thread;
+    //Bands this worker still has to do, the next one in the high 32 bits and
+    //one past the last one in the low 32 bits. Packed together so the owner
+    //(taking from the front) and thieves (taking from the back) can both
+    //claim a band with a single compare and swap.
+    _Atomic uint64_t queue;
+};
+
+/**
+ * A points command of the frame being rasterized, sorted into bins.
+*/
+struct SortedPoints {
+    int command;
+    struct PointBins points;
+};
+
+struct Renderer {
+    int thread_count;
+    struct Worker *workers;
+
+    //Wakes the workers up for a frame and tells the caller when they are done
+    struct Mutex mutex;
+    struct Condition start;
+    struct Condition done;
+    unsigned generation;
+    int busy_workers;
+    bool quit;
+    //What the workers do when woken up
+    void (*task)(struct Worker *worker);
+
+    //The frame being rasterized
+    const struct CommandList *list;
+    int band_height;
+    int band_count;
+    struct Bin *bins;
+    int bin_capacity;
+    //The big points commands, in recording order
+    struct SortedPoints *sorted;
+    int sorted_count;
+    int sorted_capacity;
+};
+
+/**
+ * Packs a run of bands into a queue value.
+ * @param next First band of the run.
+ * @param end One past the last band of the run.
+ * @return The packed value.
+*/
+static uint64_t packQueue(uint32_t next, uint32_t end) {
+    return (uint64_t)next << 32 | end;
+}
+
+/**
+ * Takes the next band from the front of a worker's own queue.
+ * @param worker The worker.
+ * @return The band, or -1 if the queue is empty.
+*/
+static int popBand(struct Worker *worker) {
+    uint64_t queue = atomic_load(&worker->queue);
+    for (;;) {
+        uint32_t next = queue >> 32;
+        uint32_t end = (uint32_t)queue;
+        if (next >= end) {
+            return -1;
+        }
+        if (atomic_compare_exchange_weak(&worker->queue, &queue, packQueue(next + 1, end))) {
+            return next;
+        }
+    }
+}
+
+/**
+ * Takes a band from the back of another worker's queue.
+ * @param worker The worker looking for work.
+ * @return The band, or -1 if every queue is empty.
+*/
+static int stealBand(struct Worker *worker) {
+    struct Renderer *renderer = worker->renderer;
+    for (int i = 1; i < renderer->thread_count; i++) {
+        struct Worker *victim = &renderer->workers[(worker->index + i)%renderer->thread_count];
+        uint64_t queue = atomic_load(&victim->queue);
+        for (;;) {
+            uint32_t next = queue >> 32;
+            uint32_t end = (uint32_t)queue;
+            if (next >= end) {
+                break;
+            }
+            if (atomic_compare_exchange_weak(&victim->queue, &queue, packQueue(next, end - 1))) {
+                return end - 1;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * Runs the commands of one band, clipped to the band.
+ * @param renderer The renderer.
+ * @param band The band.
+*/
+static void rasterizeBand(struct Renderer *renderer, int band) {
+    int y_min = band*renderer->band_height;
+    int y_max = y_min + renderer->band_height < frame.height ? y_min + renderer->band_height : frame.height;
+    frameSetClip(0, y_min, frame.width, y_max);
+
+    //The bin and the sorted points commands are both in recording order
+    const struct Bin *bin = &renderer->bins[band];
+    int sorted = 0;
+    for (int i = 0; i < bin->count; i++) {
+        int command = bin->commands[i];
+        while (sorted < renderer->sorted_count && renderer->sorted[sorted].command < command) {
+            sorted++;
+        }
+        if (sorted < renderer->sorted_count && renderer->sorted[sorted].command == command) {
+            pointBinsDraw(&renderer->sorted[sorted].points);
+        } else {
+            commandExecute(renderer->list, &renderer->list->commands[command]);
+        }
+    }
+}
+
+/**
+ * Rasterizes bands until there are none left to take or steal.
+ * @param worker The worker doing the rasterizing.
+*/
+static void workerRun(struct Worker *worker) {
+    int band;
+    while ((band = popBand(worker)) >= 0 || (band = stealBand(worker)) >= 0) {
+        rasterizeBand(worker->renderer, band);
+    }
+    frameResetClip();
+}
+
+/**
+ * Counts the points of this worker's chunk of every big points command.
+ * @param worker The worker doing the counting.
+*/
+static void workerCountPoints(struct Worker *worker) {
+    for (int i = 0; i < worker->renderer->sorted_count; i++) {
+        pointBinsCount(&worker->renderer->sorted[i].points, worker->index);
+    }
+}
+
+/**
+ * Copies the points of this worker's chunk of every big points command into their bins.
+ * @param worker The worker doing the copying.
+*/
+static void workerScatterPoints(struct Worker *worker) {
+    for (int i = 0; i < worker->renderer->sorted_count; i++) {
+        pointBinsScatter(&worker->renderer->sorted[i].points, worker->index);
+    }
+}
+
+/**
+ * Main function of the worker threads, runs the renderer's task once per generation.
+ * @param argument The worker.
+*/
+static void workerThread(void *argument) {
+    struct Worker *worker = argument;
+    struct Renderer *renderer = worker->renderer;
+    unsigned generation = 0;
+
+    mutexLock(&renderer->mutex);
+    for (;;) {
+        while (!renderer->quit && renderer->generation == generation) {
+            conditionWait(&renderer->start, &renderer->mutex);
+        }
+        if (renderer->quit) {
+            break;
+        }
+        generation = renderer->generation;
+        void (*task)(struct Worker *worker) = renderer->task;
+        mutexUnlock(&renderer->mutex);
+
+        task(worker);
+
+        mutexLock(&renderer->mutex);
+        renderer->busy_workers--;
+        if (renderer->busy_workers == 0) {
+            conditionSignal(&renderer->done);
+        }
+    }
+    mutexUnlock(&renderer->mutex);
+}
+
+/**
+ * Runs a task on every worker, the calling thread included, and waits until they are all done.
+ * @param renderer The renderer.
+ * @param task The task.
+*/
+static void runTask(struct Renderer *renderer, void (*task)(struct Worker *worker)) {
+    mutexLock(&renderer->mutex);
+    renderer->task = task;
+    renderer->busy_workers = renderer->thread_count - 1;
+    renderer->generation++;
+    conditionBroadcast(&renderer->start);
+    mutexUnlock(&renderer->mutex);
+
+    task(&renderer->workers[0]);
+
+    mutexLock(&renderer->mutex);
+    while (renderer->busy_workers > 0) {
+        conditionWait(&renderer->done, &renderer->mutex);
+    }
+    mutexUnlock(&renderer->mutex);
+}
+
+/**
+ * Sorts the points commands with at least POINT_SORT_THRESHOLD points into bins,
+ * each worker counting and then copying one chunk of the points.
+ * @param renderer The renderer.
+ * @param list The commands of the frame.
+*/
+static void sortPoints(struct Renderer *renderer, const struct CommandList *list) {
+    renderer->sorted_count = 0;
+    for (int i = 0; i < list->count; i++) {
+        const struct Command *command = &list->commands[i];
+        if (command->type != COMMAND_POINTS || command->args[1] < POINT_SORT_THRESHOLD) {
+            continue;
+        }
+        if (renderer->sorted_count == renderer->sorted_capacity) {
+            int capacity = renderer->sorted_capacity > 0 ? renderer->sorted_capacity*2 : 4;
+            struct SortedPoints *sorted = realloc(renderer->sorted, capacity*sizeof(struct SortedPoints));
+            if (!sorted) {
+                printf("Sorting the points failed.\n");
+                exit(1);
+            }
+            for (int j = renderer->sorted_capacity; j < capacity; j++) {
+                pointBinsInit(&sorted[j].points);
+            }
+            renderer->sorted = sorted;
+            renderer->sorted_capacity = capacity;
+        }
+        struct SortedPoints *sorted = &renderer->sorted[renderer->sorted_count++];
+        sorted->command = i;
+        pointBinsBegin(&sorted->points, list->point_indices + command->args[0],
+                       list->point_colors + command->args[0], command->args[1], renderer->thread_count);
+    }
+    if (renderer->sorted_count == 0) {
+        return;
+    }
+
+    runTask(renderer, workerCountPoints);
+    for (int i = 0; i < renderer->sorted_count; i++) {
+        pointBinsOffsets(&renderer->sorted[i].points);
+    }
+    runTask(renderer, workerScatterPoints);
+}
+
+/**
+ * Splits the frame into bands and sorts the commands into them.
+ * @param renderer The renderer.
+ * @param list The commands to sort.
+*/
+static void binCommands(struct Renderer *renderer, const struct CommandList *list) {
+    //Aim for a few bands per thread, rounded up to whole triangle tiles
+    int target_bands = renderer->thread_count*RENDERER_BANDS_PER_THREAD;
+    int band_height = (frame.height + target_bands - 1)/target_bands;
+    band_height = (band_height + RENDERER_BAND_ALIGNMENT - 1)/RENDERER_BAND_ALIGNMENT*RENDERER_BAND_ALIGNMENT;
+    renderer->band_height = band_height;
+    renderer->band_count = (frame.height + band_height - 1)/band_height;
+
+    if (renderer->band_count > renderer->bin_capacity) {
+        struct Bin *bins = realloc(renderer->bins, renderer->band_count*sizeof(struct Bin));
+        if (!bins) {
+            printf("Binning the command list failed.\n");
+            exit(1);
+        }
+        for (int i = renderer->bin_capacity; i < renderer->band_count; i++) {
+            bins[i].commands = NULL;
+            bins[i].capacity = 0;
+        }
+        renderer->bins = bins;
+        renderer->bin_capacity = renderer->band_count;
+    }
+    for (int i = 0; i < renderer->band_count; i++) {
+        renderer->bins[i].count = 0;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        int y_min = list->commands[i].y_min;
+        int y_max = list->commands[i].y_max;
+        if (y_max < 0 || y_min >= frame.height || y_min > y_max) {
+            continue;
+        }
+        int first = y_min > 0 ? y_min/band_height : 0;
+        int last = y_max < frame.height ? y_max/band_height : renderer->band_count - 1;
+        for (int band = first; band <= last; band++) {
+            struct Bin *bin = &renderer->bins[band];
+            if (bin->count == bin->capacity) {
+                int capacity = bin->capacity > 0 ? bin->capacity*2 : BIN_INITIAL_CAPACITY;
+                int *commands = realloc(bin->commands, capacity*sizeof(int));
+                if (!commands) {
+                    printf("Binning the command list failed.\n");
+                    exit(1);
+                }
+                bin->commands = commands;
+                bin->capacity = capacity;
+            }
+            bin->commands[bin->count++] = i;
+        }
+    }
+}
+
+struct Renderer *rendererCreate(int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = threadCpuCount();
+    }
+
+    struct Renderer *renderer = calloc(1, sizeof(struct Renderer));
+    if (!renderer) {
+        return NULL;
+    }
+    renderer->workers = calloc(thread_count, sizeof(struct Worker));
+    if (!renderer->workers) {
+        free(renderer);
+        return NULL;
+    }
+
+    mutexInit(&renderer->mutex);
+    conditionInit(&renderer->start);
+    conditionInit(&renderer->done);
+
+    //Worker 0 is the calling thread, only the others need a thread of their own.
+    //If the system won't start as many threads as asked for, make do with fewer.
+    renderer->thread_count = 1;
+    renderer->workers[0].renderer = renderer;
+    renderer->workers[0].index = 0;
+    for (int i = 1; i < thread_count; i++) {
+        struct Worker *worker = &renderer->workers[i];
+        worker->renderer = renderer;
+        worker->index = i;
+        atomic_init(&worker->queue, 0);
+        if (!threadStart(&worker->thread, workerThread, worker)) {
+            break;
+        }
+        renderer->thread_count++;
+    }
+    atomic_init(&renderer->workers[0].queue, 0);
+
+    return renderer;
+}
+
+void rendererDestroy(struct Renderer *renderer) {
+    if (!renderer) {
+        return;
+    }
+
+    mutexLock(&renderer->mutex);
+    renderer->quit = true;
+    conditionBroadcast(&renderer->start);
+    mutexUnlock(&renderer->mutex);
+    for (int i = 1; i < renderer->thread_count; i++) {
+        threadJoin(&renderer->workers[i].thread);
+    }
+
+    conditionDestroy(&renderer->done);
+    conditionDestroy(&renderer->start);
+    mutexDestroy(&renderer->mutex);
+    for (int i = 0; i < renderer->bin_capacity; i++) {
+        free(renderer->bins[i].commands);
+    }
+    free(renderer->bins);
+    for (int i = 0; i < renderer->sorted_capacity; i++) {
+        pointBinsFree(&renderer->sorted[i].points);
+    }
+    free(renderer->sorted);
+    free(renderer->workers);
+    free(renderer);
+}
+
+int rendererThreadCount(const struct Renderer *renderer) {
+    return renderer->thread_count;
+}
+
+void rendererExecute(struct Renderer *renderer, const struct CommandList *list) {
+    commandListMarkDirty(list);
+
+    //Nothing to split up with a single thread or an empty frame
+    if (renderer->thread_count == 1 || frame.height == 0 || !frame.pixels) {
+        frameResetClip();
+        commandListExecute(list);
+        return;
+    }
+
+    sortPoints(renderer, list);
+    binCommands(renderer, list);
+
+    //Every worker starts out with its own contiguous run of bands
+    for (int i = 0; i < renderer->thread_count; i++) {
+        uint32_t next = (uint32_t)((int64_t)i*renderer->band_count/renderer->thread_count);
+        uint32_t end = (uint32_t)((int64_t)(i + 1)*renderer->band_count/renderer->thread_count);
+        atomic_store(&renderer->workers[i].queue, packQueue(next, end));
+    }
+
+    renderer->list = list;
+    runTask(renderer, workerRun);
+}
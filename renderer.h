@@ -0,0 +1,53 @@
+/**
+ * Multithreaded renderer which splits the frame into horizontal bands
+ * and rasterizes a command list into the bands in parallel.
+ * @file renderer.h
+ * @author ABM
+*/
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "commandList.h"
+
+/** Number of bands per thread, more bands give work stealing more to balance. */
+#define RENDERER_BANDS_PER_THREAD 4
+
+/** Band heights are a multiple of this, so bands line up with the triangle tiles. */
+#define RENDERER_BAND_ALIGNMENT 8
+
+struct Renderer;
+
+/**
+ * Creates a renderer and starts its worker threads.
+ * The thread calling rendererExecute works too, so thread_count - 1 workers are started.
+ * @param thread_count Number of threads to rasterize with, 0 for one per logical CPU.
+ * @return The renderer, or NULL if it could not be created.
+*/
+struct Renderer *rendererCreate(int thread_count);
+
+/**
+ * Stops the worker threads and releases the renderer.
+ * @param renderer The renderer to release, may be NULL.
+*/
+void rendererDestroy(struct Renderer *renderer);
+
+/**
+ * Gets the number of threads a renderer rasterizes with.
+ * @param renderer The renderer.
+ * @return The number of threads, including the calling thread.
+*/
+int rendererThreadCount(const struct Renderer *renderer);
+
+/**
+ * Rasterizes a command list into the frame and waits until it is done.
+ * The result is pixel for pixel the same as commandListExecute,
+ * since every band runs the commands touching it in recording order.
+ * With several threads, points commands with at least POINT_SORT_THRESHOLD points
+ * are sorted into bins first, see points.h, which keeps the last point of each pixel on top.
+ * Everything the commands can draw into is marked dirty.
+ * @param renderer The renderer.
+ * @param list The commands to rasterize.
+*/
+void rendererExecute(struct Renderer *renderer, const struct CommandList *list);
+
+#endif
@@ -0,0 +1,479 @@
+/**
+ * Retained mode drawing. A shape's spans are found by running its draw call into a mask
+ * the size of the part of the frame it can reach, so retained shapes come out pixel for
+ * pixel like the ones drawn straight into the frame, then reading the mask back as runs.
+ * @file retained.c
+ * @author ABM
+*/
+#include "retained.h"
+#include "primitives.h"
+#include "fill.h"
+#include "dirty.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Number of shapes, changed ids and spans per shape the arrays start out with room for. */
+#define RETAINED_INITIAL_CAPACITY 16
+
+/** Value of the mask pixels no shape drew, the byte every mask pixel is cleared to repeated. */
+#define RETAINED_EMPTY 0xFFFFFFFFu
+
+//Number of x, y pairs at the start of the arguments of each command type which can be
+//retained, which are moved when the shape is drawn into the mask, and number of arguments.
+static const struct {
+    int points;
+    int arguments;
+} retained_arguments[] = {
+    [COMMAND_DRAW_CIRCLE] = {1, 3},
+    [COMMAND_DRAW_TRIANGLE] = {1, 3},
+    [COMMAND_CIRCLE_OUTLINE] = {1, 3},
+    [COMMAND_CIRCLE_FILLED] = {1, 3},
+    [COMMAND_TRIANGLE_FILLED] = {3, 6},
+    [COMMAND_LINE] = {2, 4},
+};
+
+/**
+ * Resizes an array to a new capacity.
+ * Running out of memory while drawing a frame is fatal, like in the rest of the program.
+ * @param array The array, may be NULL.
+ * @param capacity The new number of elements.
+ * @param element_size Size of one element, in bytes.
+ * @return The resized array.
+*/
+static void *resize(void *array, size_t capacity, size_t element_size) {
+    void *new_array = realloc(array, capacity*element_size);
+    if (!new_array) {
+        printf("Retaining the shapes failed.\n");
+        exit(1);
+    }
+    return new_array;
+}
+
+/**
+ * Tells whether a command type can be retained.
+ * @param type The type.
+ * @return true for the single shape draw calls.
+*/
+static bool retainable(enum CommandType type) {
+    return type >= COMMAND_DRAW_CIRCLE && type <= COMMAND_LINE;
+}
+
+/**
+ * Adds a rectangle to the ones the current frame repaints, merging it into
+ * one it overlaps, or once the list is full into the one it grows the least.
+ * @param retained The shapes.
+ * @param rect The rectangle, may be empty.
+*/
+static void addDamage(struct Retained *retained, struct FrameRect rect) {
+    if (rect.x_min >= rect.x_max || rect.y_min >= rect.y_max) {
+        return;
+    }
+    for (int i = 0; i < retained->damage_count; i++) {
+        if (frameRectsOverlap(retained->damage[i], rect)) {
+            retained->damage[i] = frameRectUnion(retained->damage[i], rect);
+            return;
+        }
+    }
+    if (retained->damage_count < RETAINED_MAX_DAMAGE) {
+        retained->damage[retained->damage_count++] = rect;
+        return;
+    }
+    int best = frameRectGrowsLeast(retained->damage, retained->damage_count, rect);
+    retained->damage[best] = frameRectUnion(retained->damage[best], rect);
+}
+
+/**
+ * Marks a shape as changed, to be rasterized and painted by the next retainedDraw.
+ * @param retained The shapes.
+ * @param id Id of the shape.
+*/
+static void markChanged(struct Retained *retained, int id) {
+    struct RetainedShape *shape = &retained->shapes[id];
+    if (shape->changed) {
+        return;
+    }
+    shape->changed = true;
+    if (retained->changed_count == retained->changed_capacity) {
+        retained->changed_capacity = retained->changed_capacity > 0 ? retained->changed_capacity*2
+                                                                    : RETAINED_INITIAL_CAPACITY;
+        retained->changed = resize(retained->changed, retained->changed_capacity, sizeof(int));
+    }
+    retained->changed[retained->changed_count++] = id;
+}
+
+/**
+ * Appends a span to a shape.
+ * @param shape The shape.
+ * @param y Row of the span.
+ * @param x_start Leftmost pixel of the span.
+ * @param x_end Rightmost pixel of the span.
+ * @param color Color of the span.
+*/
+static void appendSpan(struct RetainedShape *shape, int y, int x_start, int x_end, uint32_t color) {
+    if (shape->span_count == shape->span_capacity) {
+        shape->span_capacity = shape->span_capacity > 0 ? shape->span_capacity*2 : RETAINED_INITIAL_CAPACITY;
+        shape->spans = resize(shape->spans, shape->span_capacity, sizeof(struct RetainedSpan));
+    }
+    shape->spans[shape->span_count++] = (struct RetainedSpan){y, x_start, x_end, color};
+}
+
+/**
+ * Finds the spans of a shape for the current frame size, by drawing it into the mask
+ * in place of the frame, moved so the corner of the part of the frame its command
+ * can reach lands on the corner of the mask, then reading the mask back row by row.
+ * @param retained The shapes.
+ * @param id Id of the shape.
+*/
+static void rasterizeShape(struct Retained *retained, int id) {
+    struct RetainedShape *shape = &retained->shapes[id];
+    struct Command command = shape->command;
+    shape->span_count = 0;
+    retained->bounds[id] = (struct FrameRect){0, 0, 0, 0};
+    retained->rasterized++;
+
+    int x_min = command.x_min > 0 ? command.x_min : 0;
+    int y_min = command.y_min > 0 ? command.y_min : 0;
+    int x_max = command.x_max < frame.width - 1 ? command.x_max + 1 : frame.width;
+    int y_max = command.y_max < frame.height - 1 ? command.y_max + 1 : frame.height;
+    if (x_min >= x_max || y_min >= y_max) {
+        return;
+    }
+    int width = x_max - x_min;
+    int height = y_max - y_min;
+    size_t size = (size_t)width*height;
+    if (size > retained->mask_capacity) {
+        free(retained->mask);
+        retained->mask = resize(NULL, size, sizeof(uint32_t));
+        retained->mask_capacity = size;
+    }
+    memset(retained->mask, 0xFF, size*sizeof(uint32_t));
+
+    for (int point = 0; point < retained_arguments[command.type].points; point++) {
+        command.args[2*point] -= x_min;
+        command.args[2*point + 1] -= y_min;
+    }
+    //A shape the color of empty mask pixels is drawn in another color and given its own back below
+    if (command.color == RETAINED_EMPTY) {
+        command.color = 0;
+    }
+    struct Frame saved = frame;
+    frame = (struct Frame){width, height, width, retained->mask, FRAME_LAYOUT_ROWS};
+    commandExecute(&retained->scratch, &command);
+    frame = saved;
+
+    struct FrameRect bounds = {x_max, y_max, x_min, y_min};
+    for (int y = 0; y < height; y++) {
+        const uint32_t *row = retained->mask + (size_t)y*width;
+        int x = 0;
+        while (x < width) {
+            if (row[x] == RETAINED_EMPTY) {
+                x++;
+                continue;
+            }
+            uint32_t value = row[x];
+            int start = x;
+            while (x < width && row[x] == value) {
+                x++;
+            }
+            appendSpan(shape, y_min + y, x_min + start, x_min + x - 1,
+                       value == command.color ? shape->command.color : value);
+            bounds = frameRectUnion(bounds, (struct FrameRect){x_min + start, y_min + y, x_min + x, y_min + y + 1});
+        }
+    }
+    if (shape->span_count > 0) {
+        retained->bounds[id] = bounds;
+    }
+}
+
+/**
+ * Paints the spans of a shape which fall inside a rectangle.
+ * @param shape The shape.
+ * @param rect The rectangle, inside the frame.
+*/
+static void paintShape(const struct RetainedShape *shape, struct FrameRect rect) {
+    //The spans are sorted by row, so skip to the first one in the rectangle
+    int low = 0;
+    int high = shape->span_count;
+    while (low < high) {
+        int middle = low + (high - low)/2;
+        if (shape->spans[middle].y < rect.y_min) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for (int i = low; i < shape->span_count && shape->spans[i].y < rect.y_max; i++) {
+        const struct RetainedSpan *span = &shape->spans[i];
+        int x_start = span->x_start > rect.x_min ? span->x_start : rect.x_min;
+        int x_end = span->x_end < rect.x_max - 1 ? span->x_end : rect.x_max - 1;
+        if (x_start <= x_end) {
+            drawHorizontalSpan(span->y, x_start, x_end, span->color);
+        }
+    }
+}
+
+/**
+ * Tells whether a shape is drawn by a draw call.
+ * @param shape The shape.
+ * @param key The draw call, with the arguments it doesn't take zeroed.
+ * @return true if the shape is in use and has the same type, color and arguments.
+*/
+static bool sameShape(const struct RetainedShape *shape, const struct Command *key) {
+    return shape->used && shape->command.type == key->type && shape->command.color == key->color &&
+           memcmp(shape->command.args, key->args, sizeof(key->args)) == 0;
+}
+
+/**
+ * Gets the draw call for one shape of a batch, without the bounds,
+ * which are only worked out when the shape turns out to have changed.
+ * @param command The batch command.
+ * @param n Index of the shape in the batch.
+ * @param key Set to the draw call, with the arguments it doesn't take zeroed.
+ *        Points become lines from the point to itself, which set just that pixel.
+*/
+static void batchShape(const struct Command *command, int n, struct Command *key) {
+    const struct ShapeBatch *batch = command->batch;
+    *key = (struct Command){0};
+    key->color = batch->colors[n];
+    switch (command->type) {
+        case COMMAND_CIRCLE_BATCH:
+            key->type = batch->filled[n] ? COMMAND_CIRCLE_FILLED : COMMAND_CIRCLE_OUTLINE;
+            break;
+        case COMMAND_TRIANGLE_BATCH:
+            key->type = COMMAND_TRIANGLE_FILLED;
+            break;
+        default:
+            key->type = COMMAND_LINE;
+            break;
+    }
+    if (command->type == COMMAND_POINT_BATCH) {
+        key->args[0] = key->args[2] = batch->coordinates[0][n];
+        key->args[1] = key->args[3] = batch->coordinates[1][n];
+        return;
+    }
+    for (int i = 0; i < retained_arguments[key->type].arguments; i++) {
+        key->args[i] = batch->coordinates[i][n];
+    }
+}
+
+void retainedInit(struct Retained *retained, uint32_t background) {
+    retained->shapes = NULL;
+    retained->bounds = NULL;
+    retained->shape_count = 0;
+    retained->shape_capacity = 0;
+    retained->changed = NULL;
+    retained->changed_count = 0;
+    retained->changed_capacity = 0;
+    retained->background = background;
+    retained->repaint_all = true;
+    retained->width = 0;
+    retained->height = 0;
+    retained->mask = NULL;
+    retained->mask_capacity = 0;
+    commandListInit(&retained->scratch);
+    retained->damage_count = 0;
+    retained->rasterized = 0;
+    retained->painted = 0;
+}
+
+void retainedFree(struct Retained *retained) {
+    for (int id = 0; id < retained->shape_count; id++) {
+        free(retained->shapes[id].spans);
+    }
+    free(retained->shapes);
+    free(retained->bounds);
+    free(retained->changed);
+    free(retained->mask);
+    commandListFree(&retained->scratch);
+    retainedInit(retained, retained->background);
+}
+
+void retainedSetBackground(struct Retained *retained, uint32_t color) {
+    if (color != retained->background) {
+        retained->background = color;
+        retained->repaint_all = true;
+    }
+}
+
+bool retainedSet(struct Retained *retained, int id, const struct Command *command) {
+    if (id < 0 || !retainable(command->type)) {
+        return false;
+    }
+    if (id >= retained->shape_capacity) {
+        int capacity = retained->shape_capacity > 0 ? retained->shape_capacity : RETAINED_INITIAL_CAPACITY;
+        while (capacity <= id) {
+            capacity *= 2;
+        }
+        retained->shapes = resize(retained->shapes, capacity, sizeof(struct RetainedShape));
+        retained->bounds = resize(retained->bounds, capacity, sizeof(struct FrameRect));
+        retained->shape_capacity = capacity;
+    }
+    while (retained->shape_count <= id) {
+        int new_id = retained->shape_count++;
+        retained->shapes[new_id] = (struct RetainedShape){0};
+        retained->bounds[new_id] = (struct FrameRect){0, 0, 0, 0};
+    }
+
+    //Only the arguments the draw call takes are compared, the rest are zeroed
+    struct Command key = *command;
+    for (int i = retained_arguments[key.type].arguments; i < SHAPE_BATCH_ARRAYS; i++) {
+        key.args[i] = 0;
+    }
+    key.batch = NULL;
+    key.antialias = false;
+
+    struct RetainedShape *shape = &retained->shapes[id];
+    if (sameShape(shape, &key)) {
+        return true;
+    }
+    shape->command = key;
+    shape->used = true;
+    markChanged(retained, id);
+    return true;
+}
+
+void retainedRemove(struct Retained *retained, int id) {
+    if (id >= 0 && id < retained->shape_count && retained->shapes[id].used) {
+        retained->shapes[id].used = false;
+        markChanged(retained, id);
+    }
+}
+
+void retainedDraw(struct Retained *retained) {
+    frameResetClip();
+    retained->damage_count = 0;
+    retained->rasterized = 0;
+    retained->painted = 0;
+
+    //Every span is cut to the frame, so a new size means finding them all again
+    bool resized = frame.width != retained->width || frame.height != retained->height;
+    if (resized || retained->repaint_all) {
+        retained->width = frame.width;
+        retained->height = frame.height;
+        retained->repaint_all = false;
+        fillClear(retained->background);
+        for (int id = 0; id < retained->shape_count; id++) {
+            struct RetainedShape *shape = &retained->shapes[id];
+            if (!shape->used) {
+                shape->span_count = 0;
+                retained->bounds[id] = (struct FrameRect){0, 0, 0, 0};
+            } else if (resized || shape->changed) {
+                rasterizeShape(retained, id);
+            }
+            shape->changed = false;
+            paintShape(shape, (struct FrameRect){0, 0, frame.width, frame.height});
+            retained->painted += shape->used;
+        }
+        retained->changed_count = 0;
+        retained->damage[0] = (struct FrameRect){0, 0, frame.width, frame.height};
+        retained->damage_count = 1;
+        dirtyAddFrame();
+        return;
+    }
+
+    //Erase where the changed shapes were and find where they are now
+    for (int i = 0; i < retained->changed_count; i++) {
+        int id = retained->changed[i];
+        struct RetainedShape *shape = &retained->shapes[id];
+        for (int span = 0; span < shape->span_count; span++) {
+            drawHorizontalSpan(shape->spans[span].y, shape->spans[span].x_start, shape->spans[span].x_end,
+                               retained->background);
+        }
+        addDamage(retained, retained->bounds[id]);
+        shape->changed = false;
+        if (shape->used) {
+            rasterizeShape(retained, id);
+            addDamage(retained, retained->bounds[id]);
+        } else {
+            shape->span_count = 0;
+            retained->bounds[id] = (struct FrameRect){0, 0, 0, 0};
+        }
+    }
+    retained->changed_count = 0;
+    if (retained->damage_count == 0) {
+        return;
+    }
+
+    //Paint every shape over the erased pixels again, bottom to top
+    struct FrameRect all = retained->damage[0];
+    for (int i = 1; i < retained->damage_count; i++) {
+        all = frameRectUnion(all, retained->damage[i]);
+    }
+    for (int id = 0; id < retained->shape_count; id++) {
+        struct FrameRect bounds = retained->bounds[id];
+        if (!frameRectsOverlap(bounds, all)) {
+            continue;
+        }
+        bool painted = false;
+        for (int i = 0; i < retained->damage_count; i++) {
+            if (frameRectsOverlap(bounds, retained->damage[i])) {
+                paintShape(&retained->shapes[id], retained->damage[i]);
+                painted = true;
+            }
+        }
+        retained->painted += painted;
+    }
+    for (int i = 0; i < retained->damage_count; i++) {
+        const struct FrameRect *rect = &retained->damage[i];
+        dirtyAdd(rect->x_min, rect->y_min, rect->x_max, rect->y_max);
+    }
+}
+
+void retainedDrawList(struct Retained *retained, const struct CommandList *list) {
+    struct CommandList *scratch = &retained->scratch;
+    int id = 0;
+    for (int i = 0; i < list->count; i++) {
+        const struct Command *command = &list->commands[i];
+        if (command->type == COMMAND_CLEAR) {
+            retainedSetBackground(retained, command->color);
+        } else if (retainable(command->type)) {
+            retainedSet(retained, id++, command);
+        } else if (command->batch) {
+            int end = command->args[0] + command->args[1];
+            for (int n = command->args[0]; n < end; n++, id++) {
+                struct Command key;
+                batchShape(command, n, &key);
+                if (id < retained->shape_count && sameShape(&retained->shapes[id], &key)) {
+                    continue;
+                }
+                //Recorded on its own to get the bounds of the shape
+                const int *args = key.args;
+                commandListReset(scratch);
+                switch (key.type) {
+                    case COMMAND_CIRCLE_OUTLINE:
+                        commandListCircleOutline(scratch, args[0], args[1], args[2], key.color);
+                        break;
+                    case COMMAND_CIRCLE_FILLED:
+                        commandListCircleFilled(scratch, args[0], args[1], args[2], key.color);
+                        break;
+                    case COMMAND_TRIANGLE_FILLED:
+                        commandListTriangleFilled(scratch, args[0], args[1], args[2], args[3], args[4], args[5],
+                                                  key.color);
+                        break;
+                    default:
+                        commandListLine(scratch, args[0], args[1], args[2], args[3], key.color);
+                        break;
+                }
+                retainedSet(retained, id, &scratch->commands[0]);
+            }
+        }
+    }
+    for (int removed = id; removed < retained->shape_count; removed++) {
+        retainedRemove(retained, removed);
+    }
+    commandListReset(scratch);
+
+    retainedDraw(retained);
+
+    //Each points command is marked dirty through a list of just that command, like an immediately drawn list would be
+    struct CommandList points = *list;
+    points.count = 1;
+    for (int i = 0; i < list->count; i++) {
+        if (list->commands[i].type == COMMAND_POINTS) {
+            commandExecute(list, &list->commands[i]);
+            points.commands = &list->commands[i];
+            commandListMarkDirty(&points);
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/**
+ * Retained mode drawing: shapes are kept from one frame to the next under stable ids,
+ * each with the spans of pixels it covers, cut out once with the usual rasterizers.
+ * A frame only rasterizes the shapes whose draw call changed, erases the spans they
+ * covered before to the background and repaints what they were drawn over,
+ * so a frame in which nothing moved costs next to nothing.
+ * Shapes are painted in id order, higher ids on top, like commands later in a list.
+ * Only the thread recording frames may use it, between frames.
+ * @file retained.h
+ * @author ABM
+*/
+#ifndef RETAINED_H
+#define RETAINED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "framebuffer.h"
+#include "commandList.h"
+
+/** Most rectangles a frame repaints, past this a changed shape is merged into the one it grows the least. */
+#define RETAINED_MAX_DAMAGE 16
+
+/**
+ * A run of pixels of one color in a row, from x_start to x_end inclusive like drawHorizontalSpan.
+*/
+struct RetainedSpan {
+    int y;
+    int x_start;
+    int x_end;
+    uint32_t color;
+};
+
+/**
+ * One shape and what it last drew.
+*/
+struct RetainedShape {
+    //The draw call, compared against the one set next to tell whether the shape changed
+    struct Command command;
+    //Whether the id holds a shape
+    bool used;
+    //Whether the shape was set to a different draw call or removed since the last retainedDraw
+    bool changed;
+    //Every pixel the shape covers in the frame, row by row from the bottom
+    struct RetainedSpan *spans;
+    int span_count;
+    int span_capacity;
+};
+
+/**
+ * The retained shapes and the frame they were painted into.
+*/
+struct Retained {
+    struct RetainedShape *shapes;
+    //Rectangle around the spans of each shape, empty if it has none,
+    //kept apart from the shapes so finding the ones to repaint reads little memory
+    struct FrameRect *bounds;
+    //Ids 0 to shape_count - 1 have been set at some point
+    int shape_count;
+    int shape_capacity;
+    //Ids of the shapes with changed set
+    int *changed;
+    int changed_count;
+    int changed_capacity;
+    //Color of the frame where no shape is
+    uint32_t background;
+    //Set when the whole frame has to be painted again, like after the background changed
+    bool repaint_all;
+    //Size of the frame the spans were cut to, the spans are cut again when it changes
+    int width;
+    int height;
+    //Where shapes are drawn to find their spans
+    uint32_t *mask;
+    size_t mask_capacity;
+    //Used for the bounds of shapes which are recorded as batches
+    struct CommandList scratch;
+    //Rectangles the last retainedDraw repainted
+    struct FrameRect damage[RETAINED_MAX_DAMAGE];
+    int damage_count;
+    //Number of shapes the last retainedDraw rasterized and painted
+    int rasterized;
+    int painted;
+};
+
+/**
+ * Sets up an empty set of shapes.
+ * @param retained The shapes to set up.
+ * @param background Color of the frame where no shape is.
+*/
+void retainedInit(struct Retained *retained, uint32_t background);
+
+/**
+ * Releases the memory of the shapes.
+ * @param retained The shapes to release.
+*/
+void retainedFree(struct Retained *retained);
+
+/**
+ * Changes the color of the frame where no shape is, which repaints the whole frame.
+ * @param retained The shapes.
+ * @param color The new color.
+*/
+void retainedSetBackground(struct Retained *retained, uint32_t color);
+
+/**
+ * Sets the shape with an id to a draw call. Nothing is done if it already is that draw call,
+ * otherwise it is rasterized again by the next retainedDraw.
+ * Shapes are always drawn aliased, an anti-aliased shape depends on what is under it
+ * so it can't be kept as spans of single colors.
+ * @param retained The shapes.
+ * @param id Id of the shape, 0 or more. Ids are best kept small and dense.
+ * @param command The draw call, a COMMAND_DRAW_CIRCLE, COMMAND_DRAW_TRIANGLE, COMMAND_CIRCLE_OUTLINE,
+ *        COMMAND_CIRCLE_FILLED, COMMAND_TRIANGLE_FILLED or COMMAND_LINE recorded into any command list.
+ * @return false if the command can't be retained (clears, points and batches), the shape is then left as it was.
+*/
+bool retainedSet(struct Retained *retained, int id, const struct Command *command);
+
+/**
+ * Removes the shape with an id, the next retainedDraw erases it.
+ * @param retained The shapes.
+ * @param id Id of the shape, nothing happens if there is no shape with that id.
+*/
+void retainedRemove(struct Retained *retained, int id);
+
+/**
+ * Brings the frame up to date with the shapes. Shapes which changed have their old spans
+ * erased to the background and are rasterized again, then every shape overlapping
+ * what changed is painted again from its spans, in id order, and marked dirty.
+ * The whole frame is cleared and painted the first time, when the frame was resized
+ * and when the background changed. Resets the clip rectangle of the calling thread.
+ * @param retained The shapes.
+*/
+void retainedDraw(struct Retained *retained);
+
+/**
+ * Takes the shapes from a command list recorded the usual way and draws them with retainedDraw.
+ * Each shape of the list gets the next id, with every shape of a batch counted
+ * (points of a batch are kept as lines from the point to itself), so a list which
+ * records the same shapes in the same order each frame keeps their ids. Ids past the
+ * last shape of the list are removed and a clear sets the background.
+ * Points commands aren't retained: they are drawn after the shapes, over whatever is there,
+ * and stay until a shape changes over them.
+ * @param retained The shapes.
+ * @param list The list.
+*/
+void retainedDrawList(struct Retained *retained, const struct CommandList *list);
+
+#endif
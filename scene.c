@@ -0,0 +1,466 @@
+/**
+ * Scene files: binary scenes are memory mapped, text scenes are parsed into
+ * memory laid out the same way, so both are drawn through the same arrays.
+ * @file scene.c
+ * @author ABM
+*/
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+#include "scene.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** Size of the binary header in bytes: magic, version, clear flag, clear color and the counts. */
+#define SCENE_HEADER_SIZE (4*(4 + SCENE_SHAPE_COUNT))
+
+//Coordinate arrays per kind of shape, and the command drawing a batch of them
+static const struct {
+    int arrays;
+    enum CommandType command;
+} shape_layout[SCENE_SHAPE_COUNT] = {
+    {3, COMMAND_CIRCLE_BATCH},
+    {6, COMMAND_TRIANGLE_BATCH},
+    {4, COMMAND_LINE_BATCH},
+    {2, COMMAND_POINT_BATCH}
+};
+
+//Shapes of the text format, by the word their lines start with
+static const struct {
+    const char *keyword;
+    enum SceneShape shape;
+    bool filled;
+} keywords[] = {
+    {"circle", SCENE_CIRCLES, false},
+    {"circle_filled", SCENE_CIRCLES, true},
+    {"triangle", SCENE_TRIANGLES, false},
+    {"line", SCENE_LINES, false},
+    {"point", SCENE_POINTS, false}
+};
+
+/**
+ * Computes how many bytes the arrays of one kind of shape take in the file.
+ * @param shape The kind of shape.
+ * @param count Number of shapes.
+ * @return Size in bytes, a multiple of 4.
+*/
+static size_t shapeSize(enum SceneShape shape, size_t count) {
+    size_t size = (shape_layout[shape].arrays + 1)*sizeof(int32_t)*count;
+    if (shape == SCENE_CIRCLES) {
+        size += (count + 3) & ~(size_t)3;
+    }
+    return size;
+}
+
+/**
+ * Points the shape batches of a scene into its data, after checking the header.
+ * @param scene The scene, with data and size set.
+ * @param path File name to print in error messages.
+ * @return true if the data is a valid scene of exactly its size.
+*/
+static bool attach(struct Scene *scene, const char *path) {
+    uint32_t header[4 + SCENE_SHAPE_COUNT];
+    if (scene->size < SCENE_HEADER_SIZE) {
+        printf("%s: too short for a scene.\n", path);
+        return false;
+    }
+    memcpy(header, scene->data, SCENE_HEADER_SIZE);
+    if (memcmp(scene->data, "PDSC", 4) != 0 || header[1] != SCENE_VERSION) {
+        printf("%s: not a version %d scene.\n", path, SCENE_VERSION);
+        return false;
+    }
+    scene->clear = header[2] != 0;
+    scene->clear_color = header[3];
+
+    //Counts are checked one at a time so the sum of the sizes can't overflow
+    size_t offset = SCENE_HEADER_SIZE;
+    for (int shape = 0; shape < SCENE_SHAPE_COUNT; shape++) {
+        uint32_t count = header[4 + shape];
+        if (count > INT32_MAX || count > SIZE_MAX/shapeSize(shape, 1)
+            || shapeSize(shape, count) > scene->size - offset) {
+            printf("%s: shorter than its header says.\n", path);
+            return false;
+        }
+        struct ShapeBatch *batch = &scene->shapes[shape];
+        memset(batch, 0, sizeof(struct ShapeBatch));
+        batch->count = (int)count;
+        for (int array = 0; array < shape_layout[shape].arrays; array++) {
+            batch->coordinates[array] = (const int32_t *)(scene->data + offset);
+            offset += count*sizeof(int32_t);
+        }
+        batch->colors = (const uint32_t *)(scene->data + offset);
+        offset += count*sizeof(uint32_t);
+        if (shape == SCENE_CIRCLES) {
+            batch->filled = scene->data + offset;
+            offset += (count + 3) & ~(size_t)3;
+        }
+    }
+    if (offset != scene->size) {
+        printf("%s: longer than its header says.\n", path);
+        return false;
+    }
+    if (!sceneUpdate(scene)) {
+        printf("%s: coordinates beyond %d.\n", path, SCENE_MAX_COORDINATE);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Writes the header of the binary format.
+ * @param scene The scene.
+ * @param data Where the SCENE_HEADER_SIZE bytes go.
+*/
+static void writeHeader(const struct Scene *scene, uint8_t *data) {
+    uint32_t header[4 + SCENE_SHAPE_COUNT];
+    memcpy(header, "PDSC", 4);
+    header[1] = SCENE_VERSION;
+    header[2] = scene->clear;
+    header[3] = scene->clear_color;
+    for (int shape = 0; shape < SCENE_SHAPE_COUNT; shape++) {
+        header[4 + shape] = (uint32_t)scene->shapes[shape].count;
+    }
+    memcpy(data, header, SCENE_HEADER_SIZE);
+}
+
+bool sceneCreate(struct Scene *scene, const int counts[SCENE_SHAPE_COUNT]) {
+    memset(scene, 0, sizeof(struct Scene));
+    scene->size = SCENE_HEADER_SIZE;
+    for (int shape = 0; shape < SCENE_SHAPE_COUNT; shape++) {
+        if (counts[shape] < 0) {
+            return false;
+        }
+        scene->shapes[shape].count = counts[shape];
+        scene->size += shapeSize(shape, counts[shape]);
+    }
+    scene->data = calloc(1, scene->size);
+    if (!scene->data) {
+        return false;
+    }
+    writeHeader(scene, scene->data);
+    if (!attach(scene, "scene")) {
+        sceneFree(scene);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Memory maps a binary scene file.
+ * @param scene The scene to load into.
+ * @param path The file.
+ * @return true if the file was mapped.
+*/
+static bool mapFile(struct Scene *scene, const char *path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = GetFileSizeEx(file, &size) ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+    scene->file_handle = file;
+    scene->mapping_handle = mapping;
+    scene->size = (size_t)size.QuadPart;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat status;
+    void *data = MAP_FAILED;
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    //The mapping stays valid without the file descriptor
+    close(file);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    scene->size = (size_t)status.st_size;
+#endif
+    scene->data = data;
+    scene->mapped = true;
+    return true;
+}
+
+/**
+ * Reads the numbers of one line of a text scene.
+ * @param line Where the numbers start.
+ * @param values Where the numbers go, the last one being the color.
+ * @param count Number of numbers to read.
+ * @return true if the line holds exactly count numbers.
+*/
+static bool parseNumbers(const char *line, long values[], int count) {
+    for (int i = 0; i < count; i++) {
+        char *end;
+        values[i] = i == count - 1 ? (long)strtoul(line, &end, 0) : strtol(line, &end, 0);
+        if (end == line) {
+            return false;
+        }
+        line = end;
+    }
+    while (*line == ' ' || *line == '\t' || *line == '\r') {
+        line++;
+    }
+    return *line == '\0' || *line == '\n' || *line == '#';
+}
+
+/**
+ * Goes over the lines of a text scene, counting the shapes or storing them.
+ * @param scene The scene to store into, or NULL to only count.
+ * @param text The whole file, ending in a null character.
+ * @param counts Number of shapes of each kind, counted or stored so far.
+ * @param path File name to print in error messages.
+ * @return true if every line could be read.
+*/
+static bool parseText(struct Scene *scene, const char *text, int counts[SCENE_SHAPE_COUNT], const char *path) {
+    int line_number = 0;
+    for (const char *line = text; *line; ) {
+        line_number++;
+        const char *next = strchr(line, '\n');
+        next = next ? next + 1 : line + strlen(line);
+
+        while (*line == ' ' || *line == '\t' || *line == '\r') {
+            line++;
+        }
+        if (*line == '#' || *line == '\n' || *line == '\0') {
+            line = next;
+            continue;
+        }
+
+        size_t length = 0;
+        while (isalpha((unsigned char)line[length]) || line[length] == '_') {
+            length++;
+        }
+        long values[SHAPE_BATCH_ARRAYS + 1];
+        bool parsed = false;
+        if (length == 5 && strncmp(line, "clear", 5) == 0) {
+            parsed = parseNumbers(line + length, values, 1);
+            if (parsed && scene) {
+                scene->clear = true;
+                scene->clear_color = (uint32_t)values[0];
+            }
+        }
+        for (size_t i = 0; i < sizeof(keywords)/sizeof(keywords[0]) && !parsed; i++) {
+            if (strlen(keywords[i].keyword) != length || strncmp(line, keywords[i].keyword, length) != 0) {
+                continue;
+            }
+            enum SceneShape shape = keywords[i].shape;
+            int arrays = shape_layout[shape].arrays;
+            if (!parseNumbers(line + length, values, arrays + 1)) {
+                break;
+            }
+            parsed = true;
+            int index = counts[shape]++;
+            if (scene) {
+                for (int array = 0; array < arrays; array++) {
+                    sceneCoordinates(scene, shape, array)[index] = (int32_t)values[array];
+                }
+                sceneColors(scene, shape)[index] = (uint32_t)values[arrays];
+                if (shape == SCENE_CIRCLES) {
+                    sceneFilled(scene)[index] = keywords[i].filled;
+                }
+            }
+        }
+        if (!parsed) {
+            printf("%s:%d: can't read this line.\n", path, line_number);
+            return false;
+        }
+        line = next;
+    }
+    return true;
+}
+
+/**
+ * Loads a text scene.
+ * @param scene The scene to load into.
+ * @param file The open file, read from the start.
+ * @param path File name to print in error messages.
+ * @return true if the scene was loaded.
+*/
+static bool loadText(struct Scene *scene, FILE *file, const char *path) {
+    if (fseek(file, 0, SEEK_END) != 0) {
+        return false;
+    }
+    long size = ftell(file);
+    rewind(file);
+    char *text = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (!text) {
+        return false;
+    }
+    size_t read = fread(text, 1, (size_t)size, file);
+    text[read] = '\0';
+
+    //Count the shapes first so their arrays can be allocated in one go
+    int counts[SCENE_SHAPE_COUNT] = {0};
+    bool loaded = parseText(NULL, text, counts, path) && sceneCreate(scene, counts);
+    if (loaded) {
+        memset(counts, 0, sizeof(counts));
+        loaded = parseText(scene, text, counts, path);
+        if (loaded && !sceneUpdate(scene)) {
+            printf("%s: coordinates beyond %d.\n", path, SCENE_MAX_COORDINATE);
+            loaded = false;
+        }
+        if (!loaded) {
+            sceneFree(scene);
+        }
+    }
+    free(text);
+    return loaded;
+}
+
+bool sceneLoad(struct Scene *scene, const char *path) {
+    memset(scene, 0, sizeof(struct Scene));
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        printf("%s: can't open.\n", path);
+        return false;
+    }
+    char magic[4] = {0};
+    bool binary = fread(magic, 1, 4, file) == 4 && memcmp(magic, "PDSC", 4) == 0;
+    if (!binary) {
+        bool loaded = loadText(scene, file, path);
+        fclose(file);
+        return loaded;
+    }
+    fclose(file);
+
+    if (!mapFile(scene, path)) {
+        printf("%s: can't map.\n", path);
+        return false;
+    }
+    if (!attach(scene, path)) {
+        sceneFree(scene);
+        return false;
+    }
+    return true;
+}
+
+bool sceneSave(const struct Scene *scene, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    //The header is written from the scene, which may have been changed since it was loaded
+    uint8_t header[SCENE_HEADER_SIZE];
+    writeHeader(scene, header);
+    bool written = fwrite(header, 1, SCENE_HEADER_SIZE, file) == SCENE_HEADER_SIZE &&
+                   fwrite(scene->data + SCENE_HEADER_SIZE, 1, scene->size - SCENE_HEADER_SIZE, file) ==
+                   scene->size - SCENE_HEADER_SIZE;
+    return fclose(file) == 0 && written;
+}
+
+void sceneFree(struct Scene *scene) {
+    if (scene->mapped) {
+#ifdef _WIN32
+        UnmapViewOfFile(scene->data);
+        CloseHandle(scene->mapping_handle);
+        CloseHandle(scene->file_handle);
+#else
+        munmap(scene->data, scene->size);
+#endif
+    } else {
+        free(scene->data);
+    }
+    for (int shape = 0; shape < SCENE_SHAPE_COUNT; shape++) {
+        free(scene->bounds[shape]);
+    }
+    memset(scene, 0, sizeof(struct Scene));
+}
+
+int32_t *sceneCoordinates(struct Scene *scene, enum SceneShape shape, int array) {
+    //The arrays of scenes which aren't mapped point into memory the scene allocated
+    return scene->mapped || array >= shape_layout[shape].arrays ? NULL : (int32_t *)scene->shapes[shape].coordinates[array];
+}
+
+uint32_t *sceneColors(struct Scene *scene, enum SceneShape shape) {
+    return scene->mapped ? NULL : (uint32_t *)scene->shapes[shape].colors;
+}
+
+uint8_t *sceneFilled(struct Scene *scene) {
+    return scene->mapped ? NULL : (uint8_t *)scene->shapes[SCENE_CIRCLES].filled;
+}
+
+bool sceneUpdate(struct Scene *scene) {
+    for (int shape = 0; shape < SCENE_SHAPE_COUNT; shape++) {
+        const struct ShapeBatch *batch = &scene->shapes[shape];
+        int arrays = shape_layout[shape].arrays;
+        int batch_count = (batch->count + SCENE_BATCH_SIZE - 1)/SCENE_BATCH_SIZE;
+        free(scene->bounds[shape]);
+        scene->bounds[shape] = batch_count > 0 ? malloc(batch_count*sizeof(struct FrameRect)) : NULL;
+        if (batch_count > 0 && !scene->bounds[shape]) {
+            return false;
+        }
+
+        for (int b = 0; b < batch_count; b++) {
+            struct FrameRect bounds = {SCENE_MAX_COORDINATE*2, SCENE_MAX_COORDINATE*2, -SCENE_MAX_COORDINATE*2, -SCENE_MAX_COORDINATE*2};
+            int end = (b + 1)*SCENE_BATCH_SIZE < batch->count ? (b + 1)*SCENE_BATCH_SIZE : batch->count;
+            for (int i = b*SCENE_BATCH_SIZE; i < end; i++) {
+                for (int array = 0; array < arrays; array++) {
+                    int32_t value = batch->coordinates[array][i];
+                    if (value < -SCENE_MAX_COORDINATE || value > SCENE_MAX_COORDINATE) {
+                        return false;
+                    }
+                }
+                //Circles reach radius around their center, the other shapes only their vertices
+                int reach = 0;
+                if (shape == SCENE_CIRCLES) {
+                    reach = batch->coordinates[2][i];
+                    if (reach < 0) {
+                        continue;
+                    }
+                }
+                for (int array = 0; array + 1 < arrays; array += 2) {
+                    int x = batch->coordinates[array][i];
+                    int y = batch->coordinates[array + 1][i];
+                    bounds.x_min = x - reach < bounds.x_min ? x - reach : bounds.x_min;
+                    bounds.y_min = y - reach < bounds.y_min ? y - reach : bounds.y_min;
+                    bounds.x_max = x + reach + 1 > bounds.x_max ? x + reach + 1 : bounds.x_max;
+                    bounds.y_max = y + reach + 1 > bounds.y_max ? y + reach + 1 : bounds.y_max;
+                    if (shape == SCENE_CIRCLES) {
+                        break;
+                    }
+                }
+            }
+            scene->bounds[shape][b] = bounds;
+        }
+    }
+    return true;
+}
+
+void sceneRecord(const struct Scene *scene, struct CommandList *list) {
+    if (scene->clear) {
+        commandListClear(list, scene->clear_color);
+    }
+    for (int shape = 0; shape < SCENE_SHAPE_COUNT; shape++) {
+        const struct ShapeBatch *batch = &scene->shapes[shape];
+        for (int first = 0, b = 0; first < batch->count; first += SCENE_BATCH_SIZE, b++) {
+            struct FrameRect bounds = scene->bounds[shape][b];
+            //Batches entirely outside of the frame (or of only hidden shapes) aren't recorded at all
+            if (bounds.x_max <= 0 || bounds.y_max <= 0 || bounds.x_min >= frame.width || bounds.y_min >= frame.height) {
+                continue;
+            }
+            int count = batch->count - first < SCENE_BATCH_SIZE ? batch->count - first : SCENE_BATCH_SIZE;
+            commandListBatch(list, shape_layout[shape].command, batch, first, count, bounds);
+        }
+    }
+}
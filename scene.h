@@ -0,0 +1,144 @@
+/**
+ * Scenes of shapes loaded from a file instead of compiled in.
+ * A scene holds circles, triangles, lines and points in structure of arrays
+ * layout and is recorded as a few batch commands per kind of shape,
+ * so scenes of hundreds of thousands of shapes record in microseconds.
+ *
+ * The binary format (.pdscene) is little-endian, starting with the header
+ *     "PDSC", version, clear flag, clear color, number of circles, triangles, lines, points
+ * as 32 bit values, followed by the arrays of each kind of shape in that order:
+ *     circles:   x[], y[], radius[], color[], filled[] (bytes, padded to 4)
+ *     triangles: x0[], y0[], x1[], y1[], x2[], y2[], color[]
+ *     lines:     x0[], y0[], x1[], y1[], color[]
+ *     points:    x[], y[], color[]
+ * Binary scenes are memory mapped and drawn straight from the mapping.
+ *
+ * The text format has one shape per line, # starts a comment:
+ *     clear COLOR
+ *     circle X Y RADIUS COLOR
+ *     circle_filled X Y RADIUS COLOR
+ *     triangle X0 Y0 X1 Y1 X2 Y2 COLOR
+ *     line X0 Y0 X1 Y1 COLOR
+ *     point X Y COLOR
+ * Colors are 0xRRGGBB (any base strtoul takes), coordinates have row 0 at the bottom.
+ * @file scene.h
+ * @author ABM
+*/
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "commandList.h"
+
+/** Version written into and expected in binary scene files. */
+#define SCENE_VERSION 1
+
+/** Number of shapes per batch command, small enough for the renderer to bin the batches into bands. */
+#define SCENE_BATCH_SIZE 256
+
+/** Largest coordinate or radius a scene may hold, so no rasterizer arithmetic can overflow. */
+#define SCENE_MAX_COORDINATE (1 << 24)
+
+/** The kinds of shapes in a scene, in the order they are drawn and stored. */
+enum SceneShape {
+    SCENE_CIRCLES,
+    SCENE_TRIANGLES,
+    SCENE_LINES,
+    SCENE_POINTS,
+    SCENE_SHAPE_COUNT
+};
+
+/**
+ * A loaded scene.
+*/
+struct Scene {
+    //Whether every frame starts by clearing to clear_color
+    bool clear;
+    uint32_t clear_color;
+    struct ShapeBatch shapes[SCENE_SHAPE_COUNT];
+    //Rectangle each run of SCENE_BATCH_SIZE shapes lies in
+    struct FrameRect *bounds[SCENE_SHAPE_COUNT];
+
+    //The file data, mapped or allocated, and its size in bytes
+    uint8_t *data;
+    size_t size;
+    bool mapped;
+    //Handles of the mapping, only used on Windows
+    void *file_handle;
+    void *mapping_handle;
+};
+
+/**
+ * Creates an empty scene with room for the given number of shapes, all at 0,0,
+ * for a program to fill in through sceneCoordinates, sceneColors and sceneFilled.
+ * @param scene The scene to set up.
+ * @param counts Number of shapes of each kind.
+ * @return true if the scene was created.
+*/
+bool sceneCreate(struct Scene *scene, const int counts[SCENE_SHAPE_COUNT]);
+
+/**
+ * Loads a scene file, binary if it starts with "PDSC", text otherwise.
+ * @param scene The scene to load into.
+ * @param path The file.
+ * @return true if the scene was loaded, false (after printing why) if it couldn't be.
+*/
+bool sceneLoad(struct Scene *scene, const char *path);
+
+/**
+ * Writes a scene in the binary format.
+ * @param scene The scene.
+ * @param path The file to write.
+ * @return true if it was written.
+*/
+bool sceneSave(const struct Scene *scene, const char *path);
+
+/**
+ * Releases a scene.
+ * @param scene The scene to release.
+*/
+void sceneFree(struct Scene *scene);
+
+/**
+ * Gets a coordinate array of a scene to fill in or change.
+ * @param scene The scene.
+ * @param shape The kind of shape.
+ * @param array Which argument of the draw call, see ShapeBatch.
+ * @return The array, or NULL for a memory mapped scene.
+*/
+int32_t *sceneCoordinates(struct Scene *scene, enum SceneShape shape, int array);
+
+/**
+ * Gets the colors of a kind of shape of a scene to fill in or change.
+ * @param scene The scene.
+ * @param shape The kind of shape.
+ * @return The array, or NULL for a memory mapped scene.
+*/
+uint32_t *sceneColors(struct Scene *scene, enum SceneShape shape);
+
+/**
+ * Gets the filled flags of the circles of a scene to fill in or change.
+ * @param scene The scene.
+ * @return The array, or NULL for a memory mapped scene.
+*/
+uint8_t *sceneFilled(struct Scene *scene);
+
+/**
+ * Checks the shapes of a scene and works out the bounds of its batches,
+ * to be called after filling in or changing a scene. Loading does this already.
+ * @param scene The scene.
+ * @return true if every coordinate is within SCENE_MAX_COORDINATE.
+*/
+bool sceneUpdate(struct Scene *scene);
+
+/**
+ * Records a scene: the clear, then every kind of shape in turn as batch commands.
+ * The scene has to stay loaded until the list is reset.
+ * @param scene The scene.
+ * @param list The list to record into.
+*/
+void sceneRecord(const struct Scene *scene, struct CommandList *list);
+
+#endif
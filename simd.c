@@ -0,0 +1,62 @@
+/**
+ * Instruction set detection shared by the vectorized kernels.
+ * @file simd.c
+ * @author ABM
+*/
+#include "simd.h"
+
+#ifdef SIMD_X86
+
+/**
+ * Asks the CPU (and the OS, which has to save the wider registers) whether AVX2 can be used.
+ * @return true if AVX2 is available.
+*/
+static bool cpuHasAvx2(void) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    //OSXSAVE and AVX
+    bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+    //The OS saves the XMM and YMM registers
+    if (!avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+bool simdSupported(enum SimdLevel level) {
+    switch (level) {
+        case SIMD_SCALAR:
+            return true;
+#ifdef SIMD_X86
+        //Every x86-64 CPU has SSE2, 32 bit ones almost all do
+        case SIMD_SSE2:
+            return true;
+        case SIMD_AVX2:
+            return cpuHasAvx2();
+#endif
+        default:
+            return false;
+    }
+}
+
+enum SimdLevel simdBest(void) {
+    for (int level = SIMD_LEVEL_COUNT - 1; level > SIMD_SCALAR; level--) {
+        if (simdSupported(level)) {
+            return level;
+        }
+    }
+    return SIMD_SCALAR;
+}
+
+const char *simdLevelName(enum SimdLevel level) {
+    static const char *names[SIMD_LEVEL_COUNT] = {"scalar", "sse2", "avx2"};
+    return level < SIMD_LEVEL_COUNT ? names[level] : "unknown";
+}
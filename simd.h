@@ -0,0 +1,56 @@
+/**
+ * Instruction set detection shared by the vectorized kernels,
+ * so every module dispatches on the same CPUID checks.
+ * @file simd.h
+ * @author ABM
+*/
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+//GCC and Clang only let AVX2 intrinsics be used in functions compiled for AVX2,
+//MSVC allows them anywhere.
+#if defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+/** The instruction sets kernels are written for, from slowest to fastest. */
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_LEVEL_COUNT
+};
+
+/**
+ * Checks whether an instruction set can be used on this CPU (and was compiled in).
+ * @param level The instruction set to check.
+ * @return true if kernels using it can run.
+*/
+bool simdSupported(enum SimdLevel level);
+
+/**
+ * Gets the fastest instruction set this CPU supports.
+ * @return The fastest supported level.
+*/
+enum SimdLevel simdBest(void);
+
+/**
+ * Gets the name of an instruction set.
+ * @param level The instruction set.
+ * @return Short lower case name, like "avx2".
+*/
+const char *simdLevelName(enum SimdLevel level);
+
+#endif
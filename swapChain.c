@@ -0,0 +1,212 @@
+/**
+ * Swap chain with a present thread.
+ * Buffer indices move between the render thread and the present thread through
+ * two single producer, single consumer queues, one of frames ready to present
+ * and one of buffers free to fill. Pushing and popping are plain atomic loads
+ * and stores; the mutex and condition are only touched when a side has to sleep
+ * because its queue is empty.
+ * @file swapChain.c
+ * @author ABM
+*/
+#include "swapChain.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Queue of buffer indices with one thread pushing and one thread popping.
+ * It never holds more indices than there are buffers, so it can't overflow.
+*/
+struct IndexQueue {
+    int slots[SWAP_CHAIN_MAX_BUFFERS];
+    //Number of indices popped and pushed so far
+    _Atomic unsigned head;
+    _Atomic unsigned tail;
+    //Set while the popping thread sleeps waiting for an index
+    _Atomic bool waiting;
+};
+
+struct SwapChain {
+    int buffer_count;
+    struct SwapBuffer buffers[SWAP_CHAIN_MAX_BUFFERS];
+    struct IndexQueue ready;
+    struct IndexQueue free;
+    long frames_queued;
+
+    SwapChainSink sink;
+    void *user_data;
+    struct Thread thread;
+
+    //Only for sleeping on an empty queue
+    struct Mutex mutex;
+    struct Condition wake;
+    _Atomic bool quit;
+};
+
+/**
+ * Adds an index to the back of a queue and wakes its popping thread if it sleeps.
+ * @param chain The swap chain the queue belongs to.
+ * @param queue The queue.
+ * @param index The buffer index.
+*/
+static void queuePush(struct SwapChain *chain, struct IndexQueue *queue, int index) {
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    queue->slots[tail%SWAP_CHAIN_MAX_BUFFERS] = index;
+    atomic_store(&queue->tail, tail + 1);
+    //The popping thread sets waiting before checking the queue a last time,
+    //so either it sees the new index or this sees it waiting
+    if (atomic_load(&queue->waiting)) {
+        mutexLock(&chain->mutex);
+        conditionBroadcast(&chain->wake);
+        mutexUnlock(&chain->mutex);
+    }
+}
+
+/**
+ * Takes the index at the front of a queue.
+ * @param queue The queue.
+ * @return The index, or -1 if the queue is empty.
+*/
+static int queuePop(struct IndexQueue *queue) {
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == atomic_load(&queue->tail)) {
+        return -1;
+    }
+    int index = queue->slots[head%SWAP_CHAIN_MAX_BUFFERS];
+    atomic_store(&queue->head, head + 1);
+    return index;
+}
+
+/**
+ * Takes the index at the front of a queue, sleeping until there is one.
+ * @param chain The swap chain the queue belongs to.
+ * @param queue The queue.
+ * @param stop_on_quit Whether to give up once the swap chain is quitting and the queue is empty.
+ * @return The index, or -1 if it gave up.
+*/
+static int queueWaitPop(struct SwapChain *chain, struct IndexQueue *queue, bool stop_on_quit) {
+    int index = queuePop(queue);
+    if (index >= 0) {
+        return index;
+    }
+
+    mutexLock(&chain->mutex);
+    atomic_store(&queue->waiting, true);
+    while ((index = queuePop(queue)) < 0 && !(stop_on_quit && atomic_load(&chain->quit))) {
+        conditionWait(&chain->wake, &chain->mutex);
+    }
+    atomic_store(&queue->waiting, false);
+    mutexUnlock(&chain->mutex);
+    return index;
+}
+
+/**
+ * Main function of the present thread, presents queued frames until the swap chain quits.
+ * @param argument The swap chain.
+*/
+static void presentThread(void *argument) {
+    struct SwapChain *chain = argument;
+    int index;
+    while ((index = queueWaitPop(chain, &chain->ready, true)) >= 0) {
+        chain->sink(&chain->buffers[index], chain->user_data);
+        queuePush(chain, &chain->free, index);
+    }
+}
+
+struct SwapChain *swapChainCreate(int buffer_count, SwapChainSink sink, void *user_data) {
+    if (buffer_count < 1 || buffer_count > SWAP_CHAIN_MAX_BUFFERS || !sink) {
+        return NULL;
+    }
+
+    struct SwapChain *chain = calloc(1, sizeof(struct SwapChain));
+    if (!chain) {
+        return NULL;
+    }
+    chain->buffer_count = buffer_count;
+    chain->sink = sink;
+    chain->user_data = user_data;
+    atomic_init(&chain->ready.head, 0);
+    atomic_init(&chain->ready.tail, 0);
+    atomic_init(&chain->ready.waiting, false);
+    atomic_init(&chain->free.head, 0);
+    atomic_init(&chain->free.tail, 0);
+    atomic_init(&chain->free.waiting, false);
+    atomic_init(&chain->quit, false);
+    mutexInit(&chain->mutex);
+    conditionInit(&chain->wake);
+
+    //Every buffer starts out free
+    for (int i = 0; i < buffer_count; i++) {
+        chain->free.slots[i] = i;
+    }
+    atomic_store(&chain->free.tail, buffer_count);
+
+    if (!threadStart(&chain->thread, presentThread, chain)) {
+        conditionDestroy(&chain->wake);
+        mutexDestroy(&chain->mutex);
+        free(chain);
+        return NULL;
+    }
+    return chain;
+}
+
+void swapChainDestroy(struct SwapChain *chain) {
+    if (!chain) {
+        return;
+    }
+
+    mutexLock(&chain->mutex);
+    atomic_store(&chain->quit, true);
+    conditionBroadcast(&chain->wake);
+    mutexUnlock(&chain->mutex);
+    threadJoin(&chain->thread);
+
+    conditionDestroy(&chain->wake);
+    mutexDestroy(&chain->mutex);
+    for (int i = 0; i < chain->buffer_count; i++) {
+        free(chain->buffers[i].pixels);
+    }
+    free(chain);
+}
+
+void swapChainPresent(void *user_data) {
+    struct SwapChain *chain = user_data;
+    int index = queueWaitPop(chain, &chain->free, false);
+    struct SwapBuffer *buffer = &chain->buffers[index];
+
+    //The buffer belongs to this thread until it is queued, so it can be resized here
+    size_t size = (size_t)frame.stride*frame.height;
+    buffer->width = frame.width;
+    buffer->height = frame.height;
+    buffer->stride = frame.stride;
+    buffer->rect_count = 0;
+    buffer->index = chain->frames_queued++;
+    if (size > buffer->capacity) {
+        free(buffer->pixels);
+        buffer->pixels = malloc(size*sizeof(uint32_t));
+        //Queuing the frame without its changes would leave them off the screen for good,
+        //so running out of memory is fatal, like in the rest of the program
+        if (!buffer->pixels) {
+            printf("Presenting the frame failed.\n");
+            exit(1);
+        }
+        buffer->capacity = size;
+    }
+
+    //Copy only what changed, that is all the present thread looks at
+    if (buffer->pixels && frame.pixels) {
+        int count;
+        const struct FrameRect *rects = dirtyRects(&count);
+        for (int i = 0; i < count; i++) {
+            const struct FrameRect *rect = &rects[i];
+            //Buffers are always row by row, whatever the frame's layout
+            frameReadPixels(rect, buffer->pixels + rect->x_min + (size_t)rect->y_min*frame.stride, frame.stride);
+            buffer->rects[i] = *rect;
+        }
+        buffer->rect_count = count;
+    }
+
+    queuePush(chain, &chain->ready, index);
+}
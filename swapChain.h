@@ -0,0 +1,73 @@
+/**
+ * Swap chain which hands finished frames to a present thread, so copying a
+ * frame to the screen (or wherever the sink sends it) overlaps with drawing
+ * the next one.
+ * The frame keeps what was drawn into it from one frame to the next, so it is
+ * not swapped itself: presenting copies its dirty rectangles into a free
+ * buffer of the chain and queues that buffer for the present thread.
+ * @file swapChain.h
+ * @author ABM
+*/
+#ifndef SWAP_CHAIN_H
+#define SWAP_CHAIN_H
+
+#include "framebuffer.h"
+#include "dirty.h"
+#include <stddef.h>
+
+/** Most buffers a swap chain can have. */
+#define SWAP_CHAIN_MAX_BUFFERS 4
+
+/**
+ * One buffer of a swap chain. Only the pixels inside its rectangles are valid,
+ * everything else is left over from older frames.
+*/
+struct SwapBuffer {
+    uint32_t *pixels;
+    int width;
+    int height;
+    //Same row layout as the frame, pixel x, y is pixels[x + y*stride]
+    int stride;
+    //The dirty rectangles of the frame, in the same coordinates as the frame
+    struct FrameRect rects[DIRTY_MAX_RECTS];
+    int rect_count;
+    //Number of frames presented before this one
+    long index;
+    //Number of pixels the buffer has room for
+    size_t capacity;
+};
+
+/**
+ * Function the present thread calls with each frame, in order.
+ * @param buffer The frame to present, valid until the function returns.
+ * @param user_data The pointer passed to swapChainCreate.
+*/
+typedef void (*SwapChainSink)(const struct SwapBuffer *buffer, void *user_data);
+
+struct SwapChain;
+
+/**
+ * Creates a swap chain and starts its present thread.
+ * @param buffer_count Number of buffers, 2 for double and 3 for triple buffering,
+ *                     up to SWAP_CHAIN_MAX_BUFFERS.
+ * @param sink Function presenting the frames, called on the present thread.
+ * @param user_data Pointer handed to the sink.
+ * @return The swap chain, or NULL if it could not be created.
+*/
+struct SwapChain *swapChainCreate(int buffer_count, SwapChainSink sink, void *user_data);
+
+/**
+ * Presents every frame still queued, stops the present thread and releases the swap chain.
+ * @param chain The swap chain to release, may be NULL.
+*/
+void swapChainDestroy(struct SwapChain *chain);
+
+/**
+ * Present hook which queues the frame for the present thread:
+ * frameSetPresentHook(swapChainPresent, chain).
+ * Waits only when every buffer is still queued or being presented.
+ * @param chain The swap chain.
+*/
+void swapChainPresent(void *chain);
+
+#endif
@@ -0,0 +1,295 @@
+/**
+ * Bitmap font text. A line of text is clipped once, then each of its rows is
+ * expanded a glyph at a time, straight into the frame when it is stored row by row.
+ * @file text.c
+ * @author ABM
+*/
+#include "text.h"
+#include "framebuffer.h"
+#include "simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** First character the font has a glyph for. */
+#define TEXT_FIRST_CHARACTER ' '
+
+/** Last character the font has a glyph for. */
+#define TEXT_LAST_CHARACTER '~'
+
+/** Pixels of a row of text expanded at a time before being copied into a tiled frame. */
+#define TEXT_CHUNK_PIXELS 256
+
+//A glyph for each printable ASCII character, rows from the top down with the leftmost pixel
+//in the top bit. The glyphs are 5x7 plus a row for descenders, with one blank column
+//on the left of the cell and two on the right to space the characters.
+static const uint8_t font[TEXT_LAST_CHARACTER - TEXT_FIRST_CHARACTER + 1][TEXT_GLYPH_HEIGHT] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, //space
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x10, 0x00}, //!
+    {0x28, 0x28, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00}, //"
+    {0x28, 0x28, 0x7C, 0x28, 0x7C, 0x28, 0x28, 0x00}, //#
+    {0x10, 0x3C, 0x50, 0x38, 0x14, 0x78, 0x10, 0x00}, //$
+    {0x60, 0x64, 0x08, 0x10, 0x20, 0x4C, 0x0C, 0x00}, //%
+    {0x30, 0x48, 0x50, 0x20, 0x54, 0x48, 0x34, 0x00}, //&
+    {0x10, 0x10, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00}, //'
+    {0x08, 0x10, 0x20, 0x20, 0x20, 0x10, 0x08, 0x00}, //(
+    {0x20, 0x10, 0x08, 0x08, 0x08, 0x10, 0x20, 0x00}, //)
+    {0x00, 0x10, 0x54, 0x38, 0x54, 0x10, 0x00, 0x00}, //*
+    {0x00, 0x10, 0x10, 0x7C, 0x10, 0x10, 0x00, 0x00}, //+
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x10, 0x20}, //,
+    {0x00, 0x00, 0x00, 0x7C, 0x00, 0x00, 0x00, 0x00}, //-
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x00}, //.
+    {0x00, 0x04, 0x08, 0x10, 0x20, 0x40, 0x00, 0x00}, ///
+    {0x38, 0x44, 0x4C, 0x54, 0x64, 0x44, 0x38, 0x00}, //0
+    {0x10, 0x30, 0x10, 0x10, 0x10, 0x10, 0x38, 0x00}, //1
+    {0x38, 0x44, 0x04, 0x08, 0x10, 0x20, 0x7C, 0x00}, //2
+    {0x7C, 0x08, 0x10, 0x08, 0x04, 0x44, 0x38, 0x00}, //3
+    {0x08, 0x18, 0x28, 0x48, 0x7C, 0x08, 0x08, 0x00}, //4
+    {0x7C, 0x40, 0x78, 0x04, 0x04, 0x44, 0x38, 0x00}, //5
+    {0x18, 0x20, 0x40, 0x78, 0x44, 0x44, 0x38, 0x00}, //6
+    {0x7C, 0x04, 0x08, 0x10, 0x20, 0x20, 0x20, 0x00}, //7
+    {0x38, 0x44, 0x44, 0x38, 0x44, 0x44, 0x38, 0x00}, //8
+    {0x38, 0x44, 0x44, 0x3C, 0x04, 0x08, 0x30, 0x00}, //9
+    {0x00, 0x30, 0x30, 0x00, 0x30, 0x30, 0x00, 0x00}, //:
+    {0x00, 0x30, 0x30, 0x00, 0x30, 0x10, 0x20, 0x00}, //;
+    {0x08, 0x10, 0x20, 0x40, 0x20, 0x10, 0x08, 0x00}, //<
+    {0x00, 0x00, 0x7C, 0x00, 0x7C, 0x00, 0x00, 0x00}, //=
+    {0x20, 0x10, 0x08, 0x04, 0x08, 0x10, 0x20, 0x00}, //>
+    {0x38, 0x44, 0x04, 0x08, 0x10, 0x00, 0x10, 0x00}, //?
+    {0x38, 0x44, 0x04, 0x34, 0x54, 0x54, 0x38, 0x00}, //@
+    {0x38, 0x44, 0x44, 0x44, 0x7C, 0x44, 0x44, 0x00}, //A
+    {0x78, 0x44, 0x44, 0x78, 0x44, 0x44, 0x78, 0x00}, //B
+    {0x38, 0x44, 0x40, 0x40, 0x40, 0x44, 0x38, 0x00}, //C
+    {0x70, 0x48, 0x44, 0x44, 0x44, 0x48, 0x70, 0x00}, //D
+    {0x7C, 0x40, 0x40, 0x78, 0x40, 0x40, 0x7C, 0x00}, //E
+    {0x7C, 0x40, 0x40, 0x78, 0x40, 0x40, 0x40, 0x00}, //F
+    {0x38, 0x44, 0x40, 0x5C, 0x44, 0x44, 0x3C, 0x00}, //G
+    {0x44, 0x44, 0x44, 0x7C, 0x44, 0x44, 0x44, 0x00}, //H
+    {0x38, 0x10, 0x10, 0x10, 0x10, 0x10, 0x38, 0x00}, //I
+    {0x1C, 0x08, 0x08, 0x08, 0x08, 0x48, 0x30, 0x00}, //J
+    {0x44, 0x48, 0x50, 0x60, 0x50, 0x48, 0x44, 0x00}, //K
+    {0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x7C, 0x00}, //L
+    {0x44, 0x6C, 0x54, 0x54, 0x44, 0x44, 0x44, 0x00}, //M
+    {0x44, 0x44, 0x64, 0x54, 0x4C, 0x44, 0x44, 0x00}, //N
+    {0x38, 0x44, 0x44, 0x44, 0x44, 0x44, 0x38, 0x00}, //O
+    {0x78, 0x44, 0x44, 0x78, 0x40, 0x40, 0x40, 0x00}, //P
+    {0x38, 0x44, 0x44, 0x44, 0x54, 0x48, 0x34, 0x00}, //Q
+    {0x78, 0x44, 0x44, 0x78, 0x50, 0x48, 0x44, 0x00}, //R
+    {0x3C, 0x40, 0x40, 0x38, 0x04, 0x04, 0x78, 0x00}, //S
+    {0x7C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00}, //T
+    {0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x38, 0x00}, //U
+    {0x44, 0x44, 0x44, 0x44, 0x44, 0x28, 0x10, 0x00}, //V
+    {0x44, 0x44, 0x44, 0x54, 0x54, 0x54, 0x28, 0x00}, //W
+    {0x44, 0x44, 0x28, 0x10, 0x28, 0x44, 0x44, 0x00}, //X
+    {0x44, 0x44, 0x44, 0x28, 0x10, 0x10, 0x10, 0x00}, //Y
+    {0x7C, 0x04, 0x08, 0x10, 0x20, 0x40, 0x7C, 0x00}, //Z
+    {0x38, 0x20, 0x20, 0x20, 0x20, 0x20, 0x38, 0x00}, //[
+    {0x00, 0x40, 0x20, 0x10, 0x08, 0x04, 0x00, 0x00}, //backslash
+    {0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x38, 0x00}, //]
+    {0x10, 0x28, 0x44, 0x00, 0x00, 0x00, 0x00, 0x00}, //^
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7C}, //_
+    {0x20, 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00}, //`
+    {0x00, 0x00, 0x38, 0x04, 0x3C, 0x44, 0x3C, 0x00}, //a
+    {0x40, 0x40, 0x58, 0x64, 0x44, 0x44, 0x78, 0x00}, //b
+    {0x00, 0x00, 0x38, 0x40, 0x40, 0x44, 0x38, 0x00}, //c
+    {0x04, 0x04, 0x34, 0x4C, 0x44, 0x44, 0x3C, 0x00}, //d
+    {0x00, 0x00, 0x38, 0x44, 0x7C, 0x40, 0x38, 0x00}, //e
+    {0x18, 0x24, 0x20, 0x70, 0x20, 0x20, 0x20, 0x00}, //f
+    {0x00, 0x00, 0x3C, 0x44, 0x44, 0x3C, 0x04, 0x38}, //g
+    {0x40, 0x40, 0x58, 0x64, 0x44, 0x44, 0x44, 0x00}, //h
+    {0x10, 0x00, 0x30, 0x10, 0x10, 0x10, 0x38, 0x00}, //i
+    {0x08, 0x00, 0x18, 0x08, 0x08, 0x08, 0x48, 0x30}, //j
+    {0x40, 0x40, 0x48, 0x50, 0x60, 0x50, 0x48, 0x00}, //k
+    {0x30, 0x10, 0x10, 0x10, 0x10, 0x10, 0x38, 0x00}, //l
+    {0x00, 0x00, 0x68, 0x54, 0x54, 0x44, 0x44, 0x00}, //m
+    {0x00, 0x00, 0x58, 0x64, 0x44, 0x44, 0x44, 0x00}, //n
+    {0x00, 0x00, 0x38, 0x44, 0x44, 0x44, 0x38, 0x00}, //o
+    {0x00, 0x00, 0x78, 0x44, 0x44, 0x78, 0x40, 0x40}, //p
+    {0x00, 0x00, 0x3C, 0x44, 0x44, 0x3C, 0x04, 0x04}, //q
+    {0x00, 0x00, 0x58, 0x64, 0x40, 0x40, 0x40, 0x00}, //r
+    {0x00, 0x00, 0x3C, 0x40, 0x38, 0x04, 0x78, 0x00}, //s
+    {0x20, 0x20, 0x70, 0x20, 0x20, 0x24, 0x18, 0x00}, //t
+    {0x00, 0x00, 0x44, 0x44, 0x44, 0x4C, 0x34, 0x00}, //u
+    {0x00, 0x00, 0x44, 0x44, 0x44, 0x28, 0x10, 0x00}, //v
+    {0x00, 0x00, 0x44, 0x44, 0x54, 0x54, 0x28, 0x00}, //w
+    {0x00, 0x00, 0x44, 0x28, 0x10, 0x28, 0x44, 0x00}, //x
+    {0x00, 0x00, 0x44, 0x44, 0x44, 0x3C, 0x04, 0x38}, //y
+    {0x00, 0x00, 0x7C, 0x08, 0x10, 0x20, 0x7C, 0x00}, //z
+    {0x08, 0x10, 0x10, 0x20, 0x10, 0x10, 0x08, 0x00}, //{
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00}, //|
+    {0x20, 0x10, 0x10, 0x08, 0x10, 0x10, 0x20, 0x00}, //}
+    {0x00, 0x00, 0x20, 0x54, 0x08, 0x00, 0x00, 0x00}, //~
+};
+
+/**
+ * Expands one row of a glyph into its TEXT_GLYPH_WIDTH pixels,
+ * comparing each pixel's bit against a mask and picking either color with it.
+ * @param destination Where the pixels go.
+ * @param bits The row of the glyph.
+ * @param color Color of the set bits.
+ * @param background Color of the clear bits.
+*/
+static void expandGlyphRow(uint32_t *destination, unsigned bits, uint32_t color, uint32_t background) {
+#ifdef SIMD_X86
+    const __m128i left_bits = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+    const __m128i right_bits = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+    __m128i row = _mm_set1_epi32((int)bits);
+    __m128i foreground = _mm_set1_epi32((int)color);
+    __m128i back = _mm_set1_epi32((int)background);
+    __m128i left = _mm_cmpeq_epi32(_mm_and_si128(row, left_bits), left_bits);
+    __m128i right = _mm_cmpeq_epi32(_mm_and_si128(row, right_bits), right_bits);
+    _mm_storeu_si128((__m128i *)destination,
+                     _mm_or_si128(_mm_and_si128(left, foreground), _mm_andnot_si128(left, back)));
+    _mm_storeu_si128((__m128i *)(destination + 4),
+                     _mm_or_si128(_mm_and_si128(right, foreground), _mm_andnot_si128(right, back)));
+#else
+    for (int i = 0; i < TEXT_GLYPH_WIDTH; i++) {
+        destination[i] = bits & (0x80 >> i) ? color : background;
+    }
+#endif
+}
+
+/**
+ * Gets the color of one pixel of a row of text.
+ * @param text The text.
+ * @param glyph_row Row of the glyphs, 0 at the top.
+ * @param pixel Pixel of the row, 0 being the left column of the first character.
+ * @param color Color of the glyphs.
+ * @param background Color of the rest of the cells.
+ * @return The color of the pixel.
+*/
+static uint32_t textPixel(const char *text, int glyph_row, int pixel, uint32_t color, uint32_t background) {
+    unsigned bits = textGlyph(text[pixel/TEXT_GLYPH_WIDTH])[glyph_row];
+    return bits & (0x80 >> (pixel%TEXT_GLYPH_WIDTH)) ? color : background;
+}
+
+/**
+ * Expands part of one row of a line of text into pixels, whole glyphs with
+ * expandGlyphRow and the pixels of glyphs cut off at either end one at a time.
+ * @param destination Where the pixels go.
+ * @param text The text.
+ * @param glyph_row Row of the glyphs, 0 at the top.
+ * @param first First pixel of the row to expand, 0 being the left column of the first character.
+ * @param count Number of pixels to expand, all inside the text.
+ * @param color Color of the glyphs.
+ * @param background Color of the rest of the cells.
+*/
+static void expandRow(uint32_t *destination, const char *text, int glyph_row, int first, int count,
+                      uint32_t color, uint32_t background) {
+    int pixel = first;
+    int end = first + count;
+    while (pixel < end && pixel%TEXT_GLYPH_WIDTH != 0) {
+        *destination++ = textPixel(text, glyph_row, pixel++, color, background);
+    }
+    for (; pixel + TEXT_GLYPH_WIDTH <= end; pixel += TEXT_GLYPH_WIDTH) {
+        expandGlyphRow(destination, textGlyph(text[pixel/TEXT_GLYPH_WIDTH])[glyph_row], color, background);
+        destination += TEXT_GLYPH_WIDTH;
+    }
+    while (pixel < end) {
+        *destination++ = textPixel(text, glyph_row, pixel++, color, background);
+    }
+}
+
+/**
+ * Cuts the rectangle a line of text covers down to the clip rectangle.
+ * @param x x coordinate of the left column of the text
+ * @param y y coordinate of the bottom row of the text
+ * @param width Width of the text, in pixels.
+ * @return The visible part of the text, empty (min >= max) if none of it is.
+*/
+static struct FrameRect clipText(int x, int y, int width) {
+    struct FrameRect clip = frameClip();
+    int64_t x_max = (int64_t)x + width;
+    int64_t y_max = (int64_t)y + TEXT_GLYPH_HEIGHT;
+    struct FrameRect rect = {
+        x > clip.x_min ? x : clip.x_min,
+        y > clip.y_min ? y : clip.y_min,
+        x_max < clip.x_max ? (int)x_max : clip.x_max,
+        y_max < clip.y_max ? (int)y_max : clip.y_max
+    };
+    return rect;
+}
+
+const uint8_t *textGlyph(char character) {
+    unsigned char code = (unsigned char)character;
+    if (code < TEXT_FIRST_CHARACTER || code > TEXT_LAST_CHARACTER) {
+        code = '?';
+    }
+    return font[code - TEXT_FIRST_CHARACTER];
+}
+
+int textWidth(const char *text) {
+    return (int)strlen(text)*TEXT_GLYPH_WIDTH;
+}
+
+void textDraw(int x, int y, const char *text, uint32_t color, uint32_t background) {
+    struct FrameRect rect = clipText(x, y, textWidth(text));
+    for (int row_y = rect.y_min; row_y < rect.y_max; row_y++) {
+        int glyph_row = TEXT_GLYPH_HEIGHT - 1 - (row_y - y);
+        if (frame.layout == FRAME_LAYOUT_ROWS) {
+            expandRow(frame.pixels + frameOffset(rect.x_min, row_y), text, glyph_row,
+                      rect.x_min - x, rect.x_max - rect.x_min, color, background);
+            continue;
+        }
+        //Rows of a tiled frame are split across tiles, so expand a piece of the row and copy that in
+        uint32_t chunk[TEXT_CHUNK_PIXELS];
+        for (int start = rect.x_min; start < rect.x_max; start += TEXT_CHUNK_PIXELS) {
+            int count = rect.x_max - start < TEXT_CHUNK_PIXELS ? rect.x_max - start : TEXT_CHUNK_PIXELS;
+            expandRow(chunk, text, glyph_row, start - x, count, color, background);
+            struct FrameRect piece = {start, row_y, start + count, row_y + 1};
+            frameWritePixels(&piece, chunk, count);
+        }
+    }
+}
+
+void textRunInit(struct TextRun *run) {
+    run->text = NULL;
+    run->text_capacity = 0;
+    run->color = 0;
+    run->background = 0;
+    run->pixels = NULL;
+    run->pixel_capacity = 0;
+    run->width = 0;
+}
+
+void textRunFree(struct TextRun *run) {
+    free(run->text);
+    free(run->pixels);
+    textRunInit(run);
+}
+
+void textRunDraw(struct TextRun *run, int x, int y, const char *text, uint32_t color, uint32_t background) {
+    if (!run->text || strcmp(run->text, text) != 0 || color != run->color || background != run->background) {
+        size_t length = strlen(text);
+        size_t pixel_count = length*TEXT_GLYPH_WIDTH*TEXT_GLYPH_HEIGHT;
+        if (length + 1 > run->text_capacity) {
+            free(run->text);
+            run->text = malloc(length + 1);
+            run->text_capacity = length + 1;
+        }
+        if (pixel_count > run->pixel_capacity) {
+            free(run->pixels);
+            run->pixels = malloc(pixel_count*sizeof(uint32_t));
+            run->pixel_capacity = pixel_count;
+        }
+        //An empty line has no pixels, so its NULL pixels aren't a failed allocation
+        if (!run->text || (pixel_count > 0 && !run->pixels)) {
+            printf("Drawing the text failed.\n");
+            exit(1);
+        }
+        memcpy(run->text, text, length + 1);
+        run->color = color;
+        run->background = background;
+        run->width = textWidth(text);
+        //Bottom row first, the way frameWritePixels takes them
+        for (int row = 0; row < TEXT_GLYPH_HEIGHT && length > 0; row++) {
+            expandRow(run->pixels + (size_t)row*run->width, text, TEXT_GLYPH_HEIGHT - 1 - row,
+                      0, run->width, color, background);
+        }
+    }
+
+    struct FrameRect rect = clipText(x, y, run->width);
+    if (run->width > 0 && rect.x_min < rect.x_max && rect.y_min < rect.y_max) {
+        frameWritePixels(&rect, run->pixels + (rect.x_min - x) + (size_t)(rect.y_min - y)*run->width, run->width);
+    }
+}
@@ -0,0 +1,92 @@
+/**
+ * Text drawn with a bitmap font compiled into the program, for on-frame counters
+ * like the frame rate. Each glyph is TEXT_GLYPH_HEIGHT rows of one byte, one bit per pixel,
+ * and a row of a glyph is expanded into TEXT_GLYPH_WIDTH pixels with vector compares
+ * and selects. Text is drawn opaque, glyph pixels in one color and the rest of each
+ * glyph's cell in another, so a line of text is a solid rectangle which can be kept
+ * in a TextRun and copied into the frame row by row while it doesn't change.
+ * Like the primitives, drawing is clipped to the clip rectangle of the calling thread
+ * and doesn't mark the frame dirty.
+ * @file text.h
+ * @author ABM
+*/
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Width of a glyph's cell and how far each character moves the next one along, in pixels. */
+#define TEXT_GLYPH_WIDTH 8
+
+/** Height of a glyph's cell, in pixels. Seven rows above the baseline and one for descenders. */
+#define TEXT_GLYPH_HEIGHT 8
+
+/**
+ * A line of text kept already drawn, so drawing it again while it stays
+ * the same only copies its pixels into the frame.
+*/
+struct TextRun {
+    //The text and colors the pixels were drawn for
+    char *text;
+    size_t text_capacity;
+    uint32_t color;
+    uint32_t background;
+    //The drawn text, row by row from the bottom, width is TEXT_GLYPH_WIDTH per character
+    uint32_t *pixels;
+    size_t pixel_capacity;
+    int width;
+};
+
+/**
+ * Gets the glyph of a character.
+ * @param character The character.
+ * @return Its TEXT_GLYPH_HEIGHT rows, top row first with the leftmost pixel in the top bit,
+ *         the glyph of '?' for characters outside of printable ASCII.
+*/
+const uint8_t *textGlyph(char character);
+
+/**
+ * Gets the width a line of text takes up.
+ * @param text The text.
+ * @return Its width, in pixels.
+*/
+int textWidth(const char *text);
+
+/**
+ * Draws a line of text. Characters outside of printable ASCII are drawn as '?'.
+ * @param x x coordinate of the left column of the text
+ * @param y y coordinate of the bottom row of the text, the row of the descenders
+ * @param text The text.
+ * @param color Color of the glyphs.
+ * @param background Color of the rest of each character's cell.
+*/
+void textDraw(int x, int y, const char *text, uint32_t color, uint32_t background);
+
+/**
+ * Sets up an empty text run.
+ * @param run The run to set up.
+*/
+void textRunInit(struct TextRun *run);
+
+/**
+ * Releases the memory of a text run.
+ * @param run The run to release.
+*/
+void textRunFree(struct TextRun *run);
+
+/**
+ * Draws a line of text like textDraw, through a text run: the glyphs are only
+ * expanded when the text or colors differ from the last time the run was drawn,
+ * otherwise the kept pixels are copied into the frame one memcpy per row.
+ * Running out of memory for the pixels is fatal, like in the rest of the program.
+ * @param run The run.
+ * @param x x coordinate of the left column of the text
+ * @param y y coordinate of the bottom row of the text
+ * @param text The text.
+ * @param color Color of the glyphs.
+ * @param background Color of the rest of each character's cell.
+*/
+void textRunDraw(struct TextRun *run, int x, int y, const char *text, uint32_t color, uint32_t background);
+
+#endif
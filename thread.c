@@ -0,0 +1,147 @@
+/**
+ * Thin wrapper over Win32 threads and pthreads.
+ * @file thread.c
+ * @author ABM
+*/
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+#include "thread.h"
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+/**
+ * Entry point handed to CreateThread, calls the function of the thread.
+ * @param argument The thread.
+ * @return Always 0.
+*/
+static DWORD WINAPI threadEntry(LPVOID argument) {
+    struct Thread *thread = argument;
+    thread->function(thread->argument);
+    return 0;
+}
+
+bool threadStart(struct Thread *thread, void (*function)(void *argument), void *argument) {
+    thread->function = function;
+    thread->argument = argument;
+    thread->handle = CreateThread(NULL, 0, threadEntry, thread, 0, NULL);
+    return thread->handle != NULL;
+}
+
+void threadJoin(struct Thread *thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+int threadCpuCount(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+void mutexInit(struct Mutex *mutex) {
+    InitializeSRWLock(&mutex->lock);
+}
+
+void mutexDestroy(struct Mutex *mutex) {
+    //SRW locks don't hold any resources
+    (void)mutex;
+}
+
+void mutexLock(struct Mutex *mutex) {
+    AcquireSRWLockExclusive(&mutex->lock);
+}
+
+void mutexUnlock(struct Mutex *mutex) {
+    ReleaseSRWLockExclusive(&mutex->lock);
+}
+
+void conditionInit(struct Condition *condition) {
+    InitializeConditionVariable(&condition->condition);
+}
+
+void conditionDestroy(struct Condition *condition) {
+    //Condition variables don't hold any resources
+    (void)condition;
+}
+
+void conditionWait(struct Condition *condition, struct Mutex *mutex) {
+    SleepConditionVariableSRW(&condition->condition, &mutex->lock, INFINITE, 0);
+}
+
+void conditionSignal(struct Condition *condition) {
+    WakeConditionVariable(&condition->condition);
+}
+
+void conditionBroadcast(struct Condition *condition) {
+    WakeAllConditionVariable(&condition->condition);
+}
+
+#else
+
+/**
+ * Entry point handed to pthread_create, calls the function of the thread.
+ * @param argument The thread.
+ * @return Always NULL.
+*/
+static void *threadEntry(void *argument) {
+    struct Thread *thread = argument;
+    thread->function(thread->argument);
+    return NULL;
+}
+
+bool threadStart(struct Thread *thread, void (*function)(void *argument), void *argument) {
+    thread->function = function;
+    thread->argument = argument;
+    return pthread_create(&thread->handle, NULL, threadEntry, thread) == 0;
+}
+
+void threadJoin(struct Thread *thread) {
+    pthread_join(thread->handle, NULL);
+}
+
+int threadCpuCount(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+void mutexInit(struct Mutex *mutex) {
+    pthread_mutex_init(&mutex->lock, NULL);
+}
+
+void mutexDestroy(struct Mutex *mutex) {
+    pthread_mutex_destroy(&mutex->lock);
+}
+
+void mutexLock(struct Mutex *mutex) {
+    pthread_mutex_lock(&mutex->lock);
+}
+
+void mutexUnlock(struct Mutex *mutex) {
+    pthread_mutex_unlock(&mutex->lock);
+}
+
+void conditionInit(struct Condition *condition) {
+    pthread_cond_init(&condition->condition, NULL);
+}
+
+void conditionDestroy(struct Condition *condition) {
+    pthread_cond_destroy(&condition->condition);
+}
+
+void conditionWait(struct Condition *condition, struct Mutex *mutex) {
+    pthread_cond_wait(&condition->condition, &mutex->lock);
+}
+
+void conditionSignal(struct Condition *condition) {
+    pthread_cond_signal(&condition->condition);
+}
+
+void conditionBroadcast(struct Condition *condition) {
+    pthread_cond_broadcast(&condition->condition);
+}
+
+#endif
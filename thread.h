@@ -0,0 +1,131 @@
+/**
+ * Thin wrapper over Win32 threads and pthreads, so the renderer
+ * can run its workers on both backends.
+ * @file thread.h
+ * @author ABM
+*/
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+//Storage class for variables which have one copy per thread
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+/** A thread running a function. */
+struct Thread {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    void (*function)(void *argument);
+    void *argument;
+};
+
+/** A mutual exclusion lock. */
+struct Mutex {
+#ifdef _WIN32
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+/** A condition variable, always used together with a Mutex. */
+struct Condition {
+#ifdef _WIN32
+    CONDITION_VARIABLE condition;
+#else
+    pthread_cond_t condition;
+#endif
+};
+
+/**
+ * Starts a thread.
+ * @param thread The thread to start, must stay valid until it is joined.
+ * @param function The function the thread runs.
+ * @param argument Pointer passed to the function.
+ * @return false if the thread could not be started.
+*/
+bool threadStart(struct Thread *thread, void (*function)(void *argument), void *argument);
+
+/**
+ * Waits for a thread to return from its function.
+ * @param thread The thread to wait for.
+*/
+void threadJoin(struct Thread *thread);
+
+/**
+ * Gets the number of logical CPUs.
+ * @return The number of logical CPUs, at least 1.
+*/
+int threadCpuCount(void);
+
+/**
+ * Sets up a mutex.
+ * @param mutex The mutex to set up.
+*/
+void mutexInit(struct Mutex *mutex);
+
+/**
+ * Releases a mutex which is no longer needed.
+ * @param mutex The mutex to release.
+*/
+void mutexDestroy(struct Mutex *mutex);
+
+/**
+ * Locks a mutex, waiting until no other thread holds it.
+ * @param mutex The mutex to lock.
+*/
+void mutexLock(struct Mutex *mutex);
+
+/**
+ * Unlocks a mutex held by this thread.
+ * @param mutex The mutex to unlock.
+*/
+void mutexUnlock(struct Mutex *mutex);
+
+/**
+ * Sets up a condition variable.
+ * @param condition The condition variable to set up.
+*/
+void conditionInit(struct Condition *condition);
+
+/**
+ * Releases a condition variable which is no longer needed.
+ * @param condition The condition variable to release.
+*/
+void conditionDestroy(struct Condition *condition);
+
+/**
+ * Unlocks the mutex, waits for the condition to be signalled and locks the mutex again.
+ * Can wake up without being signalled, so always wait in a loop checking the condition.
+ * @param condition The condition variable to wait on.
+ * @param mutex The mutex held by this thread.
+*/
+void conditionWait(struct Condition *condition, struct Mutex *mutex);
+
+/**
+ * Wakes up one thread waiting on the condition variable.
+ * @param condition The condition variable.
+*/
+void conditionSignal(struct Condition *condition);
+
+/**
+ * Wakes up every thread waiting on the condition variable.
+ * @param condition The condition variable.
+*/
+void conditionBroadcast(struct Condition *condition);
+
+#endif
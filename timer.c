@@ -0,0 +1,49 @@
+/**
+ * High resolution monotonic clock.
+ * @file timer.c
+ * @author ABM
+*/
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+#include "timer.h"
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+uint64_t timerNow(void) {
+#ifdef _WIN32
+    //The frequency is fixed at boot, so only ask for it once
+    static LARGE_INTEGER frequency = {0};
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    //Split the conversion so the multiplication can't overflow
+    uint64_t seconds = counter.QuadPart/frequency.QuadPart;
+    uint64_t remainder = counter.QuadPart%frequency.QuadPart;
+    return seconds*1000000000ull + remainder*1000000000ull/frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec*1000000000ull + (uint64_t)now.tv_nsec;
+#endif
+}
+
+double timerSeconds(uint64_t start, uint64_t end) {
+    return (end - start)*1e-9;
+}
+
+void timerSleep(uint64_t nanoseconds) {
+#ifdef _WIN32
+    //Sleep(0) still gives up the rest of the time slice
+    Sleep((DWORD)(nanoseconds/1000000));
+#else
+    struct timespec duration;
+    duration.tv_sec = (time_t)(nanoseconds/1000000000ull);
+    duration.tv_nsec = (long)(nanoseconds%1000000000ull);
+    nanosleep(&duration, NULL);
+#endif
+}
@@ -0,0 +1,32 @@
+/**
+ * High resolution monotonic clock.
+ * @file timer.h
+ * @author ABM
+*/
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+/**
+ * Reads a monotonic clock which is not affected by changes to the system time.
+ * @return The current time in nanoseconds, from an arbitrary starting point.
+*/
+uint64_t timerNow(void);
+
+/**
+ * Converts a difference of two timerNow readings to seconds.
+ * @param start The earlier reading.
+ * @param end The later reading.
+ * @return The time from start to end, in seconds.
+*/
+double timerSeconds(uint64_t start, uint64_t end);
+
+/**
+ * Puts the calling thread to sleep. The OS may wake it up late, by up to a
+ * scheduler tick, so callers needing an exact time sleep short and spin the rest.
+ * @param nanoseconds How long to sleep for at least, rounded down to whole milliseconds on Win32.
+*/
+void timerSleep(uint64_t nanoseconds);
+
+#endif
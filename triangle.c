@@ -0,0 +1,193 @@
+/**
+ * Filled triangle rasterizer using edge functions over 8x8 tiles.
+ * Each edge function is positive on the inside of its edge and changes by a
+ * constant amount per pixel, so it is evaluated once per tile corner or row
+ * and then stepped with additions.
+ * Whole tiles are rejected when they are outside of any edge, and filled
+ * without per pixel tests when they are inside of all three.
+ * @file triangle.c
+ * @author ABM
+*/
+#include "triangle.h"
+#include "framebuffer.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+//rasterizeTile writes a row of a triangle tile as one run, which in a tiled frame needs it to fit a frame tile
+#if TRIANGLE_TILE_SIZE > FRAME_TILE_SIZE || FRAME_TILE_SIZE % TRIANGLE_TILE_SIZE != 0
+#error "Triangle tiles have to divide the frame's tiles"
+#endif
+
+/**
+ * Edge function of one edge of the triangle,
+ * value = origin + step_x*x + step_y*y, which is >= 0 for pixels on the inside.
+*/
+struct Edge {
+    //Change of the edge function for one pixel to the right
+    int64_t step_x;
+    //Change of the edge function for one pixel up
+    int64_t step_y;
+    //Value of the edge function at 0, 0, including the fill rule bias
+    int64_t origin;
+};
+
+/**
+ * Sets up the edge function of the edge from a to b of a counter-clockwise triangle.
+ * @param edge The edge function to set up.
+ * @param ax x coordinate of the start of the edge
+ * @param ay y coordinate of the start of the edge
+ * @param bx x coordinate of the end of the edge
+ * @param by y coordinate of the end of the edge
+*/
+static void edgeSetup(struct Edge *edge, int ax, int ay, int bx, int by) {
+    int64_t dx = (int64_t)bx - ax;
+    int64_t dy = (int64_t)by - ay;
+    //(b - a) cross (p - a) = dx*(py - ay) - dy*(px - ax)
+    edge->step_x = -dy;
+    edge->step_y = dx;
+    edge->origin = dy*ax - dx*ay;
+
+    //Top-left rule: pixels exactly on an edge only belong to the triangle if it is
+    //a left edge (going down, when counter-clockwise) or a top edge (horizontal, going left).
+    //Other edges are made exclusive by moving them in by one.
+    bool top_left = dy < 0 || (dy == 0 && dx < 0);
+    if (!top_left) {
+        edge->origin -= 1;
+    }
+}
+
+/**
+ * Evaluates an edge function at a pixel.
+ * @param edge The edge function.
+ * @param x x coordinate of the pixel
+ * @param y y coordinate of the pixel
+ * @return The value of the edge function, >= 0 if the pixel is inside of the edge.
+*/
+static int64_t edgeAt(const struct Edge *edge, int x, int y) {
+    return edge->origin + edge->step_x*x + edge->step_y*y;
+}
+
+/**
+ * Rasterizes the part of a triangle inside one tile.
+ * @param edges The three edge functions of the triangle.
+ * @param x_start x coordinate of the left column of the tile
+ * @param y_start y coordinate of the bottom row of the tile
+ * @param x_end x coordinate of the right column of the tile
+ * @param y_end y coordinate of the top row of the tile
+ * @param color color of the triangle
+*/
+static void rasterizeTile(const struct Edge edges[3], int x_start, int y_start, int x_end, int y_end, uint32_t color) {
+    //Edge functions are linear, so their extremes over the tile are at its corners.
+    //Pick the corner with the smallest and the largest value for each edge.
+    bool inside_all = true;
+    for (int i = 0; i < 3; i++) {
+        int min_x = edges[i].step_x >= 0 ? x_start : x_end;
+        int min_y = edges[i].step_y >= 0 ? y_start : y_end;
+        int max_x = edges[i].step_x >= 0 ? x_end : x_start;
+        int max_y = edges[i].step_y >= 0 ? y_end : y_start;
+        if (edgeAt(&edges[i], max_x, max_y) < 0) {
+            //The whole tile is outside of this edge
+            return;
+        }
+        if (edgeAt(&edges[i], min_x, min_y) < 0) {
+            inside_all = false;
+        }
+    }
+
+    //Triangle tiles are no bigger than the frame's tiles and start at multiples of their size,
+    //so in a tiled frame each row of a triangle tile is a run of one frame tile too
+    int width = x_end - x_start + 1;
+    uint32_t *row = frame.pixels + frameOffset(x_start, y_start);
+    ptrdiff_t row_stride = frame.layout == FRAME_LAYOUT_TILES ? FRAME_TILE_SIZE : frame.stride;
+
+    if (inside_all) {
+        for (int y = y_start; y <= y_end; y++, row += row_stride) {
+            for (int x = 0; x < width; x++) {
+                row[x] = color;
+            }
+        }
+        return;
+    }
+
+    int64_t w0_row = edgeAt(&edges[0], x_start, y_start);
+    int64_t w1_row = edgeAt(&edges[1], x_start, y_start);
+    int64_t w2_row = edgeAt(&edges[2], x_start, y_start);
+    for (int y = y_start; y <= y_end; y++, row += row_stride) {
+        int64_t w0 = w0_row;
+        int64_t w1 = w1_row;
+        int64_t w2 = w2_row;
+        for (int x = 0; x < width; x++) {
+            //Inside if no edge function is negative, i.e. no sign bit is set
+            if ((w0 | w1 | w2) >= 0) {
+                row[x] = color;
+            }
+            w0 += edges[0].step_x;
+            w1 += edges[1].step_x;
+            w2 += edges[2].step_x;
+        }
+        w0_row += edges[0].step_y;
+        w1_row += edges[1].step_y;
+        w2_row += edges[2].step_y;
+    }
+}
+
+void triangleFilled(int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color) {
+    struct FrameRect clip = frameClip();
+    if (clip.x_min >= clip.x_max || clip.y_min >= clip.y_max) {
+        return;
+    }
+
+    //Twice the signed area, positive if the vertices are counter-clockwise
+    int64_t area = ((int64_t)x1 - x0)*((int64_t)y2 - y0) - ((int64_t)y1 - y0)*((int64_t)x2 - x0);
+    if (area == 0) {
+        return;
+    }
+    if (area < 0) {
+        int swap = x1;
+        x1 = x2;
+        x2 = swap;
+        swap = y1;
+        y1 = y2;
+        y2 = swap;
+    }
+
+    struct Edge edges[3];
+    edgeSetup(&edges[0], x0, y0, x1, y1);
+    edgeSetup(&edges[1], x1, y1, x2, y2);
+    edgeSetup(&edges[2], x2, y2, x0, y0);
+
+    //Bounding box of the triangle, clipped to the clip rectangle
+    int min_x = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+    int min_y = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+    int max_x = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+    int max_y = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+    if (min_x < clip.x_min) {
+        min_x = clip.x_min;
+    }
+    if (min_y < clip.y_min) {
+        min_y = clip.y_min;
+    }
+    if (max_x >= clip.x_max) {
+        max_x = clip.x_max - 1;
+    }
+    if (max_y >= clip.y_max) {
+        max_y = clip.y_max - 1;
+    }
+    if (min_x > max_x || min_y > max_y) {
+        return;
+    }
+
+    //Tiles are aligned to the frame, not to the triangle,
+    //so the ones on the border of the bounding box are cut down to it
+    int first_tile_x = min_x - min_x%TRIANGLE_TILE_SIZE;
+    int first_tile_y = min_y - min_y%TRIANGLE_TILE_SIZE;
+    for (int tile_y = first_tile_y; tile_y <= max_y; tile_y += TRIANGLE_TILE_SIZE) {
+        int y_start = tile_y > min_y ? tile_y : min_y;
+        int y_end = tile_y + TRIANGLE_TILE_SIZE - 1 < max_y ? tile_y + TRIANGLE_TILE_SIZE - 1 : max_y;
+        for (int tile_x = first_tile_x; tile_x <= max_x; tile_x += TRIANGLE_TILE_SIZE) {
+            int x_start = tile_x > min_x ? tile_x : min_x;
+            int x_end = tile_x + TRIANGLE_TILE_SIZE - 1 < max_x ? tile_x + TRIANGLE_TILE_SIZE - 1 : max_x;
+            rasterizeTile(edges, x_start, y_start, x_end, y_end, color);
+        }
+    }
+}
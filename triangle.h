@@ -0,0 +1,30 @@
+/**
+ * Filled triangle rasterizer using edge functions over 8x8 tiles.
+ * @file triangle.h
+ * @author ABM
+*/
+#ifndef TRIANGLE_H
+#define TRIANGLE_H
+
+#include <stdint.h>
+
+/** Width and height of the tiles the bounding box of a triangle is split into, in pixels. */
+#define TRIANGLE_TILE_SIZE 8
+
+/**
+ * Draws a solid triangle with arbitrary vertices, in either winding order.
+ * A pixel is drawn if its coordinates are inside the triangle. Pixels exactly
+ * on an edge follow the top-left rule, so two triangles sharing an edge
+ * never both draw (or both skip) the pixels along it.
+ * Degenerate triangles, with all three vertices on a line, draw nothing.
+ * @param x0 x coordinate of the first vertex
+ * @param y0 y coordinate of the first vertex
+ * @param x1 x coordinate of the second vertex
+ * @param y1 y coordinate of the second vertex
+ * @param x2 x coordinate of the third vertex
+ * @param y2 y coordinate of the third vertex
+ * @param color color of the triangle
+*/
+void triangleFilled(int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color);
+
+#endif
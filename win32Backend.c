@@ -0,0 +1,403 @@
+/**
+ * Win32/GDI backend which opens a window and shows the frame in it.
+ * Made with help from https://www.youtube.com/watch?v=q1fMa8Hufmg
+ * @file win32Backend.c
+ * @author ABM
+*/
+#define UNICODE
+#define _UNICODE
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <wchar.h>
+#include "framebuffer.h"
+#include "pixelDrawer.h"
+#include "commandList.h"
+#include "renderer.h"
+#include "fill.h"
+#include "profiler.h"
+#include "timer.h"
+#include "pacer.h"
+#include "swapChain.h"
+#include "capture.h"
+#include "blend.h"
+#include "scene.h"
+
+/** Number of threads to rasterize with, 0 for one per logical CPU. */
+#define RENDER_THREADS 0
+
+/** Frames per second to draw at, 0 to draw as fast as possible (one animation step per frame). */
+#define TARGET_FPS 60
+
+/** Number of frames queued for the present thread at most, 2 for double and 3 for triple buffering. */
+#define PRESENT_BUFFERS 3
+
+/** Set to 1 to draw the frame time graph over the bottom left of the window. */
+#define SHOW_PROFILE_OVERLAY 0
+
+/** File to record the frames to (.y4m, .png or raw BGRA, see capture.h), NULL to not record. */
+#define CAPTURE_PATH NULL
+
+/**
+ * Set to 1 to draw circles and lines anti-aliased, 0 for hard edges.
+ * The budget for leaving it on is the whole frame costing under 2x the aliased one, which the busy frame
+ * of --bench antialias meets at about 1.25x. Single outlines and lines alone come out just under 2x.
+*/
+#define ANTIALIAS 1
+
+/** Scene file to draw instead of the animation (text or binary, see scene.h), NULL for the animation. */
+#define SCENE_PATH NULL
+
+/** How often the frame statistics in the title bar are refreshed, in nanoseconds. */
+#define TITLE_INTERVAL_NS 1000000000ull
+
+//Used to exit main program loop.
+static bool running = true;
+
+//Tells GDI about the pixel format
+static BITMAPINFO frame_bitmap_info;
+
+/**
+ * Fills out the bitmap info telling GDI about the pixel format and size of a pixel array.
+ * @param bitmap_info The bitmap info to fill out.
+ * @param width Width of the pixel array, including the row padding.
+ * @param height Height of the pixel array.
+*/
+static void setBitmapInfo(BITMAPINFO *bitmap_info, int width, int height) {
+    bitmap_info->bmiHeader.biSize = sizeof(bitmap_info->bmiHeader);
+    bitmap_info->bmiHeader.biWidth = width;
+    //Positive height as the pixel array is bottom-up
+    bitmap_info->bmiHeader.biHeight = height;
+    //Number of color planes is always 1.
+    bitmap_info->bmiHeader.biPlanes = 1;
+    //Bits per pixel
+    //8 bits per byte, a byte for each of red, green, blue, and a filler byte.
+    bitmap_info->bmiHeader.biBitCount = 32;
+    //Compression type is uncompressed RGB.
+    bitmap_info->bmiHeader.biCompression = BI_RGB;
+}
+
+/**
+ * Copies a rectangle of a pixel array to the window.
+ * @param device_context The window device context.
+ * @param bitmap_info Size and format of the pixel array.
+ * @param pixels The pixel array, laid out like the frame.
+ * @param x_min x coordinate of the left column of the rectangle
+ * @param y_min y coordinate of the bottom row of the rectangle
+ * @param x_max x coordinate one past the right column of the rectangle
+ * @param y_max y coordinate one past the top row of the rectangle
+*/
+static void copyToWindow(HDC device_context, const BITMAPINFO *bitmap_info, const uint32_t *pixels,
+                         int x_min, int y_min, int x_max, int y_max) {
+    int height = bitmap_info->bmiHeader.biHeight;
+    //SetDIBitsToDevice will copy the pixel array data over to the window in the specified rectangle
+    //It is given the window device context,
+    //and the left, top, width and height of the area which is to be (re)painted.
+    //The window is top-down while the pixel array is bottom-up,
+    //so the top of the rectangle in the window is height - y_max
+    //and the source y coordinate is measured from the bottom of the array.
+    SetDIBitsToDevice(device_context,
+                      x_min,
+                      height - y_max,
+                      x_max - x_min,
+                      y_max - y_min,
+                      x_min,
+                      y_min,
+                      0,
+                      height,
+                      pixels,
+                      bitmap_info,
+                      DIB_RGB_COLORS);
+}
+
+/**
+ * Window procedure that handles messages sent to the window.
+ * @param window_handle Handle to the window.
+ * @param msg The message.
+ * @param wParam Additional message information.
+ * @param lParam Additional message information.
+ * @return The result of the message processing and depends on the message sent.
+*/
+LRESULT CALLBACK WindowProcessMessage(HWND window_handle, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+        case WM_QUIT:
+        case WM_DESTROY: {
+            running = false;
+        } break;
+
+        //All window drawing has to happen inside the WM_PAINT message.
+        case WM_PAINT: {
+            static PAINTSTRUCT paint;
+            static HDC device_context;
+            //In order to enable window drawing, BeginPaint must be called.
+            //It fills out the PAINTSTRUCT and gives a device context handle for painting
+            device_context = BeginPaint(window_handle, &paint);
+            //Finished frames are copied by the present thread, this only repaints
+            //what Windows asks for (say the window was uncovered) from the frame.
+            //The paint structure rectangle is painted
+            //so as to only paint the area that needs to be painted.
+            if (frame.pixels) {
+                copyToWindow(device_context, &frame_bitmap_info, frame.pixels,
+                             paint.rcPaint.left,
+                             frame.height - paint.rcPaint.bottom,
+                             paint.rcPaint.right,
+                             frame.height - paint.rcPaint.top);
+            }
+            //If end paint is not called, everything seems to work,
+            //but the documentation says that it is necessary.
+            EndPaint(window_handle, &paint);
+        } break;
+
+        //WM_SIZE is sent when the window is created or resized.
+        //This makes it an ideal place to assign the size of the pixel array
+        //and finish setting up the bitmap info.
+        case WM_SIZE: {
+            //Resize the pixel array to the new width and height of the window.
+            if (!frameResize(LOWORD(lParam), HIWORD(lParam))) {
+                printf("frameResize failed.\n");
+                exit(1);
+            }
+            //Tell GDI about the new size of the pixel array.
+            //GDI has no separate stride, so the bitmap is as wide as the padded rows
+            //and only the columns inside the window are ever copied.
+            setBitmapInfo(&frame_bitmap_info, frame.stride, frame.height);
+        } break;
+
+
+        default: {
+            //If the message is not handled by this procedure,
+            //pass it to the default window procedure.
+            return DefWindowProc(window_handle, msg, wParam, lParam);
+        } break;
+    }
+    return 0;
+}
+
+/**
+ * Swap chain sink which copies the dirty rectangles of a finished frame to the window.
+ * Runs on the present thread, so it gets its own device context and bitmap info
+ * rather than sharing those of the window procedure.
+ * @param buffer The frame to show.
+ * @param user_data Handle to the window.
+*/
+static void presentToWindow(const struct SwapBuffer *buffer, void *user_data) {
+    HWND window_handle = user_data;
+    //Fails once the window is destroyed while frames are still queued
+    HDC device_context = GetDC(window_handle);
+    if (!device_context) {
+        return;
+    }
+    BITMAPINFO bitmap_info = {0};
+    setBitmapInfo(&bitmap_info, buffer->stride, buffer->height);
+    for (int i = 0; i < buffer->rect_count; i++) {
+        const struct FrameRect *rect = &buffer->rects[i];
+        copyToWindow(device_context, &bitmap_info, buffer->pixels, rect->x_min, rect->y_min, rect->x_max, rect->y_max);
+    }
+    ReleaseDC(window_handle, device_context);
+}
+
+/**
+ * Starting point for the program.
+ * @param hInstance Handle to the current instance of the program.
+ * @param hPrevInstance Handle to the previous instance of the program.
+ * @param pCmdLine Pointer to a null-terminated string specifying the command
+ *                line arguments for the application, excluding the program name.
+ * @param nCmdShow Specifies how the window is to be shown.
+ * @return 0 if the program terminates successfully, non-zero otherwise.
+*/
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine, int nCmdShow) {
+    // Create the window class to hold information about the window.
+    static WNDCLASS window_class = {0};
+    //L = wide character string literal
+    //This name is used to reference the window class later.
+    static const wchar_t window_class_name[] = L"PixelDrawer";
+    //Set up the window class name.
+    window_class.lpszClassName = window_class_name;
+    //Set up a pointer to a function that windows will call to handle events, or messages.
+    window_class.lpfnWndProc = WindowProcessMessage;
+    window_class.hInstance = hInstance;
+
+    //Pick the fastest fill and blend kernels for this CPU
+    fillInit();
+    blendInit();
+
+    //Register the window class with windows.
+    if (!RegisterClass(&window_class)) {
+        printf("RegisterClass failed.\n");
+        exit(1);
+    }
+
+    //Create the window.
+    HWND window_handle = CreateWindow(window_class_name, //Name of the window class.
+                                      L"Pixel Drawer", //Title of the window.
+                                      WS_OVERLAPPEDWINDOW, //Window style.
+                                      CW_USEDEFAULT, //Initial horizontal position of the window.
+                                      CW_USEDEFAULT, //Initial vertical position of the window.
+                                      CW_USEDEFAULT, //Initial width of the window.
+                                      CW_USEDEFAULT, //Initial height of the window.
+                                      NULL, //Handle to the parent window.
+                                      NULL, //Handle to the menu.
+                                      hInstance, //Handle to the instance of the program.
+                                      NULL); //Pointer to the window creation data.
+    //Handle any errors.
+    if (!window_handle) {
+        printf("CreateWindow failed.\n");
+        exit(1);
+    }
+
+    //Actually show the window.
+    ShowWindow(window_handle, nCmdShow);
+
+    //Show every finished frame in the window from the present thread,
+    //while the next frame is drawn.
+    struct SwapChain *swap_chain = swapChainCreate(PRESENT_BUFFERS, presentToWindow, window_handle);
+    if (!swap_chain) {
+        printf("swapChainCreate failed.\n");
+        exit(1);
+    }
+    frameSetPresentHook(swapChainPresent, swap_chain);
+
+    //Rasterizes each frame across RENDER_THREADS threads.
+    struct Renderer *renderer = rendererCreate(RENDER_THREADS);
+    if (!renderer) {
+        printf("rendererCreate failed.\n");
+        exit(1);
+    }
+
+    //Everything which changes from one frame to the next.
+    struct Animation animation;
+    animationInit(&animation);
+
+    //A scene file takes the place of the animation, and stays the same every frame
+    struct Scene scene;
+    if (SCENE_PATH && !sceneLoad(&scene, SCENE_PATH)) {
+        printf("sceneLoad failed.\n");
+        exit(1);
+    }
+
+    //The draw calls of the current frame
+    struct CommandList commands;
+    commandListInit(&commands);
+    commandListSetAntialias(&commands, ANTIALIAS);
+
+    //Records the frames on a background thread, dropping those it can't keep up with
+    //rather than slowing the window down
+    struct Capture *capture = NULL;
+    if (CAPTURE_PATH) {
+        capture = captureCreate(CAPTURE_PATH, captureFormatFromPath(CAPTURE_PATH), CAPTURE_DROP, TARGET_FPS);
+        if (!capture) {
+            printf("captureCreate failed.\n");
+            exit(1);
+        }
+    }
+
+    //When the title bar statistics were last refreshed
+    uint64_t title_time = timerNow();
+
+    //Sleep only wakes up on the scheduler tick, 15.6 ms unless asked for 1 ms
+    timeBeginPeriod(1);
+
+    //Draws TARGET_FPS frames per second while the animation steps at its own rate
+    struct FramePacer pacer;
+    pacerInit(&pacer, TARGET_FPS, ANIMATION_STEPS_PER_SECOND);
+
+    //Main program loop.
+    while (running) {
+        profileFrameBegin();
+
+        //Handle any messages sent to the window.
+        profileStageBegin(PROFILE_MESSAGES);
+        static MSG message = {0};
+        //Check for the next message and remove it from the message queue.
+        while(PeekMessage(&message, NULL, 0, 0, PM_REMOVE)) {
+            //Takes virtual keystrokes and adds any applicable character messages to the queue.
+            TranslateMessage(&message);
+            //Sends the message to the window procedure which handles messages.
+            DispatchMessage(&message);
+        }
+        profileStageEnd(PROFILE_MESSAGES);
+
+        //Record the circle, the triangle and the random pixels,
+        //then rasterize them into the frame
+        profileStageBegin(PROFILE_RECORD);
+        commandListReset(&commands);
+        if (SCENE_PATH) {
+            sceneRecord(&scene, &commands);
+        } else {
+            animationRecord(&animation, &commands);
+        }
+        profileStageEnd(PROFILE_RECORD);
+
+        profileStageBegin(PROFILE_RASTERIZE);
+        rendererExecute(renderer, &commands);
+        profileStageEnd(PROFILE_RASTERIZE);
+
+        if (SHOW_PROFILE_OVERLAY) {
+            profileStageBegin(PROFILE_OVERLAY);
+            //Counters of the frame just drawn, written under the frame rate
+            char counters[2][64];
+            snprintf(counters[0], sizeof(counters[0]), "%d shapes  %d commands",
+                     commandListShapeCount(&commands), commands.count);
+            snprintf(counters[1], sizeof(counters[1]), "radius %d  side %d",
+                     animation.circle_radius, animation.side_length);
+            const char *lines[2] = {counters[0], counters[1]};
+            profileDrawOverlay(lines, SCENE_PATH ? 1 : 2);
+            profileStageEnd(PROFILE_OVERLAY);
+        }
+
+        //Move everything along by however many steps are due
+        profileStageBegin(PROFILE_UPDATE);
+        int steps = pacerSteps(&pacer);
+        for (int step = 0; step < steps && !SCENE_PATH; step++) {
+            animationUpdate(&animation);
+        }
+        profileStageEnd(PROFILE_UPDATE);
+
+        //Hand the finished frame to the present thread
+        profileStageBegin(PROFILE_PRESENT);
+        if (capture) {
+            captureFrame(capture);
+        }
+        framePresent();
+        profileStageEnd(PROFILE_PRESENT);
+
+        //Give the CPU back until the next frame is due
+        profileStageBegin(PROFILE_WAIT);
+        pacerWait(&pacer);
+        profileStageEnd(PROFILE_WAIT);
+
+        profileFrameEnd();
+
+        //Show the frame rate and frame times in the title bar
+        if (timerNow() - title_time >= TITLE_INTERVAL_NS) {
+            struct ProfileStats stats;
+            profileStats(&stats);
+            wchar_t title[128];
+            int length = swprintf(title, sizeof(title)/sizeof(title[0]), L"Pixel Drawer - %.1f fps, p50 %.2f ms, p99 %.2f ms",
+                                  stats.fps, stats.frame_ms_p50, stats.frame_ms_p99);
+            if (capture && length > 0) {
+                struct CaptureStats capture_stats;
+                captureStats(capture, &capture_stats);
+                swprintf(title + length, sizeof(title)/sizeof(title[0]) - length, L", recording (%ld dropped)",
+                         capture_stats.frames_dropped);
+            }
+            SetWindowText(window_handle, title);
+            title_time = timerNow();
+        }
+    }
+
+    timeEndPeriod(1);
+    captureDestroy(capture, NULL);
+    swapChainDestroy(swap_chain);
+    frameSetPresentHook(NULL, NULL);
+    commandListFree(&commands);
+    if (SCENE_PATH) {
+        sceneFree(&scene);
+    }
+    rendererDestroy(renderer);
+    frameFree();
+
+    return EXIT_SUCCESS;
+}